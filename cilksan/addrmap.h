@@ -8,130 +8,135 @@
 #include "checking.h"
 #include "debug_util.h"
 
+// Map from addresses, such as the starting addresses of allocated blocks or the
+// addresses of locks, to data.  The map is an open-addressing hash table with
+// linear probing, so its memory use is proportional to the number of entries,
+// regardless of how the addresses are scattered through the address space.
+// Insert, lookup, and remove all take expected O(1) time.
+//
+// Pointers returned by get() remain valid only until the next insert().
 template <typename DATA_T>
 class AddrMap_t {
-  // log_2 of lines per page.
-  static constexpr unsigned LG_PAGE_SIZE = 24;
-  // log_2 of number of pages in the top-level table.
-  static constexpr unsigned LG_TABLE_SIZE = 48 - LG_PAGE_SIZE;
+  // log_2 of the minimum number of entries in the table.
+  static constexpr unsigned LG_MIN_CAPACITY = 8;
 
-  // Mask to identify the byte within a page.
-  static constexpr uintptr_t BYTE_MASK = ((1UL << LG_PAGE_SIZE) - 1);
-
-  // Helper methods to get the indices into the dictionary from a given address.
-  __attribute__((always_inline)) static uintptr_t byte(uintptr_t addr) {
-    return addr & BYTE_MASK;
-  }
-  __attribute__((always_inline)) static uintptr_t page(uintptr_t addr) {
-    return addr >> LG_PAGE_SIZE;
-  }
-
-  struct Page_t {
-    // Bitmap identifying bytes in the page that were previously accessed in
-    // the current strand.
-    static constexpr size_t VALID_ARR_SIZE =
-        (1UL << LG_PAGE_SIZE) / (8 * sizeof(uint64_t));
-    uint64_t Valid[VALID_ARR_SIZE] = {0};
-
-    DATA_T Bytes[1UL << LG_PAGE_SIZE];
-
-    // To accommodate the size and sparse access pattern of a Page_t, use
-    // mmap/munmap to allocate and free Page_t's.
-    void *operator new(size_t size) {
-      CheckingRAII nocheck;
-      return mmap(nullptr, sizeof(Page_t), PROT_READ | PROT_WRITE,
-                  MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
-    }
-    void operator delete(void *ptr) {
-      CheckingRAII nocheck;
-      munmap(ptr, sizeof(Page_t));
-    }
+  // The address 0 marks an empty entry, so the map cannot contain it.
+  struct Entry_t {
+    uintptr_t addr;
+    DATA_T data;
+  };
 
-    // Operators for accessing lines
-    DATA_T &operator[](uintptr_t byteaddr) { return Bytes[byteaddr]; }
-    const DATA_T &operator[](uintptr_t byteaddr) const {
-      return Bytes[byteaddr];
-    }
+  Entry_t *Table = nullptr;
+  unsigned LgCapacity = 0;
+  size_t NumEntries = 0;
 
-    // Constants for operating on valid bits
-    static constexpr uintptr_t LG_VALID_WORD_SIZE = 6;
-    static constexpr uintptr_t VALID_WORD_SIZE = 1UL << LG_VALID_WORD_SIZE;
-    static_assert(
-        VALID_WORD_SIZE == (8 * sizeof(uint64_t)),
-        "LG_VALID_WORD_SIZE does not correspond with valid-word size");
-    static constexpr uintptr_t VALID_BIT_MASK = VALID_WORD_SIZE - 1;
-    static constexpr uintptr_t VALID_WORD_MASK = ~VALID_BIT_MASK;
-    static constexpr uintptr_t VALID_WORD_IDX =
-        VALID_WORD_MASK ^ ~((1UL << LG_PAGE_SIZE) - 1);
-
-    // Static helper methods for operating on valid bits
-    __attribute__((always_inline)) static uintptr_t validWord(uintptr_t addr) {
-      return (addr & VALID_WORD_IDX) >> LG_VALID_WORD_SIZE;
-    }
-    __attribute__((always_inline)) static uintptr_t
-    validBit(uintptr_t addr) {
-      return addr & VALID_BIT_MASK;
-    }
+  __attribute__((always_inline)) uintptr_t mask() const {
+    return (1UL << LgCapacity) - 1;
+  }
 
-    bool isValid(uintptr_t byteaddr) const {
-      return Valid[validWord(byteaddr)] & (1UL << validBit(byteaddr));
-    }
-    void setValid(uintptr_t byteaddr) {
-      Valid[validWord(byteaddr)] |= 1UL << validBit(byteaddr);
-    }
-    void clearValid(uintptr_t byteaddr) {
-      Valid[validWord(byteaddr)] &= ~(1UL << validBit(byteaddr));
-    }
-  };
+  // Helper method to get the home index of an address in the table.  Most
+  // addresses in the map are aligned to at least 16 bytes, so the hash ignores
+  // the low-order bits of the address.
+  __attribute__((always_inline)) uintptr_t home(uintptr_t addr) const {
+    return ((addr >> 4) * 0x9E3779B97F4A7C15UL) >> (64 - LgCapacity);
+  }
 
-  Page_t *Table[1UL << LG_TABLE_SIZE] = {nullptr};
+  // To keep the table out of the program's heap, use mmap/munmap to allocate
+  // and free the table.
+  static Entry_t *allocTable(unsigned lg_capacity) {
+    CheckingRAII nocheck;
+    void *mem = mmap(nullptr, sizeof(Entry_t) << lg_capacity,
+                     PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    if (MAP_FAILED == mem)
+      die("Failed to allocate address-map table.\n");
+    return static_cast<Entry_t *>(mem);
+  }
+  static void freeTable(Entry_t *table, unsigned lg_capacity) {
+    CheckingRAII nocheck;
+    munmap(table, sizeof(Entry_t) << lg_capacity);
+  }
 
-  Page_t *getPage(uintptr_t addr) const {
-    return Table[page(addr)];
+  // Returns the index of the entry for addr, or of the empty entry where addr
+  // would be inserted.
+  __attribute__((always_inline)) uintptr_t find(uintptr_t addr) const {
+    uintptr_t i = home(addr);
+    while (Table[i].addr && Table[i].addr != addr)
+      i = (i + 1) & mask();
+    return i;
   }
 
-  Page_t *getOrCreatePage(uintptr_t addr) {
-    Page_t *Page = getPage(addr);
-    if (!Page) {
-      Page = new Page_t;
-      Table[page(addr)] = Page;
-    }
-    return Page;
+  void grow() {
+    Entry_t *OldTable = Table;
+    unsigned OldLgCapacity = LgCapacity;
+    LgCapacity = OldTable ? OldLgCapacity + 1 : LG_MIN_CAPACITY;
+    Table = allocTable(LgCapacity);
+    if (!OldTable)
+      return;
+    for (uintptr_t i = 0; i < (1UL << OldLgCapacity); ++i)
+      if (OldTable[i].addr)
+        Table[find(OldTable[i].addr)] = OldTable[i];
+    freeTable(OldTable, OldLgCapacity);
   }
 
 public:
 
   ~AddrMap_t() {
-    for (uintptr_t i = 0; i < (1UL << LG_TABLE_SIZE); ++i) {
-      if (Table[i]) {
-        delete Table[i];
-        Table[i] = nullptr;
-      }
+    if (Table) {
+      freeTable(Table, LgCapacity);
+      Table = nullptr;
     }
   }
 
+  size_t size() const { return NumEntries; }
+
   bool contains(uintptr_t addr) const {
-    if (const Page_t *Page = getPage(addr))
-      return Page->isValid(byte(addr));
-    return false;
+    return get(addr) != nullptr;
   }
 
   const DATA_T *get(uintptr_t addr) const {
-    if (const Page_t *Page = getPage(addr))
-      if (Page->isValid(byte(addr)))
-        return &(*Page)[byte(addr)];
-    return nullptr;
+    if (!NumEntries || !addr)
+      return nullptr;
+    const Entry_t &E = Table[find(addr)];
+    return E.addr ? &E.data : nullptr;
   }
 
   void insert(uintptr_t addr, const DATA_T &data) {
-    Page_t *Page = getOrCreatePage(addr);
-    (*Page)[byte(addr)] = data;
-    Page->setValid(byte(addr));
+    if (!addr)
+      return;
+    // Keep the load factor at most 1/2.
+    if (2 * (NumEntries + 1) > (Table ? (1UL << LgCapacity) : 0))
+      grow();
+    Entry_t &E = Table[find(addr)];
+    if (!E.addr) {
+      E.addr = addr;
+      ++NumEntries;
+    }
+    E.data = data;
   }
 
   void remove(uintptr_t addr) {
-    if (Page_t *Page = getPage(addr))
-      Page->clearValid(byte(addr));
+    if (!NumEntries || !addr)
+      return;
+    uintptr_t i = find(addr);
+    if (!Table[i].addr)
+      return;
+    // Shift later entries in the same probe sequence back into the hole, so
+    // that lookups never need to skip over deleted entries.
+    uintptr_t j = i;
+    while (true) {
+      j = (j + 1) & mask();
+      if (!Table[j].addr)
+        break;
+      uintptr_t k = home(Table[j].addr);
+      // Move the entry at j into the hole at i unless its home lies cyclically
+      // in (i, j].
+      if ((i < j) ? (k <= i || k > j) : (k <= i && k > j)) {
+        Table[i] = Table[j];
+        i = j;
+      }
+    }
+    Table[i].addr = 0;
+    --NumEntries;
   }
 };
 
@@ -3,13 +3,17 @@
 #include "disjointset.h"
 #include "driver.h"
 #include "frame_data.h"
+#include "iter_region.h"
+#include "profiler.h"
 #include "race_detect_update.h"
 #include "simple_shadow_mem.h"
 #include "spbag.h"
 #include "stack.h"
+#include "suppressions.h"
 #include <cstdio>
 #include <cstdlib>
 #include <iostream>
+#include <vector>
 
 // FILE io used to print error messages
 FILE *err_io = stderr;
@@ -21,6 +25,7 @@ enum EventType_t last_event = NONE;
 // Flag to track whether Cilksan is initialized.
 bool CILKSAN_INITIALIZED = false;
 
+csi_id_t total_func = 0;
 csi_id_t total_call = 0;
 csi_id_t total_spawn = 0;
 csi_id_t total_loop = 0;
@@ -30,11 +35,6 @@ csi_id_t total_alloca = 0;
 csi_id_t total_allocfn = 0;
 csi_id_t total_free = 0;
 
-// declared in print_addr.cpp
-extern uintptr_t *call_pc;
-extern uintptr_t *load_pc;
-extern uintptr_t *store_pc;
-
 // Flag to globally enable/disable instrumentation.
 bool instrumentation = false;
 
@@ -44,19 +44,32 @@ bool is_running_under_rr = false;
 // Reentrant flag for enabling/disabling instrumentation; 0 enables checking.
 int checking_disabled = 0;
 
-// Stack structure for tracking whether the current execution is parallel, i.e.,
-// whether there are any unsynced spawns in the program execution.
-Stack_t<uint8_t> parallel_execution;
-Stack_t<bool> spbags_frame_skipped;
+// Statistics collected when CILKSAN_STATS is set.
+Stats_t cilksan_stats;
+
+// Stack of per-frame state of the driver, including whether the current
+// execution is parallel.
+Stack_t<DriverFrame_t> driver_frames;
+bool parallel_execution = false;
+// Number of selected functions and checked regions the execution is in.
+unsigned checked_region_depth = 0;
+
+// Repeated regions marked by __cilksan_region_begin and __cilksan_region_end,
+// the outermost such region the execution is in, and the nesting depth of such
+// regions.  skip_region_checks is set when Cilksan skips checking the current
+// execution of the active region.
+std::vector<IterRegion_t *> iter_regions;
+IterRegion_t *active_iter_region = nullptr;
+unsigned iter_region_depth = 0;
+bool skip_region_checks = false;
+// Number of executions of a region to check after its behavior changes.
+unsigned iter_region_checks = 2;
 
 // Storage for old values of stack_low_addr and stack_high_addr, saved when
 // entering a cilkified region.
 uintptr_t uncilkified_stack_low_addr = (uintptr_t)-1;
 uintptr_t uncilkified_stack_high_addr = 0;
 
-// Stack for tracking whether a stack switch has occurred.
-Stack_t<uint8_t> switched_stack;
-
 // Stack structures for keeping track of MAAPs for pointer arguments to function
 // calls.
 Stack_t<std::pair<csi_id_t, MAAP_t>> MAAPs;
@@ -131,8 +144,149 @@ PBag_t::FreeNode_t *PBag_t::free_list = nullptr;
 uintptr_t stack_low_addr = (uintptr_t)-1;
 uintptr_t stack_high_addr = 0;
 
-// Free list for call-stack nodes
-call_stack_node_t *call_stack_node_t::free_list = nullptr;
+// Arena and hash-consing table for call-stack nodes
+struct call_stack_node_t::Chunk_t {
+  static constexpr unsigned NUM_NODES = 1024;
+  Chunk_t *next = nullptr;
+  unsigned used = 0;
+  alignas(call_stack_node_t) char Nodes[NUM_NODES * sizeof(call_stack_node_t)];
+
+  Chunk_t(Chunk_t *next) : next(next) {}
+
+  bool isFull() const { return used == NUM_NODES; }
+
+  void *getFreeNode() {
+    return &Nodes[used++ * sizeof(call_stack_node_t)];
+  }
+};
+
+call_stack_node_t::Chunk_t *call_stack_node_t::arena = nullptr;
+call_stack_node_t **call_stack_node_t::table = nullptr;
+unsigned call_stack_node_t::lg_table_size = 0;
+size_t call_stack_node_t::num_nodes = 0;
+call_stack_node_t *call_stack_node_t::last_root = nullptr;
+call_stack_node_t *call_stack_node_t::free_nodes = nullptr;
+size_t call_stack_node_t::collect_threshold =
+    call_stack_node_t::MIN_COLLECT_THRESHOLD;
+
+call_stack_node_t *call_stack_node_t::intern(CallID_t id,
+                                             call_stack_node_t *prev) {
+  if (__builtin_expect(!table, false)) {
+    lg_table_size = LG_MIN_TABLE_SIZE;
+    table = (call_stack_node_t **)calloc(1UL << lg_table_size,
+                                         sizeof(call_stack_node_t *));
+  }
+
+  // Search the bucket for an existing node.
+  size_t bucket = hash(id, prev, lg_table_size);
+  for (call_stack_node_t *node = table[bucket]; node;
+       node = node->next_in_bucket)
+    if (node->prev == prev && node->id == id)
+      return node;
+
+  // Reclaim unreachable nodes before creating more.  The call stack being
+  // pushed is the only live call stack not stored in a disjoint set.
+  if (num_nodes >= collect_threshold)
+    collect(prev);
+
+  // Create a new node, reusing a reclaimed node if possible and otherwise
+  // allocating a new chunk in the arena if necessary.
+  void *mem;
+  if (free_nodes) {
+    mem = free_nodes;
+    free_nodes = free_nodes->next_in_bucket;
+  } else {
+    if (!arena || arena->isFull())
+      arena = new (malloc(sizeof(Chunk_t))) Chunk_t(arena);
+    mem = arena->getFreeNode();
+  }
+  call_stack_node_t *new_node = new (mem) call_stack_node_t(id, prev);
+  new_node->next_in_bucket = table[bucket];
+  table[bucket] = new_node;
+  ++num_nodes;
+
+  // Grow the table if the average bucket has more than one node.
+  if (num_nodes > (1UL << lg_table_size)) {
+    unsigned new_lg_size = lg_table_size + 1;
+    call_stack_node_t **new_table = (call_stack_node_t **)calloc(
+        1UL << new_lg_size, sizeof(call_stack_node_t *));
+    for (size_t i = 0; i < (1UL << lg_table_size); ++i) {
+      call_stack_node_t *node = table[i];
+      while (node) {
+        call_stack_node_t *next = node->next_in_bucket;
+        size_t new_bucket = hash(node->id, node->prev, new_lg_size);
+        node->next_in_bucket = new_table[new_bucket];
+        new_table[new_bucket] = node;
+        node = next;
+      }
+    }
+    free(table);
+    table = new_table;
+    lg_table_size = new_lg_size;
+  }
+  return new_node;
+}
+
+void call_stack_node_t::collect(call_stack_node_t *live_tail) {
+  // Mark the nodes reachable from live call stacks.
+  mark(live_tail);
+  DisjointSet_t<call_stack_t>::forEachLive(
+      [](const DisjointSet_t<call_stack_t> *DS) {
+        mark(DS->get_data().getTail());
+      });
+  for (size_t i = 0; i < (1UL << lg_table_size); ++i)
+    for (call_stack_node_t *node = table[i]; node; node = node->next_in_bucket)
+      if (node->pinned)
+        mark(node);
+
+  // Drop cached children that are about to be reclaimed.
+  if (last_root && !last_root->marked)
+    last_root = nullptr;
+  for (size_t i = 0; i < (1UL << lg_table_size); ++i)
+    for (call_stack_node_t *node = table[i]; node; node = node->next_in_bucket)
+      if (node->marked && node->last_child && !node->last_child->marked)
+        node->last_child = nullptr;
+
+  // Unlink unmarked nodes from the table and move them to the free list.
+  for (size_t i = 0; i < (1UL << lg_table_size); ++i) {
+    call_stack_node_t **link = &table[i];
+    while (call_stack_node_t *node = *link) {
+      if (node->marked) {
+        node->marked = false;
+        link = &node->next_in_bucket;
+        continue;
+      }
+      *link = node->next_in_bucket;
+      node->next_in_bucket = free_nodes;
+      free_nodes = node;
+      --num_nodes;
+    }
+  }
+
+  collect_threshold = 2 * num_nodes;
+  if (collect_threshold < MIN_COLLECT_THRESHOLD)
+    collect_threshold = MIN_COLLECT_THRESHOLD;
+}
+
+void call_stack_node_t::cleanup() {
+  Chunk_t *chunk = arena;
+  while (chunk) {
+    Chunk_t *next = chunk->next;
+    chunk->~Chunk_t();
+    free(chunk);
+    chunk = next;
+  }
+  arena = nullptr;
+  if (table) {
+    free(table);
+    table = nullptr;
+  }
+  lg_table_size = 0;
+  num_nodes = 0;
+  last_root = nullptr;
+  free_nodes = nullptr;
+  collect_threshold = MIN_COLLECT_THRESHOLD;
+}
 
 // Global object to manage Cilksan data structures.
 CilkSanImpl_t CilkSanImpl;
@@ -293,7 +447,7 @@ inline void CilkSanImpl_t::start_new_function(unsigned num_sync_reg) {
   cilksan_assert(child->num_Pbags == 0);
 
   DBG_TRACE(BAGS, "Creating SBag for frame %ld\n", frame_id);
-  child_sbag = createNewSBag(frame_id, call_stack);
+  child_sbag = createNewSBag(frame_id, get_current_call_stack());
 
   child->init_new_function(child_sbag);
 
@@ -385,6 +539,7 @@ inline void CilkSanImpl_t::complete_sync(unsigned sync_reg) {
 // Callback functions
 //---------------------------------------------------------------
 void CilkSanImpl_t::do_enter(unsigned num_sync_reg) {
+  PhaseRAII_t phase(PHASE_BAGS);
   WHEN_CILKSAN_DEBUG(cilksan_assert(CILKSAN_INITIALIZED));
   WHEN_CILKSAN_DEBUG(cilksan_assert(last_event == NONE));
   WHEN_CILKSAN_DEBUG(last_event = ENTER_FRAME);
@@ -400,6 +555,7 @@ void CilkSanImpl_t::do_enter(unsigned num_sync_reg) {
 }
 
 void CilkSanImpl_t::do_enter_helper(unsigned num_sync_reg) {
+  PhaseRAII_t phase(PHASE_BAGS);
   WHEN_CILKSAN_DEBUG(cilksan_assert(CILKSAN_INITIALIZED));
   DBG_TRACE(CALLBACK, "frame %ld cilk_enter_helper_begin\n", frame_id + 1);
   WHEN_CILKSAN_DEBUG(cilksan_assert(last_event == NONE));
@@ -415,11 +571,12 @@ void CilkSanImpl_t::do_enter_helper(unsigned num_sync_reg) {
 }
 
 void CilkSanImpl_t::do_detach() {
+  PhaseRAII_t phase(PHASE_BAGS);
   WHEN_CILKSAN_DEBUG(cilksan_assert(CILKSAN_INITIALIZED));
   WHEN_CILKSAN_DEBUG(cilksan_assert(last_event == NONE));
   WHEN_CILKSAN_DEBUG(last_event = DETACH);
 
-  update_strand_stats();
+  CILKSAN_STAT(cilksan_stats.end_strand());
   shadow_memory->clearOccupied();
 
   DBG_TRACE(CALLBACK, "cilk_detach\n");
@@ -436,16 +593,18 @@ void CilkSanImpl_t::do_detach() {
 }
 
 void CilkSanImpl_t::do_detach_continue(unsigned sync_reg) {
+  PhaseRAII_t phase(PHASE_BAGS);
   WHEN_CILKSAN_DEBUG(cilksan_assert(CILKSAN_INITIALIZED));
   DBG_TRACE(CALLBACK, "cilk_detach_continue\n");
 
   reduce_local_views();
-  update_strand_stats();
+  CILKSAN_STAT(cilksan_stats.end_strand());
   shadow_memory->clearOccupied();
   frame_stack.head()->enter_continuation(sync_reg);
 }
 
 void CilkSanImpl_t::do_loop_iteration_begin(unsigned num_sync_reg) {
+  PhaseRAII_t phase(PHASE_BAGS);
   DBG_TRACE(CALLBACK, "do_loop_iteration_begin()\n");
   if (start_new_loop) {
     // The first time we enter the loop, create a LOOP_FRAME at the head of
@@ -466,15 +625,16 @@ void CilkSanImpl_t::do_loop_iteration_begin(unsigned num_sync_reg) {
     start_new_loop = false;
   } else {
     cilksan_assert(in_loop());
-    update_strand_stats();
+    CILKSAN_STAT(cilksan_stats.end_strand());
     shadow_memory->clearOccupied();
     frame_stack.head()->enter_loop_continuation();
   }
 }
 
 void CilkSanImpl_t::do_loop_iteration_end() {
+  PhaseRAII_t phase(PHASE_BAGS);
   reduce_local_views();
-  update_strand_stats();
+  CILKSAN_STAT(cilksan_stats.end_strand());
   shadow_memory->clearOccupied();
   frame_stack.head()->exit_loop_continuation();
 
@@ -502,7 +662,7 @@ void CilkSanImpl_t::do_loop_iteration_end() {
 
     // Create a new S-bag for the frame.
     DBG_TRACE(BAGS, "frame %ld creates an S-bag ", func_id);
-    func->set_sbag(createNewSBag(func_id, call_stack));
+    func->set_sbag(createNewSBag(func_id, get_current_call_stack()));
     DBG_TRACE(BAGS, "%p\n", func->Sbag);
   }
 
@@ -524,6 +684,7 @@ void CilkSanImpl_t::do_loop_iteration_end() {
 }
 
 void CilkSanImpl_t::do_loop_end(unsigned sync_reg) {
+  PhaseRAII_t phase(PHASE_BAGS);
   DBG_TRACE(CALLBACK, "do_loop_end()\n");
   FrameData_t *func = frame_stack.head();
   cilksan_assert(in_loop());
@@ -552,13 +713,14 @@ void CilkSanImpl_t::do_loop_end(unsigned sync_reg) {
 }
 
 void CilkSanImpl_t::do_sync(unsigned sync_reg) {
+  PhaseRAII_t phase(PHASE_BAGS);
   WHEN_CILKSAN_DEBUG(cilksan_assert(CILKSAN_INITIALIZED));
   DBG_TRACE(CALLBACK, "frame %ld cilk_sync_begin\n",
             frame_stack.head()->Sbag->get_func_id());
   WHEN_CILKSAN_DEBUG(cilksan_assert(last_event == NONE));
   WHEN_CILKSAN_DEBUG(last_event = CILK_SYNC);
 
-  update_strand_stats();
+  CILKSAN_STAT(cilksan_stats.end_strand());
   shadow_memory->clearOccupied();
 
   DBG_TRACE(CALLBACK, "cilk_sync_end\n");
@@ -571,6 +733,7 @@ void CilkSanImpl_t::do_sync(unsigned sync_reg) {
 }
 
 void CilkSanImpl_t::do_leave(unsigned sync_reg) {
+  PhaseRAII_t phase(PHASE_BAGS);
   WHEN_CILKSAN_DEBUG(cilksan_assert(CILKSAN_INITIALIZED));
   WHEN_CILKSAN_DEBUG(cilksan_assert(last_event == NONE));
   WHEN_CILKSAN_DEBUG(last_event = LEAVE_FRAME_OR_HELPER);
@@ -602,6 +765,7 @@ template <bool is_read, MAType_t type>
 __attribute__((always_inline)) void
 CilkSanImpl_t::record_mem_helper(const csi_id_t acc_id, uintptr_t addr,
                                  size_t mem_size, unsigned alignment) {
+  PhaseRAII_t phase(PHASE_SHADOW);
   // Do nothing for 0-byte accesses
   if (!mem_size)
     return;
@@ -630,6 +794,7 @@ template <bool is_read, MAType_t type>
 void CilkSanImpl_t::record_locked_mem_helper(const csi_id_t acc_id,
                                              uintptr_t addr, size_t mem_size,
                                              unsigned alignment) {
+  PhaseRAII_t phase(PHASE_SHADOW);
   // Do nothing for 0-byte accesses
   if (!mem_size)
     return;
@@ -650,13 +815,17 @@ void CilkSanImpl_t::record_locked_mem_helper(const csi_id_t acc_id,
   //   return;
   // }
 
+  // Reads are protected by all held locks, while writes are only protected by
+  // locks held for writing.
   FrameData_t *f = frame_stack.head();
-  check_data_races_and_update<is_read>(acc_id, type, addr, mem_size, f, lockset,
+  check_data_races_and_update<is_read>(acc_id, type, addr, mem_size, f,
+                                       is_read ? lockset_id : write_lockset_id,
                                        *shadow_memory);
 }
 
 void CilkSanImpl_t::record_free(uintptr_t addr, size_t mem_size,
                                 csi_id_t acc_id, MAType_t type) {
+  PhaseRAII_t phase(PHASE_SHADOW);
   // Do nothing for 0-byte frees
   if (!mem_size)
     return;
@@ -664,7 +833,7 @@ void CilkSanImpl_t::record_free(uintptr_t addr, size_t mem_size,
   FrameData_t *f = frame_stack.head();
   if (locks_held()) {
     check_data_races_and_update<false>(acc_id, type, addr, mem_size, f,
-                                       lockset, *shadow_memory);
+                                       write_lockset_id, *shadow_memory);
   } else {
     check_races_and_update<false>(acc_id, type, addr, mem_size, f,
                                   *shadow_memory);
@@ -746,7 +915,7 @@ check_races_and_update_fast(const csi_id_t acc_id, MAType_t type,
 // done checking, update shadow_memory with this new read access.
 __attribute__((always_inline)) void check_data_races_and_update_with_read(
     const csi_id_t acc_id, MAType_t type, uintptr_t addr, size_t mem_size,
-    FrameData_t *f, const LockSet_t &lockset, SimpleShadowMem &shadow_memory) {
+    FrameData_t *f, LockSetID_t lockset, SimpleShadowMem &shadow_memory) {
   shadow_memory.update_with_read(acc_id, type, addr, mem_size, f);
   shadow_memory.update_lockers_with_read(acc_id, type, addr, mem_size, f,
                                          lockset);
@@ -759,7 +928,7 @@ __attribute__((always_inline)) void check_data_races_and_update_with_read(
 // similar to check_data_races_and_update_with_read function.
 __attribute__((always_inline)) void check_data_races_and_update_with_write(
     const csi_id_t acc_id, MAType_t type, uintptr_t addr, size_t mem_size,
-    FrameData_t *f, const LockSet_t &lockset, SimpleShadowMem &shadow_memory) {
+    FrameData_t *f, LockSetID_t lockset, SimpleShadowMem &shadow_memory) {
   shadow_memory.check_data_race_and_update_write(acc_id, type, addr, mem_size,
                                                  f, lockset);
   shadow_memory.check_data_race_with_prev_read(acc_id, type, addr, mem_size, f,
@@ -775,12 +944,12 @@ __attribute__((always_inline)) void check_data_races_and_update_with_write(
 // addr: memory address accessed
 // mem_size: number of bytes accessed, starting at addr
 // f: pointer to current frame on the shadow stack
-// lockset: set of currently held locks
+// lockset: ID of the set of currently held locks
 // shadow_memory: shadow memory recording memory access information
 template <bool is_read>
 void check_data_races_and_update(const csi_id_t acc_id, MAType_t type,
                                  uintptr_t addr, size_t mem_size, FrameData_t *f,
-                                 const LockSet_t &lockset,
+                                 LockSetID_t lockset,
                                  SimpleShadowMem &shadow_memory) {
   // Set the occupancy bits in the shadow memory, to deduplicate memory accesses
   // in the same strand at runtime.  If we find that all occupancy bits for
@@ -804,8 +973,7 @@ void CilkSanImpl_t::do_read(const csi_id_t load_id, uintptr_t addr,
   DBG_TRACE(MEMORY, "record read %lu: %lu bytes at addr %p and rip %p.\n",
             load_id, mem_size, addr,
             (load_id != UNKNOWN_CSI_ID) ? load_pc[load_id] : 0);
-  if (collect_stats)
-    collect_read_stat(mem_size);
+  CILKSAN_STAT(cilksan_stats.record_read(mem_size));
 
   bool on_stack = is_on_stack(addr);
   if (on_stack)
@@ -820,8 +988,7 @@ void CilkSanImpl_t::do_write(const csi_id_t store_id, uintptr_t addr,
   WHEN_CILKSAN_DEBUG(cilksan_assert(CILKSAN_INITIALIZED));
   DBG_TRACE(MEMORY, "record write %ld: %lu bytes at addr %p and rip %p.\n",
             store_id, mem_size, addr, store_pc[store_id]);
-  if (collect_stats)
-    collect_write_stat(mem_size);
+  CILKSAN_STAT(cilksan_stats.record_write(mem_size));
 
   bool on_stack = is_on_stack(addr);
   if (on_stack)
@@ -861,8 +1028,7 @@ void CilkSanImpl_t::do_locked_read(const csi_id_t load_id, uintptr_t addr,
             "record read %lu: %lu bytes at addr %p and rip %p, locked.\n",
             load_id, mem_size, addr,
             (load_id != UNKNOWN_CSI_ID) ? load_pc[load_id] : 0);
-  if (collect_stats)
-    collect_read_stat(mem_size);
+  CILKSAN_STAT(cilksan_stats.record_read(mem_size));
 
   bool on_stack = is_on_stack(addr);
   if (on_stack)
@@ -878,8 +1044,7 @@ void CilkSanImpl_t::do_locked_write(const csi_id_t store_id, uintptr_t addr,
   DBG_TRACE(MEMORY,
             "record write %ld: %lu bytes at addr %p and rip %p, locked.\n",
             store_id, mem_size, addr, store_pc[store_id]);
-  if (collect_stats)
-    collect_write_stat(mem_size);
+  CILKSAN_STAT(cilksan_stats.record_write(mem_size));
 
   bool on_stack = is_on_stack(addr);
   if (on_stack)
@@ -904,14 +1069,26 @@ template void CilkSanImpl_t::do_locked_write<MAType_t::ALLOC>(
 
 // clear the memory block at [start,start+size) (end is exclusive).
 void CilkSanImpl_t::clear_shadow_memory(size_t start, size_t size) {
+  PhaseRAII_t phase(PHASE_SHADOW);
   if (!size)
     return;
   DBG_TRACE(MEMORY, "cilksan_clear_shadow_memory(%p, %ld)\n", start, size);
   shadow_memory->clear(start, size);
 }
 
+// Free the shadow pages that lie entirely within [start,start+size), which the
+// program no longer maps.
+void CilkSanImpl_t::drop_shadow_pages(size_t start, size_t size) {
+  PhaseRAII_t phase(PHASE_SHADOW);
+  if (!size)
+    return;
+  DBG_TRACE(MEMORY, "cilksan_drop_shadow_pages(%p, %ld)\n", start, size);
+  shadow_memory->drop_pages(start, size);
+}
+
 void CilkSanImpl_t::record_alloc(size_t start, size_t size,
                                  csi_id_t alloca_id) {
+  PhaseRAII_t phase(PHASE_SHADOW);
   if (!size)
     return;
   DBG_TRACE(MEMORY, "cilksan_record_alloc(%p, %ld)\n", start, size);
@@ -920,35 +1097,103 @@ void CilkSanImpl_t::record_alloc(size_t start, size_t size,
 }
 
 void CilkSanImpl_t::clear_alloc(size_t start, size_t size) {
+  PhaseRAII_t phase(PHASE_SHADOW);
   if (!size)
     return;
   DBG_TRACE(MEMORY, "cilksan_clear_alloc(%p, %ld)\n", start, size);
   shadow_memory->clear_alloc(start, size);
 }
 
+static const char *const hook_category_names[NUM_HOOK_CATEGORIES] = {
+    "memory", "function", "parallel", "library"};
+
+// Helper function to print the nonzero buckets of a histogram as CSV rows.
+static void print_histogram_csv(const char *name, const uint64_t *hist) {
+  for (unsigned b = 0; b < Stats_t::NUM_BUCKETS; ++b)
+    if (hist[b])
+      std::cout << name << "," << (1UL << b) << "," << hist[b] << "\n";
+}
+
+// Helper function to print a histogram as a JSON object mapping the lower
+// bound of each nonzero bucket to its count.
+static void print_histogram_json(const char *name, const uint64_t *hist) {
+  std::cout << "  \"" << name << "\": {";
+  const char *sep = "";
+  for (unsigned b = 0; b < Stats_t::NUM_BUCKETS; ++b)
+    if (hist[b]) {
+      std::cout << sep << "\"" << (1UL << b) << "\": " << hist[b];
+      sep = ", ";
+    }
+  std::cout << "},\n";
+}
+
 inline void CilkSanImpl_t::print_stats() {
+  const Stats_t &stats = cilksan_stats;
+  if (stats_json) {
+    std::cout << "{\n";
+    print_histogram_json("reads", stats.reads);
+    std::cout << "  \"total reads\": " << stats.total_reads << ",\n";
+    print_histogram_json("writes", stats.writes);
+    std::cout << "  \"total writes\": " << stats.total_writes << ",\n";
+    std::cout << "  \"total strands\": " << stats.strands << ",\n";
+    print_histogram_json("max reads", stats.max_strand_reads);
+    print_histogram_json("max writes", stats.max_strand_writes);
+    std::cout << "  \"shadow pages\": " << stats.shadow_pages << ",\n";
+    std::cout << "  \"line refinements\": " << stats.line_refinements << ",\n";
+    print_histogram_json("find lengths", stats.find_lengths);
+    std::cout << "  \"duplicate races\": " << duplicated_races << ",\n";
+    std::cout << "  \"hooks\": {";
+    for (unsigned c = 0; c < NUM_HOOK_CATEGORIES; ++c)
+      std::cout << (c ? ", " : "") << "\"" << hook_category_names[c]
+                << "\": {\"calls\": " << stats.hook_calls[c]
+                << ", \"cycles\": " << stats.hook_cycles[c] << "}";
+    std::cout << "}\n}\n";
+    return;
+  }
+
+  // Each histogram row gives the lower bound of a bucket, which counts values
+  // from that bound up to, but not including, twice that bound.
   std::cout << ",size (bytes),count\n";
 
-  for (std::pair<size_t, uint64_t> reads : num_reads_checked)
-    std::cout << "reads," << reads.first << "," << reads.second << "\n";
-  std::cout << "total reads,," << total_reads_checked << "\n";
+  print_histogram_csv("reads", stats.reads);
+  std::cout << "total reads,," << stats.total_reads << "\n";
+
+  print_histogram_csv("writes", stats.writes);
+  std::cout << "total writes,," << stats.total_writes << "\n";
 
-  for (std::pair<size_t, uint64_t> writes : num_writes_checked)
-    std::cout << "writes," << writes.first << "," << writes.second << "\n";
-  std::cout << "total writes,," << total_writes_checked << "\n";
+  std::cout << "total strands,," << stats.strands << "\n";
 
-  std::cout << "total strands,," << strand_count << "\n";
+  print_histogram_csv("max reads", stats.max_strand_reads);
+  print_histogram_csv("max writes", stats.max_strand_writes);
 
-  for (std::pair<size_t, uint64_t> reads : max_num_reads_checked)
-    std::cout << "max reads," << reads.first << "," << reads.second << "\n";
+  std::cout << "shadow pages,," << stats.shadow_pages << "\n";
+  std::cout << "line refinements,," << stats.line_refinements << "\n";
+  print_histogram_csv("find lengths", stats.find_lengths);
+  std::cout << "duplicate races,," << duplicated_races << "\n";
 
-  for (std::pair<size_t, uint64_t> writes : max_num_writes_checked)
-    std::cout << "max writes," << writes.first << "," << writes.second << "\n";
+  for (unsigned c = 0; c < NUM_HOOK_CATEGORIES; ++c) {
+    std::cout << hook_category_names[c] << " hook calls,,"
+              << stats.hook_calls[c] << "\n";
+    std::cout << hook_category_names[c] << " hook cycles,,"
+              << stats.hook_cycles[c] << "\n";
+  }
 }
 
 ///////////////////////////////////////////////////////////////////////////
 // Tool initialization and deinitialization
 
+// Print how many executions of each repeated region Cilksan checked, and free
+// the regions.
+static void print_iter_regions() {
+  for (IterRegion_t *region : iter_regions) {
+    std::cerr << "Cilksan checked " << region->NumChecked << " of "
+              << region->NumExecutions << " executions of region "
+              << region->Id << ".\n";
+    delete region;
+  }
+  iter_regions.clear();
+}
+
 void CilkSanImpl_t::deinit() {
   static bool deinit = false;
   if (!deinit)
@@ -957,8 +1202,10 @@ void CilkSanImpl_t::deinit() {
     return; // deinit-ed already
 
   print_race_report();
+  print_iter_regions();
+  stop_profiler();
   // Optionally print statistics.
-  if (collect_stats)
+  if (cilksan_stats.enabled)
     print_stats();
 
   // Remove references to the disjoint set nodes so they can be freed.
@@ -1012,8 +1259,9 @@ void CilkSanImpl_t::deinit() {
                   << PBag_t::debug_count << "\n";
     });
 
-  // Free the call-stack nodes in the free list.
-  call_stack_node_t::cleanup_freelist();
+  // Release all call-stack nodes.
+  call_stack = call_stack_t();
+  call_stack_node_t::cleanup();
 
   // Free the free lists for SBags and PBags.
   SBag_t::cleanup_freelist();
@@ -1028,42 +1276,17 @@ static void csan_destroy(void) {
   disable_checking();
   CilkSanImpl.deinit();
   fflush(stdout);
-  if (call_pc) {
-    free(call_pc);
-    call_pc = nullptr;
-  }
-  if (spawn_pc) {
-    free(spawn_pc);
-    spawn_pc = nullptr;
-  }
-  if (loop_pc) {
-    free(loop_pc);
-    loop_pc = nullptr;
-  }
-  if (load_pc) {
-    free(load_pc);
-    load_pc = nullptr;
-  }
-  if (store_pc) {
-    free(store_pc);
-    store_pc = nullptr;
-  }
-  if (alloca_pc) {
-    free(alloca_pc);
-    alloca_pc = nullptr;
-  }
-  if (allocfn_pc) {
-    free(allocfn_pc);
-    allocfn_pc = nullptr;
-  }
-  if (allocfn_prop) {
-    free(allocfn_prop);
-    allocfn_prop = nullptr;
-  }
-  if (free_pc) {
-    free(free_pc);
-    free_pc = nullptr;
-  }
+  free_suppressions();
+  LockSetTable_t::destroy();
+  call_pc.clear();
+  spawn_pc.clear();
+  loop_pc.clear();
+  load_pc.clear();
+  store_pc.clear();
+  alloca_pc.clear();
+  allocfn_pc.clear();
+  allocfn_prop.clear();
+  free_pc.clear();
 }
 
 CilkSanImpl_t::~CilkSanImpl_t() {
@@ -1077,8 +1300,10 @@ void CilkSanImpl_t::init() {
   // Enable stats collection if requested
   {
     char *e = getenv("CILKSAN_STATS");
-    if (e && 0 != strcmp(e, "0"))
-      collect_stats = true;
+    if (e && 0 != strcmp(e, "0")) {
+      cilksan_stats.enabled = true;
+      stats_json = (0 == strcmp(e, "json"));
+    }
   }
   // Enable checking of atomics if requested
   {
@@ -1091,6 +1316,48 @@ void CilkSanImpl_t::init() {
     }
   }
 
+  // Defer construction of call stacks until they are needed, if requested
+  {
+    char *e = getenv("CILKSAN_LAZY_CALL_STACKS");
+    if (e && 0 != strcmp(e, "0"))
+      lazy_call_stack = true;
+  }
+
+  // Set the number of executions of a repeated region to check after its
+  // behavior changes
+  {
+    char *e = getenv("CILKSAN_REGION_CHECKS");
+    if (e)
+      iter_region_checks = atoi(e);
+  }
+
+  // Profile the overhead of Cilksan, if requested
+  {
+    char *e = getenv("CILKSAN_PROFILE");
+    if (e && 0 != strcmp(e, "0"))
+      start_profiler();
+  }
+  // Summarize races by allocation site, if requested
+  {
+    char *e = getenv("CILKSAN_SUMMARY");
+    if (e && 0 != strcmp(e, "0"))
+      summarize_races = true;
+  }
+
+  // Select the format for reporting races
+  {
+    char *e = getenv("CILKSAN_OUT_FORMAT");
+    if (e) {
+      if (0 == strcmp(e, "jsonl"))
+        out_format = OutFormat_t::JSONL;
+      else if (0 == strcmp(e, "bin"))
+        out_format = OutFormat_t::BINARY;
+      else if (0 != strcmp(e, "text"))
+        std::cerr << "WARNING: Unknown CILKSAN_OUT_FORMAT \"" << e
+                  << "\", using text.\n";
+    }
+  }
+
   std::cerr << "Running Cilksan race detector.\n";
 
   // these are true upon creation of the stack
@@ -1101,7 +1368,7 @@ void CilkSanImpl_t::init() {
   // for the main function before we enter the first Cilk context
   SBag_t *sbag;
   DBG_TRACE(BAGS, "Creating SBag for frame %ld\n", frame_id);
-  sbag = createNewSBag(frame_id, call_stack);
+  sbag = createNewSBag(frame_id, get_current_call_stack());
   frame_stack.head()->set_sbag(sbag);
   WHEN_CILKSAN_DEBUG(frame_stack.head()->frame_data =
                          setLoopFrame(frame_stack.head()->frame_data));
@@ -9,10 +9,12 @@
 #include "frame_data.h"
 #include "hypertable.h"
 #include "locksets.h"
+#include "profiler.h"
+#include "race_set.h"
 #include "shadow_mem_allocator.h"
 #include "stack.h"
+#include "stats.h"
 #include <cstdio>
-#include <unordered_map>
 
 extern bool CILKSAN_INITIALIZED;
 
@@ -47,10 +49,27 @@ public:
 
   // Control-flow actions
   inline void record_call(const csi_id_t id, enum CallType_t ty) {
+    PhaseRAII_t phase(PHASE_CALL_STACK);
+    if (lazy_call_stack) {
+      call_log.push_back(CallID_t(ty, id));
+      return;
+    }
     call_stack.push(CallID_t(ty, id));
   }
 
   inline void record_call_return(const csi_id_t id, enum CallType_t ty) {
+    PhaseRAII_t phase(PHASE_CALL_STACK);
+    if (lazy_call_stack) {
+      assert(call_log.back() == CallID_t(ty, id) &&
+             "Mismatched hooks around call/spawn site");
+      call_log.pop();
+      // If the returning frame was materialized, pop it from the call stack.
+      if (call_log.size() <= call_stack_depth) {
+        call_stack.pop();
+        --call_stack_depth;
+      }
+      return;
+    }
     assert(call_stack.tailMatches(CallID_t(ty, id)) &&
            "Mismatched hooks around call/spawn site");
     call_stack.pop();
@@ -63,46 +82,76 @@ public:
 #define PREV_STACK_ALIGN(addr) (addr + STACK_ALIGN)
 
   inline void push_stack_frame(uintptr_t bp, uintptr_t sp) {
+    PhaseRAII_t phase(PHASE_CALL_STACK);
     DBG_TRACE(STACK, "push_stack_frame %p--%p\n", bp, sp);
-    // Record high location of the stack for this frame.
-    uintptr_t high_stack = bp;
-
-    sp_stack.push();
-    *sp_stack.head() = high_stack;
-    // Record low location of the stack for this frame.  This value will be
-    // updated by reads and writes to the stack.
-    sp_stack.push();
-    *sp_stack.head() = sp;
+    // Record the high location of the stack for this frame, and the low
+    // location, which will be updated by reads and writes to the stack.
+    sp_stack.push_back({bp, sp});
+
+    // Clear any stale shadow memory this frame now occupies.
+    if (__builtin_expect(sp < stale_stack_high, false))
+      clear_stale_stack(sp);
   }
 
   inline void advance_stack_frame(uintptr_t addr) {
     DBG_TRACE(STACK, "advance_stack_frame %p to include %p\n",
-              *sp_stack.head(), addr);
-    if (addr < *sp_stack.head())
-      *sp_stack.head() = addr;
+              sp_stack.head()->low, addr);
+    if (addr < sp_stack.head()->low) {
+      sp_stack.head()->low = addr;
+      // Clear any stale shadow memory this frame now occupies.
+      if (__builtin_expect(addr < stale_stack_high, false))
+        clear_stale_stack(addr);
+    }
   }
 
   inline void pop_stack_frame() {
+    PhaseRAII_t phase(PHASE_CALL_STACK);
     // Pop stack pointers.
-    uintptr_t low_stack = *sp_stack.head();
-    sp_stack.pop();
-    uintptr_t high_stack = *sp_stack.head();
+    uintptr_t low_stack = sp_stack.head()->low;
+    uintptr_t high_stack = sp_stack.head()->high;
     sp_stack.pop();
     DBG_TRACE(STACK, "pop_stack_frame %p--%p\n", high_stack, low_stack);
     assert(low_stack <= high_stack);
-    // Clear shadow memory of stack locations.  This seems to be necessary right
+
+    // The shadow memory of the popped frame must be cleared before any later
+    // frame reuses those stack locations.  This seems to be necessary right
     // now, in order to handle functions that dynamically allocate stack memory.
-    clear_shadow_memory(low_stack, high_stack - low_stack);
-    clear_alloc(low_stack, high_stack - low_stack);
+    // Rather than clearing that shadow memory now, add the part of the popped
+    // frame below the parent frame to the stale stack region, which is cleared
+    // on demand when a later frame grows into it.  Consecutive returns thus
+    // coalesce into a single clear, and stack locations that are never reused
+    // are never cleared.
+    uintptr_t parent_low = (sp_stack.size() > 1) ? sp_stack.head()->low : 0;
+    uintptr_t stale_high = (high_stack < parent_low) ? high_stack : parent_low;
+    if (stale_high <= low_stack) {
+      // The popped frame is not below its parent, e.g., because of a stack
+      // switch.  Clear its shadow memory eagerly.
+      clear_shadow_memory(low_stack, high_stack - low_stack);
+      clear_alloc(low_stack, high_stack - low_stack);
+      return;
+    }
+    if (stale_high < high_stack) {
+      // Eagerly clear the part of the popped frame that overlaps its parent.
+      clear_shadow_memory(stale_high, high_stack - stale_high);
+      clear_alloc(stale_high, high_stack - stale_high);
+    }
+    if (stale_stack_low != stale_stack_high &&
+        low_stack - stale_stack_high > MAX_STALE_STACK_GAP)
+      // The popped frame is far from the existing stale region, e.g., because
+      // they lie on different stacks, so clear the existing region first.
+      clear_stale_stack(stale_stack_low);
+    if (stale_stack_low == stale_stack_high)
+      stale_stack_low = low_stack;
+    stale_stack_high = stale_high;
   }
 
   // Restore the stack pointer to the previous value addr
   inline void restore_stack(csi_id_t call_id, uintptr_t addr) {
-    uintptr_t current_stack = *sp_stack.head();
+    uintptr_t current_stack = sp_stack.head()->low;
     if (addr > current_stack) {
       record_free(current_stack, addr - current_stack, call_id,
                   MAType_t::STACK_FREE);
-      *sp_stack.head() = addr;
+      sp_stack.head()->low = addr;
     }
   }
 
@@ -229,6 +278,7 @@ public:
                 unsigned alignment);
 
   void clear_shadow_memory(size_t start, size_t end);
+  void drop_shadow_pages(size_t start, size_t size);
   void record_alloc(size_t start, size_t size, csi_id_t alloca_id);
   void record_free(size_t start, size_t size, csi_id_t acc_id, MAType_t type);
   void clear_alloc(size_t start, size_t size);
@@ -236,45 +286,83 @@ public:
   // Methods for locked accesses
   inline void do_acquire_lock(LockID_t lock_id) {
     lockset.insert(lock_id);
-    lockset_empty = false;
+    lockset_id = LockSetTable_t::intern(lockset);
+    write_lockset.insert(lock_id);
+    write_lockset_id = LockSetTable_t::intern(write_lockset);
+  }
+  // Acquire a lock for reading only, such as a reader-writer lock in read mode.
+  inline void do_acquire_read_lock(LockID_t lock_id) {
+    lockset.insert(lock_id);
+    lockset_id = LockSetTable_t::intern(lockset);
   }
   inline void do_release_lock(LockID_t lock_id) {
     lockset.remove(lock_id);
-    lockset_empty = lockset.isEmpty();
+    lockset_id = LockSetTable_t::intern(lockset);
+    if (write_lockset.contains(lock_id)) {
+      write_lockset.remove(lock_id);
+      write_lockset_id = LockSetTable_t::intern(write_lockset);
+    }
+  }
+  inline bool locks_held() const {
+    return LockSetTable_t::EMPTY_ID != lockset_id;
   }
-  inline bool locks_held() const { return !lockset_empty; }
   template <MAType_t type>
   void do_locked_read(const csi_id_t load_id, uintptr_t addr, size_t len,
                       unsigned alignment);
   template <MAType_t type>
   void do_locked_write(const csi_id_t store_id, uintptr_t addr, size_t len,
                        unsigned alignment);
-  void do_atomic_read(const csi_id_t load_id, uintptr_t addr, size_t len,
-                      unsigned alignment, LockID_t atomic_lock_id) {
-    if (check_atomics) {
+  // Check an atomic access as an access under the atomic lock.  The lockset
+  // with the atomic lock is interned once for the access, and the previous
+  // lockset IDs are restored afterwards rather than interned again.
+  template <bool is_read>
+  void do_atomic_access(const csi_id_t acc_id, uintptr_t addr, size_t len,
+                        unsigned alignment, LockID_t atomic_lock_id) {
+    bool held = lockset.contains(atomic_lock_id);
+    LockSetID_t prev_lockset_id = lockset_id;
+    LockSetID_t prev_write_lockset_id = write_lockset_id;
+    if (!held) {
+      // If all held locks are held for writing, the two locksets stay equal.
+      bool same = (lockset_id == write_lockset_id);
       lockset.insert(atomic_lock_id);
-      do_locked_read<MAType_t::RW>(load_id, addr, len, alignment);
+      write_lockset.insert(atomic_lock_id);
+      lockset_id = LockSetTable_t::intern(lockset);
+      write_lockset_id =
+          same ? lockset_id : LockSetTable_t::intern(write_lockset);
+    }
+    if (is_read)
+      do_locked_read<MAType_t::RW>(acc_id, addr, len, alignment);
+    else
+      do_locked_write<MAType_t::RW>(acc_id, addr, len, alignment);
+    if (!held) {
       lockset.remove(atomic_lock_id);
-    } else {
-      do_read<MAType_t::RW>(load_id, addr, len, alignment);
+      write_lockset.remove(atomic_lock_id);
+      lockset_id = prev_lockset_id;
+      write_lockset_id = prev_write_lockset_id;
     }
   }
+  void do_atomic_read(const csi_id_t load_id, uintptr_t addr, size_t len,
+                      unsigned alignment, LockID_t atomic_lock_id) {
+    if (check_atomics)
+      do_atomic_access<true>(load_id, addr, len, alignment, atomic_lock_id);
+    else
+      do_read<MAType_t::RW>(load_id, addr, len, alignment);
+  }
   void do_atomic_write(const csi_id_t store_id, uintptr_t addr, size_t len,
                        unsigned alignment, LockID_t atomic_lock_id) {
-    if (check_atomics) {
-      lockset.insert(atomic_lock_id);
-      do_locked_write<MAType_t::RW>(store_id, addr, len, alignment);
-      lockset.remove(atomic_lock_id);
-    } else {
+    if (check_atomics)
+      do_atomic_access<false>(store_id, addr, len, alignment, atomic_lock_id);
+    else
       do_write<MAType_t::RW>(store_id, addr, len, alignment);
-    }
   }
 
   // Interface to RR
   static bool RunningUnderRR();
 
   // Methods for recording and reporting races
-  const call_stack_t &get_current_call_stack() const {
+  const call_stack_t &get_current_call_stack() {
+    if (lazy_call_stack)
+      materialize_call_stack();
     return call_stack;
   }
   void report_race(
@@ -287,6 +375,26 @@ public:
   void print_race_report();
   int get_num_races_found();
 
+  // Returns true, and counts the race as a duplicate, if a race equivalent to
+  // the race with signature sig on address addr has been reported already.
+  // Checkers call this method before collecting the full information needed
+  // to report a race.
+  __attribute__((always_inline)) bool is_duplicate_race(const RaceSig_t &sig,
+                                                        uintptr_t addr) {
+    int64_t race_id = races_found.find(sig);
+    if (__builtin_expect(race_id < 0, false))
+      return false;
+    ++duplicated_races;
+    if (__builtin_expect(summarize_races, false))
+      summarize_duplicate_race(race_id, addr);
+    return true;
+  }
+
+  // Formats for reporting races.  TEXT prints a human-readable report of each
+  // race as it is found.  JSONL and BINARY stream compact records of each race,
+  // and symbolize the CSI IDs in those records only when Cilksan exits.
+  enum class OutFormat_t : uint8_t { TEXT, JSONL, BINARY };
+
   // Map from malloc'd address to size of memory allocation
   AddrMap_t<size_t> malloc_sizes;
 
@@ -322,9 +430,51 @@ private:
   Stack_t<FrameData_t> frame_stack;
   // Call stack for the current instruction
   call_stack_t call_stack;
+
+  // When lazy_call_stack is set, call and spawn hooks only log the IDs of the
+  // frames they enter in call_log.  The logged frames are pushed onto
+  // call_stack only when the call stack is actually needed, i.e., when an
+  // S-bag is created or a race is reported.  call_stack_depth records how many
+  // entries of call_log are currently reflected in call_stack.
+  bool lazy_call_stack = false;
+  Stack_t<CallID_t> call_log;
+  uint32_t call_stack_depth = 0;
+
+  // Push the frames in call_log that are not yet on call_stack.
+  void materialize_call_stack() {
+    // Entry 0 of a Stack_t is unused, so logged frame i is at index i + 1.
+    for (uint32_t i = call_stack_depth + 1; i < call_log.size(); ++i)
+      call_stack.push(*call_log.at(i));
+    call_stack_depth = call_log.size() - 1;
+  }
   // Stack maintaining the stack pointer SP, and specifically, the range of
   // stack memory used by each function instantiation.
-  Stack_t<uintptr_t> sp_stack;
+  struct StackRange_t {
+    uintptr_t high;
+    uintptr_t low;
+  };
+  Stack_t<StackRange_t> sp_stack;
+
+  // Range [stale_stack_low, stale_stack_high) of stack memory from returned
+  // frames whose shadow memory has not yet been cleared.  This range always
+  // lies below the stack memory of the current frame, so it is cleared, in
+  // part or in full, whenever the current frame grows into it.
+  uintptr_t stale_stack_low = 0;
+  uintptr_t stale_stack_high = 0;
+  // Maximum gap between the stale stack region and a returning frame that
+  // will be coalesced into the stale stack region.
+  static constexpr uintptr_t MAX_STALE_STACK_GAP = 4096;
+
+  // Clear the shadow memory of the stale stack region at and above addr.
+  void clear_stale_stack(uintptr_t addr) {
+    uintptr_t start = (addr > stale_stack_low) ? addr : stale_stack_low;
+    DBG_TRACE(STACK, "clear_stale_stack %p--%p\n", start, stale_stack_high);
+    clear_shadow_memory(start, stale_stack_high - start);
+    clear_alloc(start, stale_stack_high - start);
+    stale_stack_high = start;
+    if (stale_stack_high == stale_stack_low)
+      stale_stack_low = stale_stack_high = 0;
+  }
 
   // Flag for whether the next loop iteration is the first iteration of a loop
   bool start_new_loop = false;
@@ -333,9 +483,14 @@ private:
   // atomic operation is always accessed by atomic operations
   bool check_atomics = true;
 
-  // Set of locks held at the current instruction
-  bool lockset_empty = true;
+  // Set of locks held at the current instruction, and its interned ID
   LockSet_t lockset;
+  LockSetID_t lockset_id = LockSetTable_t::EMPTY_ID;
+  // Subset of held locks that are held for writing, and its interned ID.  Reads
+  // are checked against lockset, while writes are checked against
+  // write_lockset.
+  LockSet_t write_lockset;
+  LockSetID_t write_lockset_id = LockSetTable_t::EMPTY_ID;
 
   // Shadow memory, which maps a memory address to its last reader and writer
   // and allocation.
@@ -350,76 +505,40 @@ private:
   // Helper list for disjoint sets
   DSList_t DSList;
 
-  // A map keeping track of races found, keyed by the larger instruction address
-  // involved in the race.  Races that have same instructions that made the same
-  // types of accesses are considered as the the same race (even for races where
-  // one is read followed by write and the other is write followed by read, they
-  // are still considered as the same race).  Races that have the same
-  // instruction addresses but different address for memory location is
-  // considered as a duplicate.  The value of the map stores the number
-  // duplicates for the given race.
-  using RaceMap_t = std::unordered_multimap<uint64_t, RaceInfo_t>;
-  RaceMap_t races_found;
+  // A set keeping track of races found, keyed by race signature.  Races that
+  // have same instructions that made the same types of accesses are considered
+  // as the the same race (even for races where one is read followed by write
+  // and the other is write followed by read, they are still considered as the
+  // same race).  Races that have the same instruction addresses but different
+  // address for memory location is considered as a duplicate.
+  RaceSet_t races_found;
   // The number of duplicated races found
   uint32_t duplicated_races = 0;
   const bool color_report;
 
-  // Basic statistics
-  bool collect_stats = false;
-  uint64_t strand_count = 0;
-  uint64_t total_reads_checked = 0;
-  uint64_t total_writes_checked = 0;
-  std::unordered_map<size_t, uint64_t> num_reads_checked;
-  std::unordered_map<size_t, uint64_t> num_writes_checked;
-
-  std::unordered_map<size_t, uint64_t> max_num_reads_checked;
-  std::unordered_map<size_t, uint64_t> max_num_writes_checked;
-
-  std::unordered_map<size_t, uint64_t> strand_num_reads_checked;
-  std::unordered_map<size_t, uint64_t> strand_num_writes_checked;
-
-  void collect_read_stat(size_t mem_size) {
-    ++total_reads_checked;
-    if (!num_reads_checked.count(mem_size))
-      num_reads_checked.insert(std::make_pair(mem_size, 0));
-    ++num_reads_checked[mem_size];
-
-    if (!strand_num_reads_checked.count(mem_size))
-      strand_num_reads_checked.insert(std::make_pair(mem_size, 0));
-    ++strand_num_reads_checked[mem_size];
-  }
-  void collect_write_stat(size_t mem_size) {
-    ++total_writes_checked;
-    if (!num_writes_checked.count(mem_size))
-      num_writes_checked.insert(std::make_pair(mem_size, 0));
-    ++num_writes_checked[mem_size];
-
-    if (!strand_num_writes_checked.count(mem_size))
-      strand_num_writes_checked.insert(std::make_pair(mem_size, 0));
-    ++strand_num_writes_checked[mem_size];
-  }
-
-  void update_strand_stats() {
-    if (!collect_stats)
-      return;
-
-    ++strand_count;
-
-    for (auto &entry : strand_num_reads_checked) {
-      if (!max_num_reads_checked.count(entry.first))
-        max_num_reads_checked.insert(entry);
-      else if (max_num_reads_checked[entry.first] < entry.second)
-        max_num_reads_checked[entry.first] = entry.second;
-    }
-    strand_num_reads_checked.clear();
-    for (auto &entry : strand_num_writes_checked) {
-      if (!max_num_writes_checked.count(entry.first))
-        max_num_writes_checked.insert(entry);
-      else if (max_num_writes_checked[entry.first] < entry.second)
-        max_num_writes_checked[entry.first] = entry.second;
-    }
-    strand_num_writes_checked.clear();
-  }
+  // Format for reporting races.
+  OutFormat_t out_format = OutFormat_t::TEXT;
+  // Methods for streaming machine-readable race records.  Defined in
+  // print_addr.cpp.
+  void write_race_record(const AccessLoc_t &first_inst,
+                         const AccessLoc_t &second_inst,
+                         const AccessLoc_t &alloc_inst, uintptr_t addr,
+                         enum RaceType_t race_type);
+  void finish_race_records();
+
+  // Optionally summarize races by allocation site at the end of execution.
+  bool summarize_races = false;
+  // Methods for summarizing races.  Defined in print_addr.cpp.
+  void summarize_new_race(const AccessLoc_t &first_inst,
+                          const AccessLoc_t &second_inst,
+                          const AccessLoc_t &alloc_inst, uintptr_t addr,
+                          enum RaceType_t race_type);
+  void summarize_duplicate_race(int64_t race_id, uintptr_t addr);
+  void print_race_summary();
+
+  // Print statistics as JSON, rather than CSV, when CILKSAN_STATS=json.  The
+  // statistics themselves are collected in cilksan_stats.
+  bool stats_json = false;
 };
 
 #endif // __CILKSAN_INTERNAL_H__
@@ -6,6 +6,7 @@
 #include "aligned_alloc.h"
 #include "debug_util.h"
 #include "race_info.h"
+#include "stats.h"
 #include <cstddef>
 #include <cstdint>
 #include <cstdio>
@@ -294,6 +295,8 @@ private:
       if (node->_parent_or_bag.isParent())
         disjoint_set_list.push(prev);
     }
+    CILKSAN_STAT(++cilksan_stats.find_lengths[Stats_t::bucket(
+        disjoint_set_list.length() + 1)]);
 
     WHEN_DISJOINTSET_DEBUG(cilksan_assert(tmp_ref_count == _ref_count));
 
@@ -491,6 +494,14 @@ public:
       return nullptr;
     }
 
+    // Call Fn on each disjoint set in this slab that is in use.
+    template <typename FnTy> void forEachDJSet(FnTy Fn) const {
+      for (size_t Idx = 0; Idx < NumDJSets; ++Idx)
+        if (UsedMap[Idx / 64] & (1UL << (Idx % 64)))
+          Fn(reinterpret_cast<const DisjointSet_t *>(
+              &DJSets[Idx * sizeof(DisjointSet_t)]));
+    }
+
     // Returns a line to this slab, marking that line as available.
     void returnDJSet(__attribute__((noescape)) DisjointSet_t *DJSet) {
       uintptr_t DJSetPtr = reinterpret_cast<uintptr_t>(DJSet);
@@ -575,6 +586,14 @@ public:
       return DJSet;
     }
 
+    // Call Fn on each disjoint set allocated by this allocator.
+    template <typename FnTy> void forEachDJSet(FnTy Fn) const {
+      for (DSSlab_t *Slab = FreeSlabs; Slab; Slab = Slab->Next)
+        Slab->forEachDJSet(Fn);
+      for (DSSlab_t *Slab = FullSlabs; Slab; Slab = Slab->Next)
+        Slab->forEachDJSet(Fn);
+    }
+
     void freeDJSet(__attribute__((noescape)) void *Ptr) {
       // Derive the pointer to the slab.
       DSSlab_t *Slab = reinterpret_cast<DSSlab_t *>(
@@ -635,6 +654,11 @@ public:
     // free_list = del_node;
   }
 
+  // Call Fn on each live disjoint set.
+  template <typename FnTy> static void forEachLive(FnTy Fn) {
+    Alloc.forEachDJSet(Fn);
+  }
+
   // static void cleanup_freelist() {
   //   DisjointSet_t *node = free_list;
   //   DisjointSet_t *next = nullptr;
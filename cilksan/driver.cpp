@@ -2,7 +2,11 @@
 #include "cilksan_internal.h"
 #include "debug_util.h"
 #include "driver.h"
+#include "interval_set.h"
+#include "iter_region.h"
 #include "stack.h"
+#include "stack_registry.h"
+#include "suppressions.h"
 #include <cstdarg>
 #include <cstdio>
 #include <cstdlib>
@@ -10,6 +14,7 @@
 #include <dlfcn.h>
 #include <sys/mman.h>
 #include <unistd.h>
+#include <vector>
 
 // FILE io used to print error messages
 extern FILE *err_io;
@@ -19,14 +24,24 @@ extern "C" int __cilkrts_is_initialized(void);
 extern "C" void __cilkrts_internal_set_nworkers(unsigned int nworkers);
 extern "C" void __cilkrts_internal_set_force_reduce(unsigned int force_reduce);
 
-// Estimate on the value of the stack size, used to detect stack-switching.
+// Estimate on the value of the stack size, used to detect stack-switching when
+// the stack region containing the stack pointer cannot be determined.
 static constexpr size_t DEFAULT_STACK_SIZE = 1UL << 21;
 
+// Registry of stack regions, including Cilk worker fiber stacks, used to
+// detect stack-switching.
+static StackRegistry_t stack_registry;
+
+// Region of the stack in use before entering a cilkified region.
+static uintptr_t uncilkified_stack_region_low = 0;
+static uintptr_t uncilkified_stack_region_high = 0;
+
 // declared in cilksan; for debugging only
 #if CILKSAN_DEBUG
 extern enum EventType_t last_event;
 #endif
 
+extern csi_id_t total_func;
 extern csi_id_t total_call;
 extern csi_id_t total_spawn;
 extern csi_id_t total_loop;
@@ -49,19 +64,25 @@ extern bool is_running_under_rr;
 // Reentrant flag for enabling/disabling instrumentation; 0 enables checking.
 extern int checking_disabled;
 
-// Stack structure for tracking whether the current execution is parallel, i.e.,
-// whether there are any unsynced spawns in the program execution.
-extern Stack_t<uint8_t> parallel_execution;
-extern Stack_t<bool> spbags_frame_skipped;
+// Stack of per-frame state of the driver, including whether the current
+// execution is parallel.
+extern Stack_t<DriverFrame_t> driver_frames;
+extern bool parallel_execution;
+extern unsigned checked_region_depth;
+
+// State of repeated regions marked by __cilksan_region_begin and
+// __cilksan_region_end.
+extern std::vector<IterRegion_t *> iter_regions;
+extern IterRegion_t *active_iter_region;
+extern unsigned iter_region_depth;
+extern bool skip_region_checks;
+extern unsigned iter_region_checks;
 
 // Storage for old values of stack_low_addr and stack_high_addr, saved when
 // entering a cilkified region.
 extern uintptr_t uncilkified_stack_low_addr;
 extern uintptr_t uncilkified_stack_high_addr;
 
-// Stack for tracking whether a stack switch has occurred.
-extern Stack_t<uint8_t> switched_stack;
-
 // Stack structures for keeping track of MAAPs for pointer arguments to function
 // calls.
 extern Stack_t<std::pair<csi_id_t, MAAP_t>> MAAPs;
@@ -180,42 +201,47 @@ CILKSAN_API void __csan_init() {
   init_internal();
 }
 
-// Helper function to grow a map from CSI ID to program counter (PC).
-static void grow_pc_table(uintptr_t *&table, csi_id_t &table_cap,
+// Helper function to grow a table indexed by CSI ID to hold extra_cap more IDs.
+template <typename TABLE_T>
+static void grow_id_table(TABLE_T &table, csi_id_t &table_cap,
                           csi_id_t extra_cap) {
-  csi_id_t new_cap = table_cap + extra_cap;
-  table = (uintptr_t *)realloc(table, new_cap * sizeof(uintptr_t));
-  for (csi_id_t i = table_cap; i < new_cap; ++i)
-    table[i] = (uintptr_t)nullptr;
-  table_cap = new_cap;
+  table_cap += extra_cap;
+  table.grow(table_cap);
 }
 
 CILKSAN_API
 void __csan_unit_init(const char *const file_name,
                       const csan_instrumentation_counts_t counts) {
+  csi_id_t old_load = total_load, old_store = total_store;
+  csi_id_t old_alloca = total_alloca, old_allocfn = total_allocfn;
+  csi_id_t old_func = total_func;
+  total_func += counts.num_func;
+
   // Grow the tables mapping CSI ID's to PC values.
   if (counts.num_call)
-    grow_pc_table(call_pc, total_call, counts.num_call);
+    grow_id_table(call_pc, total_call, counts.num_call);
   if (counts.num_detach)
-    grow_pc_table(spawn_pc, total_spawn, counts.num_detach);
+    grow_id_table(spawn_pc, total_spawn, counts.num_detach);
   if (counts.num_loop)
-    grow_pc_table(loop_pc, total_loop, counts.num_loop);
+    grow_id_table(loop_pc, total_loop, counts.num_loop);
   if (counts.num_load)
-    grow_pc_table(load_pc, total_load, counts.num_load);
+    grow_id_table(load_pc, total_load, counts.num_load);
   if (counts.num_store)
-    grow_pc_table(store_pc, total_store, counts.num_store);
+    grow_id_table(store_pc, total_store, counts.num_store);
   if (counts.num_alloca)
-    grow_pc_table(alloca_pc, total_alloca, counts.num_alloca);
+    grow_id_table(alloca_pc, total_alloca, counts.num_alloca);
   if (counts.num_allocfn) {
-    csi_id_t new_cap = total_allocfn + counts.num_allocfn;
-    allocfn_prop = (allocfn_prop_t *)realloc(allocfn_prop,
-                                             new_cap * sizeof(allocfn_prop_t));
-    for (csi_id_t i = total_allocfn; i < new_cap; ++i)
-      allocfn_prop[i].allocfn_ty = uint8_t(-1);
-    grow_pc_table(allocfn_pc, total_allocfn, counts.num_allocfn);
+    allocfn_prop.grow(total_allocfn + counts.num_allocfn);
+    grow_id_table(allocfn_pc, total_allocfn, counts.num_allocfn);
   }
   if (counts.num_free)
-    grow_pc_table(free_pc, total_free, counts.num_free);
+    grow_id_table(free_pc, total_free, counts.num_free);
+
+  // Compile any suppression rules for the new CSI ID's.
+  init_unit_suppressions(old_load, total_load, old_store, total_store,
+                         old_alloca, total_alloca, old_allocfn, total_allocfn);
+  // Select the new functions to check, if only selected functions are checked.
+  init_unit_checked_funcs(old_func, total_func);
 }
 
 ///////////////////////////////////////////////////////////////////////////
@@ -235,6 +261,177 @@ static inline void handle_stack_switch(uintptr_t bp, uintptr_t sp) {
   stack_low_addr = sp;
 }
 
+// Check whether the function or task with base pointer bp and stack pointer sp
+// is executing on a different stack from its parent.  If so, update the stack
+// range and return true.  Updates bp if it does not lie on the same stack as
+// sp.
+static inline bool detect_stack_switch(uintptr_t &bp, uintptr_t sp) {
+  // Fast path: sp lies on the current stack.
+  if (__builtin_expect(stack_registry.in_current(sp), true)) {
+    if (stack_high_addr < bp)
+      stack_high_addr = bp;
+    if (stack_low_addr > sp)
+      stack_low_addr = sp;
+    return false;
+  }
+
+  uintptr_t current_low, current_high;
+  stack_registry.get_current(current_low, current_high);
+
+  uintptr_t region_low, region_high;
+  if (!stack_registry.find(sp, region_low, region_high)) {
+    // We could not determine the stack region containing sp.  Fall back to
+    // guessing based on the distance between the stack and base pointers and
+    // their previous values.  In either case, treat the stack range in use as
+    // the current region, so that later hooks on this stack take the fast
+    // path.
+    if ((bp - sp > DEFAULT_STACK_SIZE) ||
+        (stack_low_addr > sp && stack_low_addr - sp > DEFAULT_STACK_SIZE)) {
+      uncilkified_stack_region_low = current_low;
+      uncilkified_stack_region_high = current_high;
+      if (bp - sp > DEFAULT_STACK_SIZE)
+        bp = sp;
+      handle_stack_switch(bp, sp);
+      stack_registry.set_current(stack_low_addr, stack_high_addr + 1);
+      return true;
+    }
+    if (stack_high_addr < bp)
+      stack_high_addr = bp;
+    if (stack_low_addr > sp)
+      stack_low_addr = sp;
+    stack_registry.set_current(stack_low_addr, stack_high_addr + 1);
+    return false;
+  }
+
+  if (!stack_registry.has_current() ||
+      (region_low < current_high && current_low < region_high)) {
+    // Either this is the first stack we have seen, or the current stack has
+    // grown.  Either way, we have not switched stacks.
+    stack_registry.set_current(region_low, region_high);
+    if (stack_high_addr < bp)
+      stack_high_addr = bp;
+    if (stack_low_addr > sp)
+      stack_low_addr = sp;
+    return false;
+  }
+
+  // We have switched stacks, e.g., to start executing Cilk code on a worker's
+  // fiber.  Only the part of the new stack above sp is in use.
+  uncilkified_stack_region_low = current_low;
+  uncilkified_stack_region_high = current_high;
+  stack_registry.set_current(region_low, region_high);
+  if (bp < region_low || bp >= region_high)
+    bp = sp;
+  handle_stack_switch(bp, sp);
+  return true;
+}
+
+// Restore the stack range after returning from a function or task that
+// switched stacks.
+static inline void restore_switched_stack() {
+  stack_high_addr = uncilkified_stack_high_addr;
+  stack_low_addr = uncilkified_stack_low_addr;
+  stack_registry.set_current(uncilkified_stack_region_low,
+                             uncilkified_stack_region_high);
+}
+
+// Returns true if accesses in the current dynamic context should be checked,
+// i.e., if all functions are checked or the execution is within a selected
+// function or checked region, and Cilksan is not skipping the current
+// execution of a repeated region.
+__attribute__((always_inline)) static inline bool in_checked_region() {
+  return (!check_selected_only || checked_region_depth) && !skip_region_checks;
+}
+
+// Helper methods to push, pop, and update the parallel-execution state of
+// driver frames, which keep the parallel_execution flag equal to the state of
+// the current frame, restricted to checked regions.
+__attribute__((always_inline)) static inline void
+push_driver_frame(const DriverFrame_t &frame) {
+  driver_frames.push_back(frame);
+  parallel_execution = frame.pe && in_checked_region();
+}
+
+__attribute__((always_inline)) static inline void pop_driver_frame() {
+  driver_frames.pop();
+  parallel_execution = driver_frames.back().pe && in_checked_region();
+}
+
+__attribute__((always_inline)) static inline void
+set_parallel_execution(uint8_t pe) {
+  driver_frames.back().pe = pe;
+  parallel_execution = pe && in_checked_region();
+}
+
+// Mark the start and end of a checked region, which Cilksan checks even when
+// CILKSAN_ONLY restricts checking to selected functions.  Checked regions may
+// nest.
+CILKSAN_API void __cilksan_begin_checked_region(void) {
+  ++checked_region_depth;
+  parallel_execution = driver_frames.back().pe && in_checked_region();
+  DBG_TRACE(BASIC, "Begin checked region (%d).\n", checked_region_depth);
+}
+
+CILKSAN_API void __cilksan_end_checked_region(void) {
+  cilksan_assert(checked_region_depth > 0);
+  --checked_region_depth;
+  parallel_execution = driver_frames.back().pe && in_checked_region();
+  DBG_TRACE(BASIC, "End checked region (%d).\n", checked_region_depth);
+}
+
+// Add an event to the fingerprint of the current execution of the active
+// repeated region, if any, and start checking a skipped execution as soon as it
+// runs an event new to the region.
+__attribute__((always_inline)) static inline void
+record_region_event(FingerprintEvent_t event, csi_id_t id) {
+  if (__builtin_expect(active_iter_region != nullptr, false) &&
+      active_iter_region->record(event, id)) {
+    skip_region_checks = false;
+    parallel_execution = driver_frames.back().pe && in_checked_region();
+  }
+}
+
+// Mark the start and end of an execution of a repeated region with the given
+// ID, such as one iteration of an iterative solver.  Cilksan skips checking
+// executions of the region whose behavior matches previously checked
+// executions.  Nested repeated regions are treated as part of the outermost
+// one.
+CILKSAN_API void __cilksan_region_begin(uint64_t id) {
+  if (iter_region_depth++ > 0)
+    return;
+
+  IterRegion_t *region = nullptr;
+  for (IterRegion_t *r : iter_regions)
+    if (r->Id == id) {
+      region = r;
+      break;
+    }
+  if (!region) {
+    region = new IterRegion_t(id, iter_region_checks);
+    iter_regions.push_back(region);
+  }
+
+  active_iter_region = region;
+  skip_region_checks = !region->begin();
+  parallel_execution = driver_frames.back().pe && in_checked_region();
+  DBG_TRACE(BASIC, "Begin region %ld (%s).\n", id,
+            skip_region_checks ? "skipped" : "checked");
+}
+
+CILKSAN_API void __cilksan_region_end(uint64_t id) {
+  cilksan_assert(iter_region_depth > 0);
+  if (--iter_region_depth > 0)
+    return;
+
+  cilksan_assert(active_iter_region->Id == id &&
+                 "Mismatched __cilksan_region_end.");
+  active_iter_region->end();
+  active_iter_region = nullptr;
+  skip_region_checks = false;
+  parallel_execution = driver_frames.back().pe && in_checked_region();
+  DBG_TRACE(BASIC, "End region %ld.\n", id);
+}
+
 // Hook called upon entering a function.
 CILKSAN_API void __csan_func_entry(const csi_id_t func_id,
                                    __attribute__((noescape)) const void *bp,
@@ -250,7 +447,7 @@ CILKSAN_API void __csan_func_entry(const csi_id_t func_id,
       CilkSanImpl.init();
       enable_instrumentation();
       // Note that we start executing the program in series.
-      parallel_execution.push_back(0);
+      push_driver_frame({0, 0, false, false});
       // Push a default value of 0 onto the MAAP_counts stack, in case this
       // function contains get_MAAP calls.
       MAAP_counts.push_back(0);
@@ -259,26 +456,14 @@ CILKSAN_API void __csan_func_entry(const csi_id_t func_id,
 
   if (!should_check())
     return;
+  ENTER_HOOK(HOOK_FUNCTION, PHASE_HOOK);
 
-  // Try to detect stack switching by comparing the current stack and base
-  // pointers to their previous values.  We use this approach, rather than
-  // overlead the Sanitizer methods to communicate fiber switching, to avoid
-  // linking headaches and because this approach is faster.
-  if (((uintptr_t)bp - (uintptr_t)sp > DEFAULT_STACK_SIZE) ||
-      (stack_low_addr > (uintptr_t)sp &&
-       stack_low_addr - (uintptr_t)sp > DEFAULT_STACK_SIZE)) {
-    // It looks like we have switched stacks to start executing Cilk code.
-    handle_stack_switch((uintptr_t)bp, (uintptr_t)sp);
-    switched_stack.push_back(1);
-    if ((uintptr_t)bp - (uintptr_t)sp > DEFAULT_STACK_SIZE)
-      bp = sp;
-  } else {
-    if (stack_high_addr < (uintptr_t)bp)
-      stack_high_addr = (uintptr_t)bp;
-    if (stack_low_addr > (uintptr_t)sp)
-      stack_low_addr = (uintptr_t)sp;
-    switched_stack.push_back(0);
-  }
+  // Detect stack switching by checking whether sp still lies in the region of
+  // the current stack.  We use this approach, rather than overlead the
+  // Sanitizer methods to communicate fiber switching, to avoid linking
+  // headaches and because this approach is faster.
+  uintptr_t frame_bp = (uintptr_t)bp;
+  bool switched = detect_stack_switch(frame_bp, (uintptr_t)sp);
 
   WHEN_CILKSAN_DEBUG({
     const csan_source_loc_t *srcloc = __csan_get_func_source_loc(func_id);
@@ -286,23 +471,25 @@ CILKSAN_API void __csan_func_entry(const csi_id_t func_id,
               srcloc->name, srcloc->filename, srcloc->line_number);
   });
 
+  CilkSanImpl.push_stack_frame(frame_bp, (uintptr_t)sp);
+  record_region_event(FP_FUNC, func_id);
+
   // Propagate the parallel-execution state to the child.
-  uint8_t current_pe = parallel_execution.back();
-  // First we push the pe value on function entry.
-  parallel_execution.push_back(current_pe);
-  // We push a second copy to update aggressively on detaches.
-  parallel_execution.push_back(current_pe);
+  uint8_t current_pe = driver_frames.back().pe;
 
-  CilkSanImpl.push_stack_frame((uintptr_t)bp, (uintptr_t)sp);
+  // Enter a checked region if this function is selected by CILKSAN_ONLY.
+  bool selected = is_checked_func(func_id);
+  if (selected)
+    ++checked_region_depth;
 
   if (!prop.may_spawn && CilkSanImpl.is_local_synced()) {
-    spbags_frame_skipped.push_back(true);
     // Ignore entry calls into non-Cilk functions when the parent frame is
     // synced.
+    push_driver_frame({current_pe, current_pe, switched, true, selected});
     enable_instrumentation();
     return;
   }
-  spbags_frame_skipped.push_back(false);
+  push_driver_frame({current_pe, current_pe, switched, false, selected});
 
   // Update the tool for entering a Cilk function.
   CilkSanImpl.do_enter(prop.num_sync_reg);
@@ -318,6 +505,7 @@ CILKSAN_API void __csan_func_exit(const csi_id_t func_exit_id,
 
   if (!should_check())
     return;
+  ENTER_HOOK(HOOK_FUNCTION, PHASE_HOOK);
 
 #if CILKSAN_DEBUG
   const csan_source_loc_t *srcloc = __csan_get_func_exit_source_loc(func_exit_id);
@@ -326,7 +514,8 @@ CILKSAN_API void __csan_func_exit(const csi_id_t func_exit_id,
             func_exit_id, func_id, srcloc->name, srcloc->filename,
             srcloc->line_number);
 
-  if (!spbags_frame_skipped.back()) {
+  DriverFrame_t frame = driver_frames.back();
+  if (!frame.spbags_skipped) {
     // Update the tool for leaving a Cilk function.
     //
     // NOTE: Technically the sync region that would synchronize any orphaned
@@ -334,20 +523,15 @@ CILKSAN_API void __csan_func_exit(const csi_id_t func_exit_id,
     // programs.
     CilkSanImpl.do_leave(0);
   }
-  spbags_frame_skipped.pop();
-
-  // Pop both local copies of the parallel-execution state.
-  parallel_execution.pop();
-  parallel_execution.pop();
+  if (frame.selected)
+    --checked_region_depth;
+  pop_driver_frame();
 
   CilkSanImpl.pop_stack_frame();
 
-  if (switched_stack.back()) {
+  if (frame.switched_stack)
     // We switched stacks upon entering this function.  Now switch back.
-    stack_high_addr = uncilkified_stack_high_addr;
-    stack_low_addr = uncilkified_stack_low_addr;
-  }
-  switched_stack.pop();
+    restore_switched_stack();
 }
 
 // Hook called just before executing a loop.
@@ -359,6 +543,7 @@ CILKSAN_API void __csan_before_loop(const csi_id_t loop_id,
 
   if (!should_check())
     return;
+  ENTER_HOOK(HOOK_PARALLEL, PHASE_HOOK);
 
   DBG_TRACE(CALLBACK, "__csan_before_loop(%ld)\n", loop_id);
 
@@ -368,13 +553,11 @@ CILKSAN_API void __csan_before_loop(const csi_id_t loop_id,
 
   // Push the parallel loop onto the call stack.
   CilkSanImpl.record_call(loop_id, LOOP);
+  record_region_event(FP_LOOP, loop_id);
 
-  // Propagate the parallel-execution state to the child.
-  uint8_t current_pe = parallel_execution.back();
-  // First push the pe value on function entry.
-  parallel_execution.push_back(current_pe);
-  // Push an extra copy to the head, to be updated aggressively due to detaches.
-  parallel_execution.push_back(current_pe);
+  // Propagate the parallel-execution state to the loop.
+  uint8_t current_pe = driver_frames.back().pe;
+  push_driver_frame({current_pe, current_pe, false, false});
 
   CilkSanImpl.do_loop_begin();
 }
@@ -388,14 +571,14 @@ CILKSAN_API void __csan_after_loop(const csi_id_t loop_id,
 
   if (!should_check())
     return;
+  ENTER_HOOK(HOOK_PARALLEL, PHASE_HOOK);
 
   DBG_TRACE(CALLBACK, "__csan_after_loop(%ld)\n", loop_id);
 
   CilkSanImpl.do_loop_end(sync_reg);
 
   // Pop the parallel-execution state.
-  parallel_execution.pop();
-  parallel_execution.pop();
+  pop_driver_frame();
 
   // Pop the call off of the call stack.
   CilkSanImpl.record_call_return(loop_id, LOOP);
@@ -421,6 +604,7 @@ CILKSAN_API void __csan_before_call(const csi_id_t call_id,
 
   // Push the call onto the call stack.
   CilkSanImpl.record_call(call_id, CALL);
+  record_region_event(FP_CALL, call_id);
 }
 
 // Hook called upon returning from a function call.
@@ -444,6 +628,20 @@ CILKSAN_API void __csan_after_call(const csi_id_t call_id,
   CilkSanImpl.record_call_return(call_id, CALL);
 }
 
+// Ranges of memory that the program has unmapped, but whose shadow memory has
+// not been cleared yet.  Cilksan only checks and updates shadow memory during
+// parallel execution, so munmap in serial code defers clearing the shadow
+// memory of the unmapped range until the next spawn.
+static IntervalSet_t pending_unmaps;
+
+// Clear the shadow memory of all ranges in pending_unmaps.
+static void flush_pending_unmaps() {
+  CheckingRAII nocheck;
+  for (const auto &range : pending_unmaps)
+    CilkSanImpl.clear_shadow_memory(range.first, range.second - range.first);
+  pending_unmaps.clear();
+}
+
 // Hook called when spawning a new task.
 //
 // NOTE: When the bitcode ABI is used, inlining calls to __csan_detach() and
@@ -454,6 +652,7 @@ __csan_detach(const csi_id_t detach_id, const unsigned sync_reg,
               const detach_prop_t prop) {
   if (!should_check())
     return;
+  ENTER_HOOK(HOOK_PARALLEL, PHASE_HOOK);
 
   DBG_TRACE(CALLBACK, "__csan_detach(%ld)\n", detach_id);
   WHEN_CILKSAN_DEBUG(cilksan_assert(last_event == NONE));
@@ -463,9 +662,14 @@ __csan_detach(const csi_id_t detach_id, const unsigned sync_reg,
   if (__builtin_expect(!spawn_pc[detach_id], false))
     spawn_pc[detach_id] = CALLERPC;
 
+  // Clear the shadow memory of ranges unmapped during serial execution.
+  if (__builtin_expect(!pending_unmaps.empty(), false))
+    flush_pending_unmaps();
+
   // Update the parallel-execution state to reflect this detach.  Essentially,
   // this notes the change of peer sets.
-  parallel_execution.back() = 1;
+  set_parallel_execution(1);
+  record_region_event(FP_DETACH, detach_id);
 
   if (!prop.for_tapir_loop_body)
     // Push the detach onto the call stack.
@@ -483,42 +687,30 @@ __csan_task(const csi_id_t task_id, const csi_id_t detach_id,
             __attribute__((noescape)) const void *sp, const task_prop_t prop) {
   if (!should_check())
     return;
+  ENTER_HOOK(HOOK_PARALLEL, PHASE_HOOK);
 
-  // Update the low address of the stack
-  if (stack_low_addr > (uintptr_t)sp) {
-    // Try to detect stack switching by comparing the current stack and base
-    // pointers to their previous values.
-    if (stack_low_addr - (uintptr_t)sp > DEFAULT_STACK_SIZE) {
-      // It looks like we have switched stacks to start executing Cilk code.
-      handle_stack_switch((uintptr_t)bp, (uintptr_t)sp);
-      switched_stack.push_back(1);
-      if ((uintptr_t)bp - (uintptr_t)sp > DEFAULT_STACK_SIZE)
-        bp = sp;
-    } else {
-      stack_low_addr = (uintptr_t)sp;
-      switched_stack.push_back(0);
-    }
-  } else {
-    switched_stack.push_back(0);
-  }
+  // Update the range of the stack, and detect stack switching.
+  uintptr_t frame_bp = (uintptr_t)bp;
+  bool switched = detect_stack_switch(frame_bp, (uintptr_t)sp);
 
   DBG_TRACE(CALLBACK, "__csan_task(%ld, %ld, %d)\n", task_id, detach_id,
             prop.is_tapir_loop_body);
   WHEN_CILKSAN_DEBUG(last_event = NONE);
 
-  CilkSanImpl.push_stack_frame((uintptr_t)bp, (uintptr_t)sp);
+  CilkSanImpl.push_stack_frame(frame_bp, (uintptr_t)sp);
 
   if (prop.is_tapir_loop_body && CilkSanImpl.handle_loop()) {
+    // A loop iteration shares the parallel-execution state of its loop, so
+    // copy that state here and copy it back when the iteration ends.
+    DriverFrame_t loop = driver_frames.back();
+    push_driver_frame({loop.entry_pe, loop.pe, switched, false});
     CilkSanImpl.do_loop_iteration_begin(prop.num_sync_reg);
     return;
   }
 
   // Propagate the parallel-execution state to the child.
-  uint8_t current_pe = parallel_execution.back();
-  // Push the pe value on function entry.
-  parallel_execution.push_back(current_pe);
-  // Push a second copy to update aggressively on detaches.
-  parallel_execution.push_back(current_pe);
+  uint8_t current_pe = driver_frames.back().pe;
+  push_driver_frame({current_pe, current_pe, switched, false});
 
   // Update tool for entering detach-helper function and performing detach.
   CilkSanImpl.do_enter_helper(prop.num_sync_reg);
@@ -536,32 +728,34 @@ __csan_task_exit(const csi_id_t task_exit_id, const csi_id_t task_id,
                  const task_exit_prop_t prop) {
   if (!should_check())
     return;
+  ENTER_HOOK(HOOK_PARALLEL, PHASE_HOOK);
 
   DBG_TRACE(CALLBACK, "__csan_task_exit(%ld, %ld, %ld, %d, %d)\n", task_exit_id,
             task_id, detach_id, sync_reg, prop.is_tapir_loop_body);
 
+  bool switched = driver_frames.back().switched_stack;
   if (prop.is_tapir_loop_body && CilkSanImpl.handle_loop()) {
     // Update tool for leaving the parallel iteration.
     CilkSanImpl.do_loop_iteration_end();
 
-    // The parallel-execution state will be popped when the loop terminates.
+    // Copy the parallel-execution state back to the loop, which pops its state
+    // when it terminates.
+    uint8_t iteration_pe = driver_frames.back().pe;
+    pop_driver_frame();
+    set_parallel_execution(iteration_pe);
   } else {
     // Update tool for leaving a detach-helper function.
     CilkSanImpl.do_leave(sync_reg);
 
     // Pop the parallel-execution state.
-    parallel_execution.pop();
-    parallel_execution.pop();
+    pop_driver_frame();
   }
 
   CilkSanImpl.pop_stack_frame();
 
-  if (switched_stack.back()) {
+  if (switched)
     // We switched stacks upon entering this function.  Now switch back.
-    stack_high_addr = uncilkified_stack_high_addr;
-    stack_low_addr = uncilkified_stack_low_addr;
-  }
-  switched_stack.pop();
+    restore_switched_stack();
 }
 
 // Hook called at the continuation of a detach, i.e., a task spawn.
@@ -575,6 +769,7 @@ __csan_detach_continue(const csi_id_t detach_continue_id,
                        const detach_continue_prop_t prop) {
   if (!should_check())
     return;
+  ENTER_HOOK(HOOK_PARALLEL, PHASE_HOOK);
 
   DBG_TRACE(CALLBACK, "__csan_detach_continue(%ld)\n", detach_id);
 
@@ -599,14 +794,16 @@ CILKSAN_API void __csan_sync(csi_id_t sync_id, const unsigned sync_reg) {
 
   if (!should_check())
     return;
+  ENTER_HOOK(HOOK_PARALLEL, PHASE_HOOK);
 
   // Because this is a serial tool, we can safely perform all operations related
   // to a sync.
   CilkSanImpl.do_sync(sync_reg);
+  record_region_event(FP_SYNC, sync_id);
 
   // Restore the parallel-execution state to that of the function/task entry.
   if (CilkSanImpl.is_local_synced()) {
-    parallel_execution.back() = parallel_execution.from_back(1);
+    set_parallel_execution(driver_frames.back().entry_pe);
   }
 }
 
@@ -621,6 +818,13 @@ CILKSAN_API void __csan_sync(csi_id_t sync_id, const unsigned sync_reg) {
 CILKSAN_API
 void __csan_load(csi_id_t load_id, const void *addr, int32_t size,
                  load_prop_t prop) {
+  // Test the parallel-execution state first, so that accesses in serial
+  // phases of the program return quickly.
+  if (!is_execution_parallel()) {
+    DBG_TRACE(MEMORY, "SKIP %s read (%p, %ld) during serial execution\n",
+              __FUNCTION__, addr, size);
+    return;
+  }
   if (!CILKSAN_INITIALIZED)
     return;
 
@@ -628,12 +832,14 @@ void __csan_load(csi_id_t load_id, const void *addr, int32_t size,
     DBG_TRACE(MEMORY, "SKIP %s read (%p, %ld)\n", __FUNCTION__, addr, size);
     return;
   }
-  if (!is_execution_parallel()) {
-    DBG_TRACE(MEMORY, "SKIP %s read (%p, %ld) during serial execution\n",
-              __FUNCTION__, addr, size);
+  if (is_suppressed(suppressed_load_ids, load_id)) {
+    DBG_TRACE(MEMORY, "SKIP %s read (%p, %ld) suppressed\n", __FUNCTION__, addr,
+              size);
     return;
   }
 
+  ENTER_HOOK(HOOK_MEMORY, PHASE_HOOK);
+
   // Record the address of this load.
   if (__builtin_expect(!load_pc[load_id], false))
     load_pc[load_id] = CALLERPC;
@@ -661,6 +867,11 @@ void __csan_load(csi_id_t load_id, const void *addr, int32_t size,
 CILKSAN_API
 void __csan_large_load(csi_id_t load_id, const void *addr, size_t size,
                        load_prop_t prop) {
+  if (!is_execution_parallel()) {
+    DBG_TRACE(MEMORY, "SKIP %s read (%p, %ld) during serial execution\n",
+              __FUNCTION__, addr, size);
+    return;
+  }
   if (!CILKSAN_INITIALIZED)
     return;
 
@@ -668,12 +879,14 @@ void __csan_large_load(csi_id_t load_id, const void *addr, size_t size,
     DBG_TRACE(MEMORY, "SKIP %s read (%p, %ld)\n", __FUNCTION__, addr, size);
     return;
   }
-  if (!is_execution_parallel()) {
-    DBG_TRACE(MEMORY, "SKIP %s read (%p, %ld) during serial execution\n",
-              __FUNCTION__, addr, size);
+  if (is_suppressed(suppressed_load_ids, load_id)) {
+    DBG_TRACE(MEMORY, "SKIP %s read (%p, %ld) suppressed\n", __FUNCTION__, addr,
+              size);
     return;
   }
 
+  ENTER_HOOK(HOOK_MEMORY, PHASE_HOOK);
+
   // Record the address of this load.
   if (__builtin_expect(!load_pc[load_id], false))
     load_pc[load_id] = CALLERPC;
@@ -701,6 +914,11 @@ void __csan_large_load(csi_id_t load_id, const void *addr, size_t size,
 CILKSAN_API
 void __csan_store(csi_id_t store_id, const void *addr, int32_t size,
                   store_prop_t prop) {
+  if (!is_execution_parallel()) {
+    DBG_TRACE(MEMORY, "SKIP %s wrote (%p, %ld) during serial execution\n",
+              __FUNCTION__, addr, size);
+    return;
+  }
   if (!CILKSAN_INITIALIZED)
     return;
 
@@ -708,12 +926,14 @@ void __csan_store(csi_id_t store_id, const void *addr, int32_t size,
     DBG_TRACE(MEMORY, "SKIP %s wrote (%p, %ld)\n", __FUNCTION__, addr, size);
     return;
   }
-  if (!is_execution_parallel()) {
-    DBG_TRACE(MEMORY, "SKIP %s wrote (%p, %ld) during serial execution\n",
-              __FUNCTION__, addr, size);
+  if (is_suppressed(suppressed_store_ids, store_id)) {
+    DBG_TRACE(MEMORY, "SKIP %s wrote (%p, %ld) suppressed\n", __FUNCTION__, addr,
+              size);
     return;
   }
 
+  ENTER_HOOK(HOOK_MEMORY, PHASE_HOOK);
+
   // Record the address of this store.
   if (__builtin_expect(!store_pc[store_id], false))
     store_pc[store_id] = CALLERPC;
@@ -741,6 +961,11 @@ void __csan_store(csi_id_t store_id, const void *addr, int32_t size,
 CILKSAN_API
 void __csan_large_store(csi_id_t store_id, const void *addr, size_t size,
                         store_prop_t prop) {
+  if (!is_execution_parallel()) {
+    DBG_TRACE(MEMORY, "SKIP %s wrote (%p, %ld) during serial execution\n",
+              __FUNCTION__, addr, size);
+    return;
+  }
   if (!CILKSAN_INITIALIZED)
     return;
 
@@ -748,12 +973,14 @@ void __csan_large_store(csi_id_t store_id, const void *addr, size_t size,
     DBG_TRACE(MEMORY, "SKIP %s wrote (%p, %ld)\n", __FUNCTION__, addr, size);
     return;
   }
-  if (!is_execution_parallel()) {
-    DBG_TRACE(MEMORY, "SKIP %s wrote (%p, %ld) during serial execution\n",
-              __FUNCTION__, addr, size);
+  if (is_suppressed(suppressed_store_ids, store_id)) {
+    DBG_TRACE(MEMORY, "SKIP %s wrote (%p, %ld) suppressed\n", __FUNCTION__, addr,
+              size);
     return;
   }
 
+  ENTER_HOOK(HOOK_MEMORY, PHASE_HOOK);
+
   // Record the address of this store.
   if (__builtin_expect(!store_pc[store_id], false))
     store_pc[store_id] = CALLERPC;
@@ -797,10 +1024,12 @@ void __csi_after_alloca(const csi_id_t alloca_id, const void *addr,
   DBG_TRACE(CALLBACK, "__csi_after_alloca(%ld, %p, %ld)\n", alloca_id, addr,
             size);
 
+  // Extend the current stack frame to include the allocation first, since
+  // doing so may clear stale shadow memory for that part of the stack.
+  CilkSanImpl.advance_stack_frame((uintptr_t)addr);
   // Record the alloca and clear the allocated portion of the shadow memory.
   CilkSanImpl.record_alloc((size_t) addr, size, 2 * alloca_id);
   CilkSanImpl.clear_shadow_memory((size_t)addr, size);
-  CilkSanImpl.advance_stack_frame((uintptr_t)addr);
 }
 
 CILKSAN_API
@@ -831,6 +1060,9 @@ void __csan_after_allocfn(const csi_id_t allocfn_id,
   // -- then update the memory at the old address as if it was freed.
   if (oldaddr) {
     const size_t *size = CilkSanImpl.malloc_sizes.get((uintptr_t)oldaddr);
+    const bool has_old_size = (size != nullptr);
+    // Copy the old size, since inserting into malloc_sizes may move it.
+    const size_t old_size = has_old_size ? *size : 0;
     if (oldaddr != addr) {
       if (new_size > 0) {
         // Record the new allocation.
@@ -839,21 +1071,20 @@ void __csan_after_allocfn(const csi_id_t allocfn_id,
         CilkSanImpl.malloc_sizes.insert((uintptr_t)addr, new_size);
       }
 
-      if (CilkSanImpl.malloc_sizes.contains((uintptr_t)oldaddr)) {
+      if (has_old_size) {
         if (!should_check() || !is_execution_parallel()) {
-          CilkSanImpl.clear_alloc((size_t)oldaddr, *size);
-          CilkSanImpl.clear_shadow_memory((size_t)oldaddr, *size);
+          CilkSanImpl.clear_alloc((size_t)oldaddr, old_size);
+          CilkSanImpl.clear_shadow_memory((size_t)oldaddr, old_size);
         } else {
           // Take note of the freeing of the old memory.
-          CilkSanImpl.record_free((uintptr_t)oldaddr, *size, allocfn_id,
+          CilkSanImpl.record_free((uintptr_t)oldaddr, old_size, allocfn_id,
                                   MAType_t::REALLOC);
         }
         CilkSanImpl.malloc_sizes.remove((uintptr_t)oldaddr);
       }
     } else {
       // We're simply adjusting the allocation at the same place.
-      if (CilkSanImpl.malloc_sizes.contains((uintptr_t)oldaddr)) {
-        size_t old_size = *size;
+      if (has_old_size) {
         if (old_size < new_size) {
           CilkSanImpl.clear_shadow_memory((size_t)addr + old_size,
                                           new_size - old_size);
@@ -1106,6 +1337,19 @@ CILKSAN_API void __cilksan_record_free(void *ptr) {
 
 static std::map<uintptr_t, size_t> pages_to_clear;
 
+// Record that the program unmapped [start, start+len).  Shadow pages that lie
+// entirely within unmapped memory are freed immediately, and the rest of the
+// shadow memory for the range is cleared lazily.
+static void record_unmap(uintptr_t start, size_t len) {
+  CheckingRAII nocheck;
+  // Merging with adjacent unmapped ranges can cover whole shadow pages that no
+  // single unmapping covers.
+  auto range = pending_unmaps.insert(start, start + len);
+  CilkSanImpl.drop_shadow_pages(range.first, range.second - range.first);
+  if (driver_frames.back().pe)
+    flush_pending_unmaps();
+}
+
 // Flag to manage initialization of memory functions.  We need this flag because
 // dlsym uses some of the memory functions we are trying to interpose, which
 // means that calling dlsym directly will lead to infinite recursion and a
@@ -1319,10 +1563,19 @@ void *mmap(void *start, size_t len, int prot, int flags, int fd, off_t offset) {
   void *r = real_mmap(start, len, prot, flags, fd, offset);
   enable_checking();
 
+  if (r != MAP_FAILED)
+    stack_registry.mapped((uintptr_t)r, (uintptr_t)r + len);
+#if defined(MAP_STACK)
+  // Register new stacks, such as fiber stacks for Cilk workers.
+  if ((flags & MAP_STACK) && r != MAP_FAILED)
+    stack_registry.add((uintptr_t)r, (uintptr_t)r + len);
+#endif // defined(MAP_STACK)
+
   if (CILKSAN_INITIALIZED && should_check()) {
     CheckingRAII nocheck;
     CilkSanImpl.record_alloc((size_t)r, len, 0);
     CilkSanImpl.clear_shadow_memory((size_t)r, len);
+    pending_unmaps.erase((uintptr_t)r, (uintptr_t)r + len);
     pages_to_clear.insert({(uintptr_t)r, len});
     if (!(flags & MAP_ANONYMOUS))
       // This mmap is backed by a file.  Initialize the shadow memory with a
@@ -1347,10 +1600,19 @@ void *mmap64(void *start, size_t len, int prot, int flags, int fd, off64_t offse
   void *r = real_mmap64(start, len, prot, flags, fd, offset);
   enable_checking();
 
+  if (r != MAP_FAILED)
+    stack_registry.mapped((uintptr_t)r, (uintptr_t)r + len);
+#if defined(MAP_STACK)
+  // Register new stacks, such as fiber stacks for Cilk workers.
+  if ((flags & MAP_STACK) && r != MAP_FAILED)
+    stack_registry.add((uintptr_t)r, (uintptr_t)r + len);
+#endif // defined(MAP_STACK)
+
   if (CILKSAN_INITIALIZED && should_check()) {
     CheckingRAII nocheck;
     CilkSanImpl.record_alloc((size_t)r, len, 0);
     CilkSanImpl.clear_shadow_memory((size_t)r, len);
+    pending_unmaps.erase((uintptr_t)r, (uintptr_t)r + len);
     pages_to_clear.insert({(uintptr_t)r, len});
     if (!(flags & MAP_ANONYMOUS))
       // This mmap is backed by a file.  Initialize the shadow memory with a
@@ -1375,20 +1637,20 @@ int munmap(void *start, size_t len) {
   int result = real_munmap(start, len);
   enable_checking();
 
+  if (0 == result)
+    stack_registry.remove((uintptr_t)start, (uintptr_t)start + len);
+
   if (CILKSAN_INITIALIZED && should_check() && (0 == result)) {
     CheckingRAII nocheck;
     auto first_page = pages_to_clear.lower_bound((uintptr_t)start);
     auto last_page = pages_to_clear.upper_bound((uintptr_t)start + len);
-    for (auto curr_page = first_page; curr_page != last_page; ++curr_page) {
-      // TODO: Treat munmap more like free and record a write operation on the
-      // page.  Need to take care only to write pages that have content in the
-      // shadow memory.  Otherwise, if the application mmap's more virtual
-      // memory than physical memory, then the writes that model page unmapping
-      // can blow out physical memory.
-      CilkSanImpl.clear_shadow_memory((size_t)curr_page->first, curr_page->second);
-      // CilkSanImpl.do_write(UNKNOWN_CSI_ID, curr_page->first, curr_page->second);
-    }
     pages_to_clear.erase(first_page, last_page);
+    // TODO: Treat munmap more like free and record a write operation on the
+    // page.  Need to take care only to write pages that have content in the
+    // shadow memory.  Otherwise, if the application mmap's more virtual memory
+    // than physical memory, then the writes that model page unmapping can blow
+    // out physical memory.
+    record_unmap((uintptr_t)start, len);
   }
 
   return result;
@@ -1417,22 +1679,24 @@ void *mremap(void *start, size_t old_len, size_t len, int flags, ...) {
 #endif // defined(MREMAP_FIXED)
   enable_checking();
 
-  if (CILKSAN_INITIALIZED && should_check()) {
+  if (r != MAP_FAILED)
+    stack_registry.mapped((uintptr_t)r, (uintptr_t)r + len);
+
+  if (CILKSAN_INITIALIZED && should_check() && r != MAP_FAILED) {
     CheckingRAII nocheck;
     auto iter = pages_to_clear.find((uintptr_t)start);
-    if (iter != pages_to_clear.end()) {
-      // TODO: Treat mremap more like free and record a write operation on the
-      // page.  Need to take care only to write pages that have content in the
-      // shadow memory.  Otherwise, if the application mmap's more virtual
-      // memory than physical memory, then the writes that model page unmapping
-      // can blow out physical memory.
-      CilkSanImpl.clear_shadow_memory((size_t)iter->first, iter->second);
-      // cilksan_do_write(UNKNOWN_CSI_ID, iter->first, iter->second);
+    if (iter != pages_to_clear.end())
       pages_to_clear.erase(iter);
-    }
+    // TODO: Treat mremap more like free and record a write operation on the
+    // page.  Need to take care only to write pages that have content in the
+    // shadow memory.  Otherwise, if the application mmap's more virtual memory
+    // than physical memory, then the writes that model page unmapping can blow
+    // out physical memory.
+    record_unmap((uintptr_t)start, old_len);
     // Record the new mapping.
     CilkSanImpl.record_alloc((size_t)r, len, 0);
     CilkSanImpl.clear_shadow_memory((size_t)r, len);
+    pending_unmaps.erase((uintptr_t)r, (uintptr_t)r + len);
     pages_to_clear.insert({(uintptr_t)r, len});
   }
 
@@ -3,8 +3,11 @@
 #define __DRIVER_H__
 
 #include "cilksan_internal.h"
+#include "id_table.h"
 #include "locksets.h"
+#include "profiler.h"
 #include "stack.h"
+#include "stats.h"
 #include <csi/csi.h>
 #include <cstdint>
 #include <utility>
@@ -30,9 +33,15 @@
 // FILE io used to print error messages
 extern FILE *err_io;
 
+// Helper macro to measure and tag the tool phase of the rest of a hook.
+#define ENTER_HOOK(category, phase)                                            \
+  HookTimer_t hook_timer(category);                                            \
+  PhaseRAII_t hook_phase(phase, CALLERPC)
+
 #define START_HOOK(call_id)                                                    \
   if (!CILKSAN_INITIALIZED || !should_check())                                 \
     return;                                                                    \
+  ENTER_HOOK(HOOK_LIBRARY, PHASE_LIBHOOK);                                     \
   if (__builtin_expect(!call_pc[call_id], false))                              \
     call_pc[call_id] = CALLERPC;                                               \
   do {                                                                         \
@@ -54,15 +63,15 @@ extern FILE *err_io;
 extern CilkSanImpl_t CilkSanImpl;
 
 // Defined in print_addr.cpp
-extern uintptr_t *call_pc;
-extern uintptr_t *spawn_pc;
-extern uintptr_t *loop_pc;
-extern uintptr_t *load_pc;
-extern uintptr_t *store_pc;
-extern uintptr_t *alloca_pc;
-extern uintptr_t *allocfn_pc;
-extern allocfn_prop_t *allocfn_prop;
-extern uintptr_t *free_pc;
+extern PCTable_t call_pc;
+extern PCTable_t spawn_pc;
+extern PCTable_t loop_pc;
+extern PCTable_t load_pc;
+extern PCTable_t store_pc;
+extern PCTable_t alloca_pc;
+extern PCTable_t allocfn_pc;
+extern AllocFnPropTable_t allocfn_prop;
+extern PCTable_t free_pc;
 
 // Flag to track whether Cilksan is initialized.
 extern bool CILKSAN_INITIALIZED;
@@ -90,10 +99,41 @@ __attribute__((always_inline)) static inline bool should_check() {
   return (instrumentation && (checking_disabled == 0));
 }
 
-extern Stack_t<uint8_t> parallel_execution;
+// State the driver maintains for each function, task, and parallel loop being
+// executed.  The driver keeps a single stack of these records, so entering and
+// exiting a frame pushes and pops one small record.
+struct DriverFrame_t {
+  // Parallel-execution state on entry to the frame, restored at syncs.
+  uint8_t entry_pe;
+  // Current parallel-execution state, i.e., whether there are any unsynced
+  // spawns in the program execution.  Updated aggressively on detaches.
+  uint8_t pe;
+  // Whether a stack switch occurred upon entering the frame.
+  bool switched_stack;
+  // Whether the tool skipped updating the SP-bags for this frame.
+  bool spbags_skipped;
+  // Whether the frame is a function selected by CILKSAN_ONLY.
+  bool selected = false;
+};
+extern Stack_t<DriverFrame_t> driver_frames;
+
+// Parallel-execution state of the current driver frame, kept in a single global
+// flag so that hooks can test it with one load.  Hooks for loads and stores test
+// this flag first, so they cost little while the program runs serially, e.g.,
+// before its first spawn and after its final sync.
+extern bool parallel_execution;
 
 __attribute__((always_inline)) static inline bool is_execution_parallel() {
-  return parallel_execution.back();
+  return parallel_execution;
+}
+
+// Parallel-execution state of the current driver frame, regardless of whether
+// Cilksan checks accesses in the current context.  Lock operations must be
+// recorded whenever the execution is parallel, even outside of selected
+// functions, checked regions, or checked executions of repeated regions, so
+// that accesses in checked contexts see every lock the program holds.
+__attribute__((always_inline)) static inline bool is_parallel_for_locks() {
+  return driver_frames.back().pe;
 }
 
 // Stack structures for keeping track of MAAP (May Access Alias in Parallel)
@@ -27,7 +27,7 @@ public:
   // An entry in the hash table.
   struct bucket {
     uintptr_t key = KEY_EMPTY; /* EMPTY, DELETED, or a user-provided pointer. */
-    index_t hash = 0; /* hash of the key when inserted into the table. */
+    index_t hash = 0; /* hash of the key, computed once on first insert. */
     reducer_base value;
 
     void make_tombstone() { key = KEY_DELETED; }
@@ -53,9 +53,9 @@ private:
     return (v & low_mask) ^ (v >> half_bits);
   }
 
-  static inline index_t get_table_entry(int32_t capacity, uintptr_t key) {
+  static inline index_t get_table_entry(int32_t capacity, index_t hash) {
     // Assumes capacity is a power of 2.
-    return hash(key) & (capacity - 1);
+    return hash & (capacity - 1);
   }
 
   static inline index_t inc_index(index_t i, index_t capacity) {
@@ -212,7 +212,19 @@ private:
     return buckets;
   }
 
-  // Rebuild the table with the specified capacity.
+  // Returns the smallest capacity that holds the given occupancy without being
+  // overloaded.
+  static int32_t capacity_for(int32_t occupancy) {
+    int32_t new_capacity = MIN_CAPACITY;
+    while (new_capacity < MIN_HT_CAPACITY ? occupancy > new_capacity
+                                          : is_overloaded(occupancy,
+                                                          new_capacity))
+      new_capacity *= 2;
+    return new_capacity;
+  }
+
+  // Rebuild the table with the specified capacity.  Buckets keep their stored
+  // hashes, so rebuilding does not rehash any keys.
   bucket *rebuild(int32_t new_capacity) {
     bucket *old_buckets = buckets;
     int32_t old_capacity = capacity;
@@ -227,7 +239,7 @@ private:
 
     for (int32_t i = 0; i < old_capacity; ++i) {
       if (is_valid(old_buckets[i].key)) {
-        bool success = insert(old_buckets[i]);
+        bool success = insert_hashed(old_buckets[i]);
         assert(success && "Failed to insert when resizing table.");
         (void)success;
       }
@@ -250,11 +262,11 @@ private:
     return nullptr;
   }
 
-  bucket *find_hash(uintptr_t key) const {
+  bucket *find_hash(uintptr_t key, index_t key_hash) const {
     int32_t capacity = this->capacity;
 
     // Target hash
-    index_t tgt = get_table_entry(capacity, key);
+    index_t tgt = get_table_entry(capacity, key_hash);
     bucket *buckets = this->buckets;
     // Start the probe at the target hash
     index_t i = tgt;
@@ -276,7 +288,7 @@ private:
       }
 
       // Otherwise, buckets[i] is another valid key that does not match.
-      index_t curr_hash = buckets[i].hash;
+      index_t curr_hash = get_table_entry(capacity, buckets[i].hash);
 
       if (continue_probe(tgt, curr_hash, i)) {
         i = inc_index(i, capacity);
@@ -307,13 +319,37 @@ public:
     if (capacity < MIN_HT_CAPACITY) {
         return find_linear(key);
     } else {
-        return find_hash(key);
+        return find_hash(key, hash(key));
     }
   }
 
   // Insert the given bucket into the table.  Might move other buckets around
   // inside the table or cause the table to be rebuilt.
   bool insert(bucket b) {
+    b.hash = hash(b.key);
+    return insert_hashed(b);
+  }
+
+  // Grow the table, if necessary, so that it can hold the given number of
+  // buckets without being rebuilt.
+  void reserve(int32_t num_buckets) {
+    int32_t new_capacity = capacity_for(num_buckets);
+    if (new_capacity > (int32_t)capacity)
+      rebuild(new_capacity);
+  }
+
+  // Returns a pointer to the bucket associated with key, whose hash is
+  // key_hash, if it exists, or nullptr if no bucket is associated with key.
+  bucket *find_hashed(uintptr_t key, index_t key_hash) const {
+    if (capacity < MIN_HT_CAPACITY)
+      return find_linear(key);
+    return find_hash(key, key_hash);
+  }
+
+  // Insert the given bucket, whose hash field already holds the hash of its
+  // key, into the table.  Might move other buckets around inside the table or
+  // cause the table to be rebuilt.
+  bool insert_hashed(bucket b) {
     int32_t capacity = this->capacity;
     bucket *buckets = this->buckets;
     if (capacity < MIN_HT_CAPACITY) {
@@ -350,8 +386,7 @@ public:
     }
 
     // Target hash
-    const index_t tgt = get_table_entry(capacity, b.key);
-    b.hash = tgt;
+    const index_t tgt = get_table_entry(capacity, b.hash);
 
     // If we find an empty entry, insert the bucket there.
     if (is_empty(buckets[tgt].key)) {
@@ -405,7 +440,8 @@ public:
         // Check if the hash at the end of this run of tombstones would
         // terminate the probe or if the probe has traversed the whole
         // table.
-        index_t tomb_end_hash = buckets[next_i].hash;
+        index_t tomb_end_hash =
+            get_table_entry(capacity, buckets[next_i].hash);
         if (next_i == probe_end ||
             !continue_probe(tgt, tomb_end_hash, next_i)) {
           // It's safe to insert b at the current tombstone.
@@ -424,7 +460,7 @@ public:
       // Otherwise this entry contains another valid key that does
       // not match.  Compare the hashes to decide whether or not to
       // continue the probe.
-      index_t curr_hash = buckets[i].hash;
+      index_t curr_hash = get_table_entry(capacity, buckets[i].hash);
       if (continue_probe(tgt, curr_hash, i)) {
         i = inc_index(i, capacity);
         continue;
@@ -0,0 +1,74 @@
+// -*- C++ -*-
+#ifndef __ID_TABLE_H__
+#define __ID_TABLE_H__
+
+#include <csi/csi.h>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include "debug_util.h"
+
+// Map from CSI ID to data, such as the PC of the instrumented instruction with
+// that ID.  Each instrumented unit adds a contiguous range of IDs to the table,
+// so the table is a two-level table of fixed-size chunks, similar to the FED
+// table index in csanrt.cpp.  Growing the table allocates new chunks as
+// needed, but never moves existing entries, so initializing many units takes
+// time proportional to the total number of IDs.  The index of chunks is a
+// fixed-size array, so looking up an entry takes just one more load than
+// indexing a flat array.
+//
+// New entries are initialized by filling them with copies of the byte
+// FILL_BYTE.
+template <typename DATA_T, uint8_t FILL_BYTE = 0> class IDTable_t {
+  static constexpr unsigned LG_CHUNK_SIZE = 14;
+  static constexpr unsigned LG_MAX_CHUNKS = 14;
+  static constexpr uint64_t CHUNK_SIZE = 1UL << LG_CHUNK_SIZE;
+  static constexpr uint64_t MAX_CHUNKS = 1UL << LG_MAX_CHUNKS;
+
+  DATA_T *Chunks[MAX_CHUNKS] = {nullptr};
+  // Number of entries in the allocated chunks.
+  uint64_t Capacity = 0;
+
+public:
+  __attribute__((always_inline)) DATA_T &operator[](csi_id_t id) {
+    return Chunks[id >> LG_CHUNK_SIZE][id & (CHUNK_SIZE - 1)];
+  }
+  __attribute__((always_inline)) const DATA_T &operator[](csi_id_t id) const {
+    return Chunks[id >> LG_CHUNK_SIZE][id & (CHUNK_SIZE - 1)];
+  }
+
+  // Ensure the table has entries for all IDs in [0, num_ids).
+  void grow(uint64_t num_ids) {
+    if (num_ids > MAX_CHUNKS * CHUNK_SIZE)
+      die("Too many CSI IDs for IDTable_t: %lu.\n", num_ids);
+    while (Capacity < num_ids) {
+      DATA_T *chunk;
+      if (FILL_BYTE == 0) {
+        chunk = (DATA_T *)calloc(CHUNK_SIZE, sizeof(DATA_T));
+      } else {
+        chunk = (DATA_T *)malloc(CHUNK_SIZE * sizeof(DATA_T));
+        memset(chunk, FILL_BYTE, CHUNK_SIZE * sizeof(DATA_T));
+      }
+      Chunks[Capacity >> LG_CHUNK_SIZE] = chunk;
+      Capacity += CHUNK_SIZE;
+    }
+  }
+
+  // Free all entries in the table.
+  void clear() {
+    for (uint64_t i = 0; i < (Capacity >> LG_CHUNK_SIZE); ++i) {
+      free(Chunks[i]);
+      Chunks[i] = nullptr;
+    }
+    Capacity = 0;
+  }
+};
+
+// Maps from CSI ID to program counter (PC), and from allocation-function ID to
+// the properties of that allocation function.  Properties with an allocfn_ty
+// of uint8_t(-1) have not been recorded yet.
+using PCTable_t = IDTable_t<uintptr_t>;
+using AllocFnPropTable_t = IDTable_t<allocfn_prop_t, 0xFF>;
+
+#endif // __ID_TABLE_H__
@@ -0,0 +1,72 @@
+// -*- C++ -*-
+#ifndef __INTERVAL_SET_H__
+#define __INTERVAL_SET_H__
+
+#include <cstdint>
+#include <iterator>
+#include <map>
+
+// Set of addresses represented as disjoint, nonadjacent half-open intervals
+// [start, end), keyed by their start addresses.  Inserting or erasing an
+// interval takes time logarithmic in the number of intervals in the set, plus
+// time proportional to the number of intervals it merges or removes.
+class IntervalSet_t {
+  std::map<uintptr_t, uintptr_t> Intervals;
+
+public:
+  using const_iterator = std::map<uintptr_t, uintptr_t>::const_iterator;
+
+  bool empty() const { return Intervals.empty(); }
+  const_iterator begin() const { return Intervals.begin(); }
+  const_iterator end() const { return Intervals.end(); }
+  void clear() { Intervals.clear(); }
+
+  // Add [start, end) to the set, merging it with any intervals it overlaps or
+  // abuts.  Returns the resulting interval containing [start, end).
+  std::pair<uintptr_t, uintptr_t> insert(uintptr_t start, uintptr_t end) {
+    if (end <= start)
+      return {start, start};
+
+    // Find the first interval that might overlap or abut [start, end).
+    auto iter = Intervals.upper_bound(start);
+    if (iter != Intervals.begin() && std::prev(iter)->second >= start)
+      --iter;
+
+    // Absorb all intervals that overlap or abut [start, end).
+    while (iter != Intervals.end() && iter->first <= end) {
+      if (iter->first < start)
+        start = iter->first;
+      if (iter->second > end)
+        end = iter->second;
+      iter = Intervals.erase(iter);
+    }
+    Intervals.emplace_hint(iter, start, end);
+    return {start, end};
+  }
+
+  // Remove [start, end) from the set, splitting intervals that it partially
+  // overlaps.
+  void erase(uintptr_t start, uintptr_t end) {
+    if (end <= start)
+      return;
+
+    auto iter = Intervals.upper_bound(start);
+    if (iter != Intervals.begin() && std::prev(iter)->second > start)
+      --iter;
+
+    while (iter != Intervals.end() && iter->first < end) {
+      uintptr_t iter_start = iter->first;
+      uintptr_t iter_end = iter->second;
+      iter = Intervals.erase(iter);
+      // Keep the parts of this interval outside of [start, end).
+      if (iter_start < start)
+        Intervals.emplace_hint(iter, iter_start, start);
+      if (iter_end > end) {
+        Intervals.emplace_hint(iter, end, iter_end);
+        break;
+      }
+    }
+  }
+};
+
+#endif // __INTERVAL_SET_H__
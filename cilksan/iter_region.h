@@ -0,0 +1,170 @@
+// -*- C++ -*-
+#ifndef __ITER_REGION_H__
+#define __ITER_REGION_H__
+
+#include <csi/csi.h>
+#include <cstdint>
+#include <cstdlib>
+#include <unordered_set>
+
+// Support for checking a repeated region of a program, such as an iteration of
+// an iterative solver, only when its behavior changes.  The program marks each
+// execution of the region with __cilksan_region_begin(id) and
+// __cilksan_region_end(id).  Cilksan fully checks the first executions of the
+// region, and it records a fingerprint of each execution: the set of
+// functions, call sites, spawns, syncs, and parallel loops the execution runs,
+// together with its approximate number of spawns.  Once Cilksan has checked a
+// number of consecutive executions, given by CILKSAN_REGION_CHECKS, without
+// seeing a new fingerprint, it skips checking later executions.  When a skipped
+// execution runs an event that no earlier execution ran, Cilksan starts
+// checking that execution immediately, and it checks the executions that
+// follow a new fingerprint.  The fingerprint does not include the memory
+// accesses an execution performs, so executions that run the same code on
+// different data share a fingerprint.  If CILKSAN_REGION_CHECKS is 0, Cilksan
+// checks no executions of the region.
+
+// Kinds of events included in the fingerprint of an execution of a region.
+enum FingerprintEvent_t : uint8_t {
+  FP_FUNC = 1,
+  FP_CALL,
+  FP_DETACH,
+  FP_SYNC,
+  FP_LOOP,
+};
+
+class IterRegion_t {
+  static constexpr unsigned LG_MIN_CAPACITY = 8;
+
+  // Events seen in executions of the region, each stamped with the number of
+  // the last execution that saw it.  Events are recorded in an
+  // open-addressing hash table with linear probing.
+  struct Entry_t {
+    uint64_t key;
+    uint64_t execution;
+  };
+  Entry_t *Events = nullptr;
+  unsigned LgCapacity = 0;
+  size_t NumEvents = 0;
+
+  // Fingerprints of all executions of the region so far.
+  std::unordered_set<uint64_t> Fingerprints;
+
+  // State of the current execution.
+  uint64_t Fingerprint = 0;
+  uint64_t NumDetaches = 0;
+  bool Checking = true;
+
+  // Number of consecutive executions to check after an execution with a new
+  // fingerprint, and number of further executions to check.
+  const unsigned Checks;
+  unsigned ChecksLeft;
+
+  static uint64_t mix(uint64_t x) {
+    x ^= x >> 31;
+    x *= 0xBF58476D1CE4E5B9UL;
+    x ^= x >> 29;
+    x *= 0x94D049BB133111EBUL;
+    x ^= x >> 32;
+    return x;
+  }
+
+  uintptr_t home(uint64_t key) const {
+    return (key * 0x9E3779B97F4A7C15UL) >> (64 - LgCapacity);
+  }
+
+  uintptr_t find(uint64_t key) const {
+    uintptr_t mask = (1UL << LgCapacity) - 1;
+    uintptr_t i = home(key);
+    while (Events[i].key && Events[i].key != key)
+      i = (i + 1) & mask;
+    return i;
+  }
+
+  void grow() {
+    Entry_t *OldEvents = Events;
+    unsigned OldLgCapacity = LgCapacity;
+    LgCapacity = OldEvents ? OldLgCapacity + 1 : LG_MIN_CAPACITY;
+    Events = (Entry_t *)calloc(1UL << LgCapacity, sizeof(Entry_t));
+    if (!OldEvents)
+      return;
+    for (uintptr_t i = 0; i < (1UL << OldLgCapacity); ++i)
+      if (OldEvents[i].key)
+        Events[find(OldEvents[i].key)] = OldEvents[i];
+    free(OldEvents);
+  }
+
+public:
+  const uint64_t Id;
+  // Number of executions of the region, and number of those executions that
+  // Cilksan checked.
+  uint64_t NumExecutions = 0;
+  uint64_t NumChecked = 0;
+
+  IterRegion_t(uint64_t id, unsigned checks)
+      : Checks(checks), ChecksLeft(checks), Id(id) {}
+  ~IterRegion_t() { free(Events); }
+
+  bool isChecking() const { return Checking; }
+
+  // Begin an execution of the region.  Returns true if Cilksan should check
+  // the execution.
+  bool begin() {
+    ++NumExecutions;
+    Fingerprint = 0;
+    NumDetaches = 0;
+    Checking = (ChecksLeft > 0);
+    if (Checking) {
+      --ChecksLeft;
+      ++NumChecked;
+    }
+    return Checking;
+  }
+
+  // Add an event to the fingerprint of the current execution.  Each distinct
+  // event contributes to the fingerprint once per execution.  Returns true if
+  // the event is new to the region and Cilksan should start checking the
+  // current execution.
+  __attribute__((always_inline)) bool record(FingerprintEvent_t event,
+                                             csi_id_t id) {
+    if (event == FP_DETACH)
+      ++NumDetaches;
+    uint64_t key = ((uint64_t)event << 56) | ((uint64_t)id & ((1UL << 56) - 1));
+    if (2 * (NumEvents + 1) > (Events ? (1UL << LgCapacity) : 0))
+      grow();
+    Entry_t &entry = Events[find(key)];
+    bool start_checking = false;
+    if (!entry.key) {
+      entry.key = key;
+      ++NumEvents;
+      // The behavior of the region changed, so check the rest of this
+      // execution, unless checking of the region is disabled.
+      if (!Checking && Checks) {
+        Checking = true;
+        ++NumChecked;
+        start_checking = true;
+      }
+    } else if (entry.execution == NumExecutions) {
+      return false;
+    }
+    entry.execution = NumExecutions;
+    Fingerprint ^= mix(key);
+    return start_checking;
+  }
+
+  // End an execution of the region.
+  void end() {
+    // Approximate the shape of the execution by the base-2 logarithm of its
+    // number of spawns.
+    uint64_t shape = NumDetaches ? (64 - __builtin_clzl(NumDetaches)) : 0;
+    uint64_t fingerprint = Fingerprint ^ mix(shape);
+    if (Fingerprints.insert(fingerprint).second) {
+      // The behavior of the region changed, so check the next executions.
+      unsigned remaining = Checking ? (Checks ? Checks - 1 : 0) : Checks;
+      if (ChecksLeft < remaining)
+        ChecksLeft = remaining;
+    }
+    Checking = true;
+  }
+};
+
+#endif // __ITER_REGION_H__
@@ -7,6 +7,7 @@
 #include <cstdlib>
 #include <cstring>
 #include <sys/stat.h>
+#include <type_traits>
 #include <utime.h>
 
 CILKSAN_API void __csan_default_libhook(const csi_id_t call_id,
@@ -66,15 +67,74 @@ using v8ptrs = vec_t<uintptr_t, 8>;
 using v16i8 = vec_t<int8_t, 16>;
 using v32i8 = vec_t<int8_t, 32>;
 
-template <typename VEC_T, unsigned NUM_ELS, typename MASK_T, MASK_T full_mask,
-          bool is_load>
+// Integer type of a mask with one bit for each of NUM_ELS vector lanes.
+template <unsigned NUM_ELS>
+using mask_t = typename std::conditional<
+    (NUM_ELS <= 8), uint8_t,
+    typename std::conditional<
+        (NUM_ELS <= 16), uint16_t,
+        typename std::conditional<(NUM_ELS <= 32), uint32_t,
+                                  uint64_t>::type>::type>::type;
+
+// Get the bits of mask for the NUM_ELS vector lanes.
+template <unsigned NUM_ELS>
+__attribute__((always_inline)) static uint64_t
+active_lanes(const mask_t<NUM_ELS> *mask) {
+  uint64_t bits = static_cast<uint64_t>(*mask);
+  if (NUM_ELS < 64)
+    bits &= ((uint64_t)(1) << (NUM_ELS % 64)) - 1;
+  return bits;
+}
+
+template <bool is_load>
+__attribute__((always_inline)) static void
+check_lanes(const csi_id_t call_id, MAAP_t MAAPVal, uintptr_t addr,
+            size_t len) {
+  if (is_load)
+    check_read_bytes(call_id, MAAPVal, addr, len);
+  else
+    check_write_bytes(call_id, MAAPVal, addr, len);
+}
+
+// Check the elements of type EL_T at addrs[i] for each active lane i in bits.
+// Coalesce the addresses of active lanes that access adjacent or repeated
+// elements, in either direction, and check each resulting range once.
+template <typename EL_T, bool is_load>
+__attribute__((always_inline)) static void
+check_gathered_lanes(const csi_id_t call_id, const uintptr_t *addrs,
+                     uint64_t bits) {
+  uintptr_t run_start = 0, run_end = 0;
+  while (bits) {
+    unsigned i = __builtin_ctzl(bits);
+    bits &= bits - 1;
+    uintptr_t addr = addrs[i];
+    if (addr >= run_start && addr + sizeof(EL_T) <= run_end)
+      continue;
+    if (addr == run_end && run_end != run_start) {
+      run_end += sizeof(EL_T);
+    } else if (addr + sizeof(EL_T) == run_start) {
+      run_start = addr;
+    } else {
+      if (run_end != run_start)
+        check_lanes<is_load>(call_id, MAAP_t::ModRef, run_start,
+                             run_end - run_start);
+      run_start = addr;
+      run_end = addr + sizeof(EL_T);
+    }
+  }
+  if (run_end != run_start)
+    check_lanes<is_load>(call_id, MAAP_t::ModRef, run_start,
+                         run_end - run_start);
+}
+
+template <typename VEC_T, bool is_load>
 __attribute__((always_inline)) static void
 generic_masked_load_store(const csi_id_t call_id, unsigned MAAP_count,
                           const call_prop_t prop, VEC_T *val, VEC_T *ptr,
-                          int32_t alignment, MASK_T *mask) {
+                          int32_t alignment,
+                          mask_t<VEC_T::NUM_ELEMENTS> *mask) {
   using EL_T = typename VEC_T::ELEMENT_T;
-  static_assert(NUM_ELS == VEC_T::NUM_ELEMENTS,
-                "Mismatch between vector size and num-elements parameter.");
+  constexpr unsigned NUM_ELS = VEC_T::NUM_ELEMENTS;
   static_assert(sizeof(VEC_T) == sizeof(EL_T) * NUM_ELS,
                 "Vector type has unexpected size.");
 
@@ -89,97 +149,29 @@ generic_masked_load_store(const csi_id_t call_id, unsigned MAAP_count,
   if (!is_execution_parallel())
     return;
 
-  if (*mask == full_mask) {
-    if (is_load)
-      check_read_bytes(call_id, ptr_MAAPVal, ptr, sizeof(VEC_T));
-    else
-      check_write_bytes(call_id, ptr_MAAPVal, ptr, sizeof(VEC_T));
-    return;
+  // Check each run of consecutive active lanes as one range of memory.  In
+  // particular, a full mask results in a single check of the whole vector.
+  uint64_t bits = active_lanes<NUM_ELS>(mask);
+  while (bits) {
+    unsigned first = __builtin_ctzl(bits);
+    uint64_t inactive = ~(bits >> first);
+    unsigned run = inactive ? __builtin_ctzl(inactive) : 64 - first;
+    check_lanes<is_load>(call_id, ptr_MAAPVal,
+                         (uintptr_t)(((EL_T *)ptr) + first),
+                         run * sizeof(EL_T));
+    if (first + run >= 64)
+      break;
+    bits &= ~(((uint64_t)(1) << (first + run)) - 1);
   }
-
-  for (unsigned i = 0; i < NUM_ELS; ++i)
-    if (*mask & (((MASK_T)(1) << i))) {
-      if (is_load)
-        check_read_bytes(call_id, ptr_MAAPVal, ((EL_T *)ptr) + i, sizeof(EL_T));
-      else
-        check_write_bytes(call_id, ptr_MAAPVal, ((EL_T *)ptr) + i,
-                          sizeof(EL_T));
-    }
-}
-
-CILKSAN_API void __csan_llvm_masked_load_v4i32_p0(
-    const csi_id_t call_id, const csi_id_t func_id, unsigned MAAP_count,
-    const call_prop_t prop, v4i32 *result, v4i32 *ptr, int32_t alignment,
-    uint8_t *mask) {
-  generic_masked_load_store<v4i32, 4, uint8_t, 0x0f, true>(
-      call_id, MAAP_count, prop, result, ptr, alignment, mask);
-}
-
-CILKSAN_API void __csan_llvm_masked_store_v4i32_p0(
-    const csi_id_t call_id, const csi_id_t func_id, unsigned MAAP_count,
-    const call_prop_t prop, v4i32 *val, v4i32 *ptr, int32_t alignment,
-    uint8_t *mask) {
-  generic_masked_load_store<v4i32, 4, uint8_t, 0x0f, false>(
-      call_id, MAAP_count, prop, val, ptr, alignment, mask);
-}
-
-CILKSAN_API void __csan_llvm_masked_load_v4i64_p0(
-    const csi_id_t call_id, const csi_id_t func_id, unsigned MAAP_count,
-    const call_prop_t prop, v4i64 *result, v4i64 *ptr, int32_t alignment,
-    uint8_t *mask) {
-  generic_masked_load_store<v4i64, 4, uint8_t, 0x0f, true>(
-      call_id, MAAP_count, prop, result, ptr, alignment, mask);
-}
-
-CILKSAN_API void __csan_llvm_masked_store_v4i64_p0(
-    const csi_id_t call_id, const csi_id_t func_id, unsigned MAAP_count,
-    const call_prop_t prop, v4i64 *val, v4i64 *ptr, int32_t alignment,
-    uint8_t *mask) {
-  generic_masked_load_store<v4i64, 4, uint8_t, 0x0f, false>(
-      call_id, MAAP_count, prop, val, ptr, alignment, mask);
-}
-
-CILKSAN_API void __csan_llvm_masked_load_v8i32_p0(
-    const csi_id_t call_id, const csi_id_t func_id, unsigned MAAP_count,
-    const call_prop_t prop, v8i32 *result, v8i32 *ptr, int32_t alignment,
-    uint8_t *mask) {
-  generic_masked_load_store<v8i32, 8, uint8_t, 0xff, true>(
-      call_id, MAAP_count, prop, result, ptr, alignment, mask);
-}
-
-CILKSAN_API void __csan_llvm_masked_store_v8i32_p0(
-    const csi_id_t call_id, const csi_id_t func_id, unsigned MAAP_count,
-    const call_prop_t prop, v8i32 *val, v8i32 *ptr, int32_t alignment,
-    uint8_t *mask) {
-  generic_masked_load_store<v8i32, 8, uint8_t, 0xff, false>(
-      call_id, MAAP_count, prop, val, ptr, alignment, mask);
-}
-
-CILKSAN_API void __csan_llvm_masked_load_v16i8_p0(
-    const csi_id_t call_id, const csi_id_t func_id, unsigned MAAP_count,
-    const call_prop_t prop, v16i8 *result, v16i8 *ptr, int32_t alignment,
-    uint16_t *mask) {
-  generic_masked_load_store<v16i8, 16, uint16_t, (uint16_t)(-1), true>(
-      call_id, MAAP_count, prop, result, ptr, alignment, mask);
-}
-
-CILKSAN_API void __csan_llvm_masked_load_v32i8_p0(
-    const csi_id_t call_id, const csi_id_t func_id, unsigned MAAP_count,
-    const call_prop_t prop, v32i8 *result, v32i8 *ptr, int32_t alignment,
-    uint32_t *mask) {
-  generic_masked_load_store<v32i8, 32, uint32_t, (uint32_t)(-1), true>(
-      call_id, MAAP_count, prop, result, ptr, alignment, mask);
 }
 
-template <typename VEC_T, unsigned NUM_ELS, typename MASK_T, bool is_load>
-__attribute__((always_inline)) static void
-generic_masked_gather_scatter(const csi_id_t call_id, unsigned MAAP_count,
-                              const call_prop_t prop, VEC_T *val,
-                              vec_t<uintptr_t, NUM_ELS> *addrs,
-                              int32_t alignment, MASK_T *mask) {
+template <typename VEC_T, bool is_load>
+__attribute__((always_inline)) static void generic_masked_gather_scatter(
+    const csi_id_t call_id, unsigned MAAP_count, const call_prop_t prop,
+    VEC_T *val, vec_t<uintptr_t, VEC_T::NUM_ELEMENTS> *addrs, int32_t alignment,
+    mask_t<VEC_T::NUM_ELEMENTS> *mask) {
   using EL_T = typename VEC_T::ELEMENT_T;
-  static_assert(NUM_ELS == VEC_T::NUM_ELEMENTS,
-                "Mismatch between vector size and num-elements parameter.");
+  constexpr unsigned NUM_ELS = VEC_T::NUM_ELEMENTS;
   static_assert(sizeof(VEC_T) == sizeof(EL_T) * NUM_ELS,
                 "Vector type has unexpected size.");
 
@@ -191,94 +183,76 @@ generic_masked_gather_scatter(const csi_id_t call_id, unsigned MAAP_count,
   if (!is_execution_parallel())
     return;
 
-  for (unsigned i = 0; i < NUM_ELS; ++i)
-    if (*mask & (((MASK_T)(1) << i))) {
-      if (is_load)
-        check_read_bytes(call_id, MAAP_t::ModRef, addrs->els[i], sizeof(EL_T));
-      else
-        check_write_bytes(call_id, MAAP_t::ModRef, addrs->els[i], sizeof(EL_T));
-    }
-}
-
-CILKSAN_API void __csan_llvm_masked_gather_v4f64_v4p0(
-    const csi_id_t call_id, const csi_id_t func_id, unsigned MAAP_count,
-    const call_prop_t prop, v4f64 *val, v4ptrs *addrs, int32_t alignment,
-    uint8_t *mask) {
-  generic_masked_gather_scatter<v4f64, 4, uint8_t, true>(
-      call_id, MAAP_count, prop, val, addrs, alignment, mask);
-}
-
-CILKSAN_API void __csan_llvm_masked_scatter_v4f64_v4p0(
-    const csi_id_t call_id, const csi_id_t func_id, unsigned MAAP_count,
-    const call_prop_t prop, v4f64 *val, v4ptrs *addrs, int32_t alignment,
-    uint8_t *mask) {
-  generic_masked_gather_scatter<v4f64, 4, uint8_t, false>(
-      call_id, MAAP_count, prop, val, addrs, alignment, mask);
-}
-
-CILKSAN_API void __csan_llvm_masked_scatter_v4i32_v4p0(
-    const csi_id_t call_id, const csi_id_t func_id, unsigned MAAP_count,
-    const call_prop_t prop, v4i32 *val, v4ptrs *addrs, int32_t alignment,
-    uint8_t *mask) {
-  generic_masked_gather_scatter<v4i32, 4, uint8_t, false>(
-      call_id, MAAP_count, prop, val, addrs, alignment, mask);
-}
-
-CILKSAN_API void __csan_llvm_masked_scatter_v4i64_v4p0(
-    const csi_id_t call_id, const csi_id_t func_id, unsigned MAAP_count,
-    const call_prop_t prop, v4i64 *val, v4ptrs *addrs, int32_t alignment,
-    uint8_t *mask) {
-  generic_masked_gather_scatter<v4i64, 4, uint8_t, false>(
-      call_id, MAAP_count, prop, val, addrs, alignment, mask);
-}
-
-CILKSAN_API void __csan_llvm_masked_gather_v4p0_v4p0(
-    const csi_id_t call_id, const csi_id_t func_id, unsigned MAAP_count,
-    const call_prop_t prop, v4ptrs *val, v4ptrs *addrs, int32_t alignment,
-    uint8_t *mask) {
-  generic_masked_gather_scatter<v4ptrs, 4, uint8_t, true>(
-      call_id, MAAP_count, prop, val, addrs, alignment, mask);
-}
-
-CILKSAN_API void __csan_llvm_masked_scatter_v4p0_v4p0(
-    const csi_id_t call_id, const csi_id_t func_id, unsigned MAAP_count,
-    const call_prop_t prop, v4ptrs *val, v4ptrs *addrs, int32_t alignment,
-    uint8_t *mask) {
-  generic_masked_gather_scatter<v4ptrs, 4, uint8_t, false>(
-      call_id, MAAP_count, prop, val, addrs, alignment, mask);
-}
-
-CILKSAN_API void __csan_llvm_masked_gather_v8f64_v8p0(
-    const csi_id_t call_id, const csi_id_t func_id, unsigned MAAP_count,
-    const call_prop_t prop, v8f64 *val, v8ptrs *addrs, int32_t alignment,
-    uint8_t *mask) {
-  generic_masked_gather_scatter<v8f64, 8, uint8_t, true>(
-      call_id, MAAP_count, prop, val, addrs, alignment, mask);
-}
-
-CILKSAN_API void __csan_llvm_masked_scatter_v8f64_v8p0(
-    const csi_id_t call_id, const csi_id_t func_id, unsigned MAAP_count,
-    const call_prop_t prop, v8f64 *val, v8ptrs *addrs, int32_t alignment,
-    uint8_t *mask) {
-  generic_masked_gather_scatter<v8f64, 8, uint8_t, false>(
-      call_id, MAAP_count, prop, val, addrs, alignment, mask);
-}
-
-CILKSAN_API void __csan_llvm_masked_gather_v8i32_v8p0(
-    const csi_id_t call_id, const csi_id_t func_id, unsigned MAAP_count,
-    const call_prop_t prop, v8i32 *result, v8ptrs *addrs, int32_t alignment,
-    uint8_t *mask, v8i32 *passthru) {
-  generic_masked_gather_scatter<v8i32, 8, uint8_t, true>(
-      call_id, MAAP_count, prop, result, addrs, alignment, mask);
-}
-
-CILKSAN_API void __csan_llvm_masked_scatter_v8i32_v8p0(
-    const csi_id_t call_id, const csi_id_t func_id, unsigned MAAP_count,
-    const call_prop_t prop, v8i32 *val, v8ptrs *addrs, int32_t alignment,
-    uint8_t *mask) {
-  generic_masked_gather_scatter<v8i32, 8, uint8_t, false>(
-      call_id, MAAP_count, prop, val, addrs, alignment, mask);
-}
+  check_gathered_lanes<EL_T, is_load>(call_id, addrs->els,
+                                      active_lanes<NUM_ELS>(mask));
+}
+
+// Hooks for the target-independent masked load, store, gather, and scatter
+// intrinsics, for each vector type in the following list.  Each entry gives the
+// name of the vector type in intrinsic names and the number of lanes.  The list
+// covers vectors of 64 to 512 bits of every element type, including the
+// element types and widths used by AVX-512.  Only the sizes of elements matter
+// for checking, so half-precision vectors use 16-bit integer elements.
+#define FOR_EACH_MASKED_VECTOR_TYPE(X)                                         \
+  X(v8i8, 8) X(v16i8, 16) X(v32i8, 32) X(v64i8, 64)                            \
+  X(v4i16, 4) X(v8i16, 8) X(v16i16, 16) X(v32i16, 32)                          \
+  X(v2i32, 2) X(v4i32, 4) X(v8i32, 8) X(v16i32, 16)                            \
+  X(v2i64, 2) X(v4i64, 4) X(v8i64, 8)                                          \
+  X(v4f16, 4) X(v8f16, 8) X(v16f16, 16) X(v32f16, 32)                          \
+  X(v2f32, 2) X(v4f32, 4) X(v8f32, 8) X(v16f32, 16)                            \
+  X(v2f64, 2) X(v4f64, 4) X(v8f64, 8)                                          \
+  X(v2p0, 2) X(v4p0, 4) X(v8p0, 8)
+
+using v4i16 = vec_t<int16_t, 4>;
+using v16i16 = vec_t<int16_t, 16>;
+using v32i16 = vec_t<int16_t, 32>;
+using v64i8 = vec_t<int8_t, 64>;
+using v16i32 = vec_t<int32_t, 16>;
+using v2i64 = vec_t<int64_t, 2>;
+using v8i64 = vec_t<int64_t, 8>;
+using v4f16 = vec_t<int16_t, 4>;
+using v8f16 = vec_t<int16_t, 8>;
+using v16f16 = vec_t<int16_t, 16>;
+using v32f16 = vec_t<int16_t, 32>;
+using v16f32 = vec_t<float, 16>;
+using v2p0 = vec_t<uintptr_t, 2>;
+using v4p0 = v4ptrs;
+using v8p0 = v8ptrs;
+
+#define MASKED_HOOKS(VEC, NUM_ELS)                                             \
+  CILKSAN_API void __csan_llvm_masked_load_##VEC##_p0(                         \
+      const csi_id_t call_id, const csi_id_t func_id, unsigned MAAP_count,     \
+      const call_prop_t prop, VEC *result, VEC *ptr, int32_t alignment,        \
+      mask_t<NUM_ELS> *mask, VEC *passthru) {                                  \
+    generic_masked_load_store<VEC, true>(call_id, MAAP_count, prop, result,    \
+                                         ptr, alignment, mask);                \
+  }                                                                            \
+  CILKSAN_API void __csan_llvm_masked_store_##VEC##_p0(                        \
+      const csi_id_t call_id, const csi_id_t func_id, unsigned MAAP_count,     \
+      const call_prop_t prop, VEC *val, VEC *ptr, int32_t alignment,           \
+      mask_t<NUM_ELS> *mask) {                                                 \
+    generic_masked_load_store<VEC, false>(call_id, MAAP_count, prop, val, ptr, \
+                                          alignment, mask);                    \
+  }                                                                            \
+  CILKSAN_API void __csan_llvm_masked_gather_##VEC##_v##NUM_ELS##p0(           \
+      const csi_id_t call_id, const csi_id_t func_id, unsigned MAAP_count,     \
+      const call_prop_t prop, VEC *result, vec_t<uintptr_t, NUM_ELS> *addrs,   \
+      int32_t alignment, mask_t<NUM_ELS> *mask, VEC *passthru) {               \
+    generic_masked_gather_scatter<VEC, true>(call_id, MAAP_count, prop,        \
+                                             result, addrs, alignment, mask);  \
+  }                                                                            \
+  CILKSAN_API void __csan_llvm_masked_scatter_##VEC##_v##NUM_ELS##p0(          \
+      const csi_id_t call_id, const csi_id_t func_id, unsigned MAAP_count,     \
+      const call_prop_t prop, VEC *val, vec_t<uintptr_t, NUM_ELS> *addrs,      \
+      int32_t alignment, mask_t<NUM_ELS> *mask) {                              \
+    generic_masked_gather_scatter<VEC, false>(call_id, MAAP_count, prop, val,  \
+                                              addrs, alignment, mask);         \
+  }
+
+FOR_EACH_MASKED_VECTOR_TYPE(MASKED_HOOKS)
+
+#undef MASKED_HOOKS
+#undef FOR_EACH_MASKED_VECTOR_TYPE
 
 template <typename VEC_T, unsigned NUM_ELS, typename IDX_T, bool is_load>
 __attribute__((always_inline)) static void
@@ -308,16 +282,15 @@ generic_x86_gather_scatter(const csi_id_t call_id, unsigned MAAP_count,
   for (unsigned i = 0; i < NUM_ELS; ++i)
     addrs.els[i] = (uintptr_t)base + vbase->els[i] + (index->els[i] * scale);
 
+  // Conditionality is specified by the most significant bit of each data
+  // element of the mask register.
+  uint64_t bits = 0;
   for (unsigned i = 0; i < NUM_ELS; ++i)
-    // Conditionality is specified by the most significant bit of each data
-    // element of the mask register.
     if (static_cast<uint64_t>(mask->els[i]) &
-        ((uint64_t)(1) << (sizeof(EL_T) * 8 - 1))) {
-      if (is_load)
-        check_read_bytes(call_id, MAAP_t::ModRef, addrs.els[i], sizeof(EL_T));
-      else
-        check_write_bytes(call_id, MAAP_t::ModRef, addrs.els[i], sizeof(EL_T));
-    }
+        ((uint64_t)(1) << (sizeof(EL_T) * 8 - 1)))
+      bits |= (uint64_t)(1) << i;
+
+  check_gathered_lanes<EL_T, is_load>(call_id, addrs.els, bits);
 }
 
 CILKSAN_API void
@@ -901,76 +874,80 @@ __csan___isoc99_sscanf(const csi_id_t call_id, const csi_id_t func_id,
   va_end(ap);
 }
 
-CILKSAN_API void __csan_abs(const csi_id_t call_id, const csi_id_t func_id,
-                            unsigned MAAP_count, const call_prop_t prop,
-                            int result, int n) {
-  return;
-}
+// Hooks for library functions with simple effects on memory, generated from
+// the table in libhooks.inc.
 
-CILKSAN_API void __csan_labs(const csi_id_t call_id, const csi_id_t func_id,
-                             unsigned MAAP_count, const call_prop_t prop,
-                             long result, long n) {
-  return;
-}
+// Nothing to check for a function that operates on a locked stream.
+__attribute__((always_inline)) static void
+locked_stream_libhook(unsigned MAAP_count) {
+  if (!CILKSAN_INITIALIZED)
+    return;
 
-CILKSAN_API void __csan_llabs(const csi_id_t call_id, const csi_id_t func_id,
-                              unsigned MAAP_count, const call_prop_t prop,
-                              long long result, long long n) {
-  return;
+  if (!should_check())
+    return;
+
+  // Most operations on streams are locked by default
+
+  for (unsigned i = 0; i < MAAP_count; ++i)
+    MAAPs.pop();
 }
 
-CILKSAN_API void __csan_access(const csi_id_t call_id, const csi_id_t func_id,
-			       unsigned MAAP_count, const call_prop_t prop,
-			       int result, const char *path, int amode) {
+__attribute__((always_inline)) static void
+reads_string_libhook(const csi_id_t call_id, unsigned MAAP_count,
+                     const char *str) {
   START_HOOK(call_id);
 
-  MAAP_t path_MAAPVal = MAAP_t::ModRef;
+  MAAP_t str_MAAPVal = MAAP_t::ModRef;
   if (MAAP_count > 0) {
-    path_MAAPVal = MAAPs.back().second;
+    str_MAAPVal = MAAPs.back().second;
     MAAPs.pop();
   }
 
   if (!is_execution_parallel())
     return;
 
-  check_read_bytes(call_id, path_MAAPVal, path, strlen(path) + 1);
+  check_read_bytes(call_id, str_MAAPVal, str, strlen(str) + 1);
 }
 
-CILKSAN_API void __csan_acosf(const csi_id_t call_id, const csi_id_t func_id,
-                              unsigned MAAP_count, const call_prop_t prop,
-                              float result, float arg) {
-  return;
-}
+#define LIBHOOK_PARAMS(...) __VA_ARGS__
 
-CILKSAN_API void __csan_acos(const csi_id_t call_id, const csi_id_t func_id,
-                             unsigned MAAP_count, const call_prop_t prop,
-                             double result, double arg) {
-  return;
-}
+#define LIBHOOK_DECL(NAME, PARAMS)                                             \
+  CILKSAN_API void __csan_##NAME(const csi_id_t call_id,                       \
+                                 const csi_id_t func_id, unsigned MAAP_count,  \
+                                 const call_prop_t prop,                       \
+                                 LIBHOOK_PARAMS PARAMS)
 
-CILKSAN_API void __csan_acosl(const csi_id_t call_id, const csi_id_t func_id,
-                              unsigned MAAP_count, const call_prop_t prop,
-                              long double result, long double arg) {
-  return;
-}
+#define LIBHOOK_NO_EFFECT(NAME, PARAMS)                                        \
+  LIBHOOK_DECL(NAME, PARAMS) {}
 
-CILKSAN_API void __csan_acoshf(const csi_id_t call_id, const csi_id_t func_id,
-                               unsigned MAAP_count, const call_prop_t prop,
-                               float result, float arg) {
-  return;
-}
+#define LIBHOOK_MATH_PARAMS_1(FP_T) (FP_T result, FP_T x)
+#define LIBHOOK_MATH_PARAMS_2(FP_T) (FP_T result, FP_T x, FP_T y)
+#define LIBHOOK_MATH_PARAMS_3(FP_T) (FP_T result, FP_T x, FP_T y, FP_T z)
 
-CILKSAN_API void __csan_acosh(const csi_id_t call_id, const csi_id_t func_id,
-                              unsigned MAAP_count, const call_prop_t prop,
-                              double result, double arg) {
-  return;
-}
+#define LIBHOOK_MATH(NAME, ARITY)                                              \
+  LIBHOOK_NO_EFFECT(NAME##f, LIBHOOK_MATH_PARAMS_##ARITY(float))               \
+  LIBHOOK_NO_EFFECT(NAME, LIBHOOK_MATH_PARAMS_##ARITY(double))                 \
+  LIBHOOK_NO_EFFECT(NAME##l, LIBHOOK_MATH_PARAMS_##ARITY(long double))
 
-CILKSAN_API void __csan_acoshl(const csi_id_t call_id, const csi_id_t func_id,
-                               unsigned MAAP_count, const call_prop_t prop,
-                               long double result, long double arg) {
-  return;
-}
+#define LIBHOOK_LOCKED_STREAM(NAME, PARAMS)                                    \
+  LIBHOOK_DECL(NAME, PARAMS) { locked_stream_libhook(MAAP_count); }
+
+#define LIBHOOK_READS_STRING(NAME, PARAMS, STR)                                \
+  LIBHOOK_DECL(NAME, PARAMS) {                                                 \
+    reads_string_libhook(call_id, MAAP_count, STR);                            \
+  }
+
+#include "libhooks.inc"
+
+#undef LIBHOOK_READS_STRING
+#undef LIBHOOK_LOCKED_STREAM
+#undef LIBHOOK_MATH
+#undef LIBHOOK_MATH_PARAMS_3
+#undef LIBHOOK_MATH_PARAMS_2
+#undef LIBHOOK_MATH_PARAMS_1
+#undef LIBHOOK_NO_EFFECT
+#undef LIBHOOK_DECL
+#undef LIBHOOK_PARAMS
 
 CILKSAN_API void __csan_aligned_alloc(const csi_id_t call_id,
                                       const csi_id_t func_id,
@@ -986,96 +963,6 @@ CILKSAN_API void __csan_aligned_alloc(const csi_id_t call_id,
   __cilksan_record_alloc(result, size);
 }
 
-CILKSAN_API void __csan_asinf(const csi_id_t call_id, const csi_id_t func_id,
-                              unsigned MAAP_count, const call_prop_t prop,
-                              float result, float arg) {
-  return;
-}
-
-CILKSAN_API void __csan_asin(const csi_id_t call_id, const csi_id_t func_id,
-                             unsigned MAAP_count, const call_prop_t prop,
-                             double result, double arg) {
-  return;
-}
-
-CILKSAN_API void __csan_asinl(const csi_id_t call_id, const csi_id_t func_id,
-                              unsigned MAAP_count, const call_prop_t prop,
-                              long double result, long double arg) {
-  return;
-}
-
-CILKSAN_API void __csan_asinhf(const csi_id_t call_id, const csi_id_t func_id,
-                               unsigned MAAP_count, const call_prop_t prop,
-                               float result, float arg) {
-  return;
-}
-
-CILKSAN_API void __csan_asinh(const csi_id_t call_id, const csi_id_t func_id,
-                              unsigned MAAP_count, const call_prop_t prop,
-                              double result, double arg) {
-  return;
-}
-
-CILKSAN_API void __csan_asinhl(const csi_id_t call_id, const csi_id_t func_id,
-                               unsigned MAAP_count, const call_prop_t prop,
-                               long double result, long double arg) {
-  return;
-}
-
-CILKSAN_API void __csan_atanf(const csi_id_t call_id, const csi_id_t func_id,
-                              unsigned MAAP_count, const call_prop_t prop,
-                              float result, float arg) {
-  return;
-}
-
-CILKSAN_API void __csan_atan(const csi_id_t call_id, const csi_id_t func_id,
-                             unsigned MAAP_count, const call_prop_t prop,
-                             double result, double arg) {
-  return;
-}
-
-CILKSAN_API void __csan_atanl(const csi_id_t call_id, const csi_id_t func_id,
-                              unsigned MAAP_count, const call_prop_t prop,
-                              long double result, long double arg) {
-  return;
-}
-
-CILKSAN_API void __csan_atan2f(const csi_id_t call_id, const csi_id_t func_id,
-                               unsigned MAAP_count, const call_prop_t prop,
-                               float result, float arg) {
-  return;
-}
-
-CILKSAN_API void __csan_atan2(const csi_id_t call_id, const csi_id_t func_id,
-                              unsigned MAAP_count, const call_prop_t prop,
-                              double result, double arg) {
-  return;
-}
-
-CILKSAN_API void __csan_atan2l(const csi_id_t call_id, const csi_id_t func_id,
-                               unsigned MAAP_count, const call_prop_t prop,
-                               long double result, long double arg) {
-  return;
-}
-
-CILKSAN_API void __csan_atanhf(const csi_id_t call_id, const csi_id_t func_id,
-                               unsigned MAAP_count, const call_prop_t prop,
-                               float result, float arg) {
-  return;
-}
-
-CILKSAN_API void __csan_atanh(const csi_id_t call_id, const csi_id_t func_id,
-                              unsigned MAAP_count, const call_prop_t prop,
-                              double result, double arg) {
-  return;
-}
-
-CILKSAN_API void __csan_atanhl(const csi_id_t call_id, const csi_id_t func_id,
-                               unsigned MAAP_count, const call_prop_t prop,
-                               long double result, long double arg) {
-  return;
-}
-
 CILKSAN_API void __csan_atof(const csi_id_t call_id, const csi_id_t func_id,
                              unsigned MAAP_count, const call_prop_t prop,
                              float result, const char *str) {
@@ -1158,24 +1045,6 @@ CILKSAN_API void __csan_bcmp(const csi_id_t call_id, const csi_id_t func_id,
   check_read_bytes(call_id, s2_MAAPVal, s2, n);
 }
 
-CILKSAN_API void __csan_cabs(const csi_id_t call_id, const csi_id_t func_id,
-                             unsigned MAAP_count, const call_prop_t prop,
-                             double result, std::complex<double> z) {
-  return;
-}
-
-CILKSAN_API void __csan_cabsf(const csi_id_t call_id, const csi_id_t func_id,
-                              unsigned MAAP_count, const call_prop_t prop,
-                              float result, std::complex<float> z) {
-  return;
-}
-
-CILKSAN_API void __csan_cabsl(const csi_id_t call_id, const csi_id_t func_id,
-                              unsigned MAAP_count, const call_prop_t prop,
-                              float result, std::complex<long double> z) {
-  return;
-}
-
 CILKSAN_API void __csan_calloc(const csi_id_t call_id, const csi_id_t func_id,
                                unsigned MAAP_count, const call_prop_t prop,
                                void *result, size_t num, size_t size) {
@@ -1188,149 +1057,6 @@ CILKSAN_API void __csan_calloc(const csi_id_t call_id, const csi_id_t func_id,
   __cilksan_record_alloc(result, num * size);
 }
 
-CILKSAN_API void __csan_cbrtf(const csi_id_t call_id, const csi_id_t func_id,
-                              unsigned MAAP_count, const call_prop_t prop,
-                              float result, float arg) {
-  return;
-}
-
-CILKSAN_API void __csan_cbrt(const csi_id_t call_id, const csi_id_t func_id,
-                             unsigned MAAP_count, const call_prop_t prop,
-                             double result, double arg) {
-  return;
-}
-
-CILKSAN_API void __csan_cbrtl(const csi_id_t call_id, const csi_id_t func_id,
-                              unsigned MAAP_count, const call_prop_t prop,
-                              long double result, long double arg) {
-  return;
-}
-
-CILKSAN_API void __csan_ceil(const csi_id_t call_id, const csi_id_t func_id,
-                             unsigned MAAP_count, const call_prop_t prop,
-                             double result, double arg) {
-  return;
-}
-
-CILKSAN_API void __csan_ceilf(const csi_id_t call_id, const csi_id_t func_id,
-                              unsigned MAAP_count, const call_prop_t prop,
-                              float result, float arg) {
-  return;
-}
-
-CILKSAN_API void __csan_ceill(const csi_id_t call_id, const csi_id_t func_id,
-                              unsigned MAAP_count, const call_prop_t prop,
-                              long double result, long double arg) {
-  return;
-}
-
-CILKSAN_API void __csan_clearerr(const csi_id_t call_id, const csi_id_t func_id,
-                                 unsigned MAAP_count, const call_prop_t prop,
-                                 FILE *stream) {
-  if (!CILKSAN_INITIALIZED)
-    return;
-
-  if (!should_check())
-    return;
-
-  // Most operations on streams are locked by default
-
-  for (unsigned i = 0; i < MAAP_count; ++i)
-    MAAPs.pop();
-}
-
-CILKSAN_API void __csan_copysign(const csi_id_t call_id, const csi_id_t func_id,
-                                 unsigned MAAP_count, const call_prop_t prop,
-                                 double result, double x, double y) {
-  return;
-}
-
-CILKSAN_API void __csan_copysignf(const csi_id_t call_id,
-                                  const csi_id_t func_id, unsigned MAAP_count,
-                                  const call_prop_t prop, float result, float x,
-                                  float y) {
-  return;
-}
-
-CILKSAN_API void __csan_copysignl(const csi_id_t call_id,
-                                  const csi_id_t func_id, unsigned MAAP_count,
-                                  const call_prop_t prop, long double result,
-                                  long double x, long double y) {
-  return;
-}
-
-CILKSAN_API void __csan_cosf(const csi_id_t call_id, const csi_id_t func_id,
-                             unsigned MAAP_count, const call_prop_t prop,
-                             float result, float arg) {
-  return;
-}
-
-CILKSAN_API void __csan_cos(const csi_id_t call_id, const csi_id_t func_id,
-                            unsigned MAAP_count, const call_prop_t prop,
-                            double result, double arg) {
-  return;
-}
-
-CILKSAN_API void __csan_cosl(const csi_id_t call_id, const csi_id_t func_id,
-                             unsigned MAAP_count, const call_prop_t prop,
-                             long double result, long double arg) {
-  return;
-}
-
-CILKSAN_API void __csan_coshf(const csi_id_t call_id, const csi_id_t func_id,
-                              unsigned MAAP_count, const call_prop_t prop,
-                              float result, float arg) {
-  return;
-}
-
-CILKSAN_API void __csan_cosh(const csi_id_t call_id, const csi_id_t func_id,
-                             unsigned MAAP_count, const call_prop_t prop,
-                             double result, double arg) {
-  return;
-}
-
-CILKSAN_API void __csan_coshl(const csi_id_t call_id, const csi_id_t func_id,
-                              unsigned MAAP_count, const call_prop_t prop,
-                              long double result, long double arg) {
-  return;
-}
-
-CILKSAN_API void __csan_div(const csi_id_t call_id, const csi_id_t func_id,
-                            unsigned MAAP_count, const call_prop_t prop,
-                            div_t result, int x, int y) {
-  return;
-}
-
-CILKSAN_API void __csan_ldiv(const csi_id_t call_id, const csi_id_t func_id,
-                             unsigned MAAP_count, const call_prop_t prop,
-                             ldiv_t result, long x, long y) {
-  return;
-}
-
-CILKSAN_API void __csan_lldiv(const csi_id_t call_id, const csi_id_t func_id,
-                              unsigned MAAP_count, const call_prop_t prop,
-                              lldiv_t result, long long x, long long y) {
-  return;
-}
-
-CILKSAN_API void __csan_erff(const csi_id_t call_id, const csi_id_t func_id,
-                             unsigned MAAP_count, const call_prop_t prop,
-                             float result, float arg) {
-  return;
-}
-
-CILKSAN_API void __csan_erf(const csi_id_t call_id, const csi_id_t func_id,
-                            unsigned MAAP_count, const call_prop_t prop,
-                            double result, double arg) {
-  return;
-}
-
-CILKSAN_API void __csan_erfl(const csi_id_t call_id, const csi_id_t func_id,
-                             unsigned MAAP_count, const call_prop_t prop,
-                             long double result, long double arg) {
-  return;
-}
-
 CILKSAN_API void __csan_execl(const csi_id_t call_id, const csi_id_t func_id,
                               unsigned MAAP_count, const call_prop_t prop,
                               int result, const char *filename, const char *arg,
@@ -1469,174 +1195,6 @@ CILKSAN_API void __csan_execvpe(const csi_id_t call_id, const csi_id_t func_id,
   check_read_bytes(call_id, filename_MAAPVal, filename, strlen(filename) + 1);
 }
 
-CILKSAN_API void __csan_expf(const csi_id_t call_id, const csi_id_t func_id,
-                             unsigned MAAP_count, const call_prop_t prop,
-                             float result, float arg) {
-  return;
-}
-
-CILKSAN_API void __csan_exp(const csi_id_t call_id, const csi_id_t func_id,
-                            unsigned MAAP_count, const call_prop_t prop,
-                            double result, double arg) {
-  return;
-}
-
-CILKSAN_API void __csan_expl(const csi_id_t call_id, const csi_id_t func_id,
-                             unsigned MAAP_count, const call_prop_t prop,
-                             long double result, long double arg) {
-  return;
-}
-
-CILKSAN_API void __csan_exp2f(const csi_id_t call_id, const csi_id_t func_id,
-                              unsigned MAAP_count, const call_prop_t prop,
-                              float result, float arg) {
-  return;
-}
-
-CILKSAN_API void __csan_exp2(const csi_id_t call_id, const csi_id_t func_id,
-                             unsigned MAAP_count, const call_prop_t prop,
-                             double result, double arg) {
-  return;
-}
-
-CILKSAN_API void __csan_exp2l(const csi_id_t call_id, const csi_id_t func_id,
-                              unsigned MAAP_count, const call_prop_t prop,
-                              long double result, long double arg) {
-  return;
-}
-
-CILKSAN_API void __csan_expm1f(const csi_id_t call_id, const csi_id_t func_id,
-                               unsigned MAAP_count, const call_prop_t prop,
-                               float result, float arg) {
-  return;
-}
-
-CILKSAN_API void __csan_expm1(const csi_id_t call_id, const csi_id_t func_id,
-                              unsigned MAAP_count, const call_prop_t prop,
-                              double result, double arg) {
-  return;
-}
-
-CILKSAN_API void __csan_expm1l(const csi_id_t call_id, const csi_id_t func_id,
-                               unsigned MAAP_count, const call_prop_t prop,
-                               long double result, long double arg) {
-  return;
-}
-
-CILKSAN_API void __csan_fabsf(const csi_id_t call_id, const csi_id_t func_id,
-                              unsigned MAAP_count, const call_prop_t prop,
-                              float result, float arg) {
-  return;
-}
-
-CILKSAN_API void __csan_fabs(const csi_id_t call_id, const csi_id_t func_id,
-                             unsigned MAAP_count, const call_prop_t prop,
-                             double result, double arg) {
-  return;
-}
-
-CILKSAN_API void __csan_fabsl(const csi_id_t call_id, const csi_id_t func_id,
-                              unsigned MAAP_count, const call_prop_t prop,
-                              long double result, long double arg) {
-  return;
-}
-
-CILKSAN_API void __csan_fclose(const csi_id_t call_id, const csi_id_t func_id,
-                               unsigned MAAP_count, const call_prop_t prop,
-                               int result, FILE *stream) {
-  if (!CILKSAN_INITIALIZED)
-    return;
-
-  if (!should_check())
-    return;
-
-  // Most operations on streams are locked by default
-
-  for (unsigned i = 0; i < MAAP_count; ++i)
-    MAAPs.pop();
-}
-
-CILKSAN_API void __csan_fdimf(const csi_id_t call_id, const csi_id_t func_id,
-                              unsigned MAAP_count, const call_prop_t prop,
-                              float result, float x, float y) {
-  return;
-}
-
-CILKSAN_API void __csan_fdim(const csi_id_t call_id, const csi_id_t func_id,
-                             unsigned MAAP_count, const call_prop_t prop,
-                             double result, double x, double y) {
-  return;
-}
-
-CILKSAN_API void __csan_fdiml(const csi_id_t call_id, const csi_id_t func_id,
-                              unsigned MAAP_count, const call_prop_t prop,
-                              long double result, long double x,
-                              long double y) {
-  return;
-}
-
-CILKSAN_API void __csan_fdopen(const csi_id_t call_id, const csi_id_t func_id,
-                               unsigned MAAP_count, const call_prop_t prop,
-                               FILE *result, int fd, const char *mode) {
-  START_HOOK(call_id);
-
-  MAAP_t mode_MAAPVal = MAAP_t::ModRef;
-  if (MAAP_count > 0) {
-    mode_MAAPVal = MAAPs.back().second;
-    MAAPs.pop();
-  }
-
-  if (!is_execution_parallel())
-    return;
-
-  check_read_bytes(call_id, mode_MAAPVal, mode, strlen(mode) + 1);
-}
-
-CILKSAN_API void __csan_feof(const csi_id_t call_id, const csi_id_t func_id,
-                             unsigned MAAP_count, const call_prop_t prop,
-                             int result, FILE *stream) {
-  if (!CILKSAN_INITIALIZED)
-    return;
-
-  if (!should_check())
-    return;
-
-  // Most operations on streams are locked by default
-
-  for (unsigned i = 0; i < MAAP_count; ++i)
-    MAAPs.pop();
-}
-
-CILKSAN_API void __csan_ferror(const csi_id_t call_id, const csi_id_t func_id,
-                               unsigned MAAP_count, const call_prop_t prop,
-                               int result, FILE *stream) {
-  if (!CILKSAN_INITIALIZED)
-    return;
-
-  if (!should_check())
-    return;
-
-  // Most operations on streams are locked by default
-
-  for (unsigned i = 0; i < MAAP_count; ++i)
-    MAAPs.pop();
-}
-
-CILKSAN_API void __csan_fflush(const csi_id_t call_id, const csi_id_t func_id,
-                               unsigned MAAP_count, const call_prop_t prop,
-                               int result, FILE *stream) {
-  if (!CILKSAN_INITIALIZED)
-    return;
-
-  if (!should_check())
-    return;
-
-  // Most operations on streams are locked by default
-
-  for (unsigned i = 0; i < MAAP_count; ++i)
-    MAAPs.pop();
-}
-
 CILKSAN_API void __csan_fflush_unlocked(const csi_id_t call_id,
                                         const csi_id_t func_id,
                                         unsigned MAAP_count,
@@ -1656,21 +1214,6 @@ CILKSAN_API void __csan_fflush_unlocked(const csi_id_t call_id,
   check_write_bytes(call_id, stream_MAAPVal, stream, 1);
 }
 
-CILKSAN_API void __csan_fgetc(const csi_id_t call_id, const csi_id_t func_id,
-                              unsigned MAAP_count, const call_prop_t prop,
-                              int result, FILE *stream) {
-  if (!CILKSAN_INITIALIZED)
-    return;
-
-  if (!should_check())
-    return;
-
-  // Most operations on streams are locked by default
-
-  for (unsigned i = 0; i < MAAP_count; ++i)
-    MAAPs.pop();
-}
-
 CILKSAN_API void __csan_fgetc_unlocked(const csi_id_t call_id,
                                        const csi_id_t func_id,
                                        unsigned MAAP_count,
@@ -1749,121 +1292,12 @@ CILKSAN_API void __csan_fgets_unlocked(const csi_id_t call_id,
     MAAPs.pop();
   }
 
-  if (!is_execution_parallel())
-    return;
-
-  size_t len = strlen(str);
-  check_read_bytes(call_id, stream_MAAPVal, stream, 1);
-  check_write_bytes(call_id, str_MAAPVal, str, len + 1);
-}
-
-CILKSAN_API void __csan_fileno(const csi_id_t call_id, const csi_id_t func_id,
-                               unsigned MAAP_count, const call_prop_t prop,
-                               int result, FILE *stream) {
-  if (!CILKSAN_INITIALIZED)
-    return;
-
-  if (!should_check())
-    return;
-
-  // Most operations on streams are locked by default
-
-  for (unsigned i = 0; i < MAAP_count; ++i)
-    MAAPs.pop();
-}
-
-CILKSAN_API void __csan_floor(const csi_id_t call_id, const csi_id_t func_id,
-                              unsigned MAAP_count, const call_prop_t prop,
-                              double result, double arg) {
-  return;
-}
-
-CILKSAN_API void __csan_floorf(const csi_id_t call_id, const csi_id_t func_id,
-                               unsigned MAAP_count, const call_prop_t prop,
-                               float result, float arg) {
-  return;
-}
-
-CILKSAN_API void __csan_floorl(const csi_id_t call_id, const csi_id_t func_id,
-                               unsigned MAAP_count, const call_prop_t prop,
-                               long double result, long double arg) {
-  return;
-}
-
-CILKSAN_API void __csan_fmaf(const csi_id_t call_id, const csi_id_t func_id,
-                             unsigned MAAP_count, const call_prop_t prop,
-                             float result, float x, float y, float z) {
-  return;
-}
-
-CILKSAN_API void __csan_fma(const csi_id_t call_id, const csi_id_t func_id,
-                            unsigned MAAP_count, const call_prop_t prop,
-                            double result, double x, double y, double z) {
-  return;
-}
-
-CILKSAN_API void __csan_fmal(const csi_id_t call_id, const csi_id_t func_id,
-                             unsigned MAAP_count, const call_prop_t prop,
-                             long double result, long double x, long double y,
-                             long double z) {
-  return;
-}
-
-CILKSAN_API void __csan_fmaxf(const csi_id_t call_id, const csi_id_t func_id,
-                              unsigned MAAP_count, const call_prop_t prop,
-                              float result, float x, float y) {
-  return;
-}
-
-CILKSAN_API void __csan_fmax(const csi_id_t call_id, const csi_id_t func_id,
-                             unsigned MAAP_count, const call_prop_t prop,
-                             double result, double x, double y) {
-  return;
-}
-
-CILKSAN_API void __csan_fmaxl(const csi_id_t call_id, const csi_id_t func_id,
-                              unsigned MAAP_count, const call_prop_t prop,
-                              long double result, long double x,
-                              long double y) {
-  return;
-}
-
-CILKSAN_API void __csan_fminf(const csi_id_t call_id, const csi_id_t func_id,
-                              unsigned MAAP_count, const call_prop_t prop,
-                              float result, float x, float y) {
-  return;
-}
-
-CILKSAN_API void __csan_fmin(const csi_id_t call_id, const csi_id_t func_id,
-                             unsigned MAAP_count, const call_prop_t prop,
-                             double result, double x, double y) {
-  return;
-}
-
-CILKSAN_API void __csan_fminl(const csi_id_t call_id, const csi_id_t func_id,
-                              unsigned MAAP_count, const call_prop_t prop,
-                              long double result, long double x,
-                              long double y) {
-  return;
-}
-
-CILKSAN_API void __csan_fmodf(const csi_id_t call_id, const csi_id_t func_id,
-                              unsigned MAAP_count, const call_prop_t prop,
-                              float result, float x, float y) {
-  return;
-}
-
-CILKSAN_API void __csan_fmod(const csi_id_t call_id, const csi_id_t func_id,
-                             unsigned MAAP_count, const call_prop_t prop,
-                             double result, double x, double y) {
-  return;
-}
-
-CILKSAN_API void __csan_fmodl(const csi_id_t call_id, const csi_id_t func_id,
-                              unsigned MAAP_count, const call_prop_t prop,
-                              long double result, long double x,
-                              long double y) {
-  return;
+  if (!is_execution_parallel())
+    return;
+
+  size_t len = strlen(str);
+  check_read_bytes(call_id, stream_MAAPVal, stream, 1);
+  check_write_bytes(call_id, str_MAAPVal, str, len + 1);
 }
 
 CILKSAN_API void __csan_fopen(const csi_id_t call_id, const csi_id_t func_id,
@@ -1910,12 +1344,6 @@ CILKSAN_API void __csan_fopen64(const csi_id_t call_id, const csi_id_t func_id,
   check_read_bytes(call_id, mode_MAAPVal, mode, strlen(mode) + 1);
 }
 
-CILKSAN_API void __csan_fork(const csi_id_t call_id, const csi_id_t func_id,
-                             unsigned MAAP_count, const call_prop_t prop,
-                             pid_t result) {
-  return;
-}
-
 CILKSAN_API void __csan_fprintf(const csi_id_t call_id, const csi_id_t func_id,
                                 unsigned MAAP_count, const call_prop_t prop,
                                 int result, FILE *stream, const char *format,
@@ -1942,21 +1370,6 @@ CILKSAN_API void __csan_fprintf(const csi_id_t call_id, const csi_id_t func_id,
   va_end(ap);
 }
 
-CILKSAN_API void __csan_fputc(const csi_id_t call_id, const csi_id_t func_id,
-                              unsigned MAAP_count, const call_prop_t prop,
-                              int result, int ch, FILE *stream) {
-  if (!CILKSAN_INITIALIZED)
-    return;
-
-  if (!should_check())
-    return;
-
-  // Most operations on streams are locked by default
-
-  for (unsigned i = 0; i < MAAP_count; ++i)
-    MAAPs.pop();
-}
-
 CILKSAN_API void __csan_fputc_unlocked(const csi_id_t call_id,
                                        const csi_id_t func_id,
                                        unsigned MAAP_count,
@@ -2161,38 +1574,6 @@ CILKSAN_API void __csan_fscanf(const csi_id_t call_id, const csi_id_t func_id,
   va_end(ap);
 }
 
-CILKSAN_API void __csan_fseek(const csi_id_t call_id, const csi_id_t func_id,
-                              unsigned MAAP_count, const call_prop_t prop,
-                              int result, FILE *stream, long offset,
-                              int origin) {
-  if (!CILKSAN_INITIALIZED)
-    return;
-
-  if (!should_check())
-    return;
-
-  // Most operations on streams are locked by default
-
-  for (unsigned i = 0; i < MAAP_count; ++i)
-    MAAPs.pop();
-}
-
-CILKSAN_API void __csan_fseeko(const csi_id_t call_id, const csi_id_t func_id,
-                               unsigned MAAP_count, const call_prop_t prop,
-                               int result, FILE *stream, off_t offset,
-                               int origin) {
-  if (!CILKSAN_INITIALIZED)
-    return;
-
-  if (!should_check())
-    return;
-
-  // Most operations on streams are locked by default
-
-  for (unsigned i = 0; i < MAAP_count; ++i)
-    MAAPs.pop();
-}
-
 #if defined(_LARGEFILE64_SOURCE)
 CILKSAN_API void __csan_fseeko64(const csi_id_t call_id, const csi_id_t func_id,
                                  unsigned MAAP_count, const call_prop_t prop,
@@ -2270,36 +1651,6 @@ CILKSAN_API void __csan_fstat64(const csi_id_t call_id, const csi_id_t func_id,
 }
 #endif
 
-CILKSAN_API void __csan_ftell(const csi_id_t call_id, const csi_id_t func_id,
-                              unsigned MAAP_count, const call_prop_t prop,
-                              long result, FILE *stream) {
-  if (!CILKSAN_INITIALIZED)
-    return;
-
-  if (!should_check())
-    return;
-
-  // Most operations on streams are locked by default
-
-  for (unsigned i = 0; i < MAAP_count; ++i)
-    MAAPs.pop();
-}
-
-CILKSAN_API void __csan_ftello(const csi_id_t call_id, const csi_id_t func_id,
-                               unsigned MAAP_count, const call_prop_t prop,
-                               off_t result, FILE *stream) {
-  if (!CILKSAN_INITIALIZED)
-    return;
-
-  if (!should_check())
-    return;
-
-  // Most operations on streams are locked by default
-
-  for (unsigned i = 0; i < MAAP_count; ++i)
-    MAAPs.pop();
-}
-
 #if defined(_LARGEFILE64_SOURCE)
 CILKSAN_API void __csan_ftello64(const csi_id_t call_id, const csi_id_t func_id,
                                  unsigned MAAP_count, const call_prop_t prop,
@@ -2369,21 +1720,6 @@ CILKSAN_API void __csan_fwrite_unlocked(const csi_id_t call_id,
   check_write_bytes(call_id, stream_MAAPVal, stream, 1);
 }
 
-CILKSAN_API void __csan_getc(const csi_id_t call_id, const csi_id_t func_id,
-                             unsigned MAAP_count, const call_prop_t prop,
-                             int result, FILE *stream) {
-  if (!CILKSAN_INITIALIZED)
-    return;
-
-  if (!should_check())
-    return;
-
-  // Most operations on streams are locked by default
-
-  for (unsigned i = 0; i < MAAP_count; ++i)
-    MAAPs.pop();
-}
-
 CILKSAN_API void __csan_getc_unlocked(const csi_id_t call_id,
                                       const csi_id_t func_id,
                                       unsigned MAAP_count,
@@ -2403,12 +1739,6 @@ CILKSAN_API void __csan_getc_unlocked(const csi_id_t call_id,
   check_write_bytes(call_id, stream_MAAPVal, stream, 1);
 }
 
-CILKSAN_API void __csan_getchar(const csi_id_t call_id, const csi_id_t func_id,
-                                unsigned MAAP_count, const call_prop_t prop,
-                                int result) {
-  return;
-}
-
 CILKSAN_API void __csan_getchar_unlocked(const csi_id_t call_id,
                                          const csi_id_t func_id,
                                          unsigned MAAP_count,
@@ -2421,24 +1751,6 @@ CILKSAN_API void __csan_getchar_unlocked(const csi_id_t call_id,
   check_read_bytes(call_id, MAAP_t::ModRef, stdin, 1);
 }
 
-CILKSAN_API void __csan_getenv(const csi_id_t call_id, const csi_id_t func_id,
-                               unsigned MAAP_count, const call_prop_t prop,
-                               char *result, const char *name) {
-  START_HOOK(call_id);
-
-  MAAP_t name_MAAPVal = MAAP_t::ModRef;
-  if (MAAP_count > 0) {
-    name_MAAPVal = MAAPs.back().second;
-    MAAPs.pop();
-  }
-
-  if (!is_execution_parallel())
-    return;
-
-  // TODO: Model access to environment list.
-  check_read_bytes(call_id, name_MAAPVal, name, strlen(name) + 1);
-}
-
 CILKSAN_API void __csan_gettimeofday(const csi_id_t call_id,
                                      const csi_id_t func_id,
                                      unsigned MAAP_count,
@@ -2476,25 +1788,6 @@ CILKSAN_API void __csan_gettimeofday(const csi_id_t call_id,
   return;
 }
 
-CILKSAN_API void __csan_hypotf(const csi_id_t call_id, const csi_id_t func_id,
-                               unsigned MAAP_count, const call_prop_t prop,
-                               float result, float x, float y) {
-  return;
-}
-
-CILKSAN_API void __csan_hypot(const csi_id_t call_id, const csi_id_t func_id,
-                              unsigned MAAP_count, const call_prop_t prop,
-                              double result, double x, double y) {
-  return;
-}
-
-CILKSAN_API void __csan_hypotl(const csi_id_t call_id, const csi_id_t func_id,
-                               unsigned MAAP_count, const call_prop_t prop,
-                               long double result, long double x,
-                               long double y) {
-  return;
-}
-
 #if defined(__linux__)
 CILKSAN_API void __csan__IO_getc(const csi_id_t call_id, const csi_id_t func_id,
                                  unsigned MAAP_count, const call_prop_t prop,
@@ -2514,108 +1807,6 @@ CILKSAN_API void __csan__IO_getc(const csi_id_t call_id, const csi_id_t func_id,
 }
 #endif
 
-CILKSAN_API void __csan_isascii(const csi_id_t call_id, const csi_id_t func_id,
-                                unsigned MAAP_count, const call_prop_t prop,
-                                int result, int ch) {
-  return;
-}
-
-CILKSAN_API void __csan_isdigit(const csi_id_t call_id, const csi_id_t func_id,
-                                unsigned MAAP_count, const call_prop_t prop,
-                                int result, int ch) {
-  return;
-}
-
-CILKSAN_API void __csan_ldexpf(const csi_id_t call_id, const csi_id_t func_id,
-                               unsigned MAAP_count, const call_prop_t prop,
-                               float result, float arg, int exp) {
-  return;
-}
-
-CILKSAN_API void __csan_ldexp(const csi_id_t call_id, const csi_id_t func_id,
-                              unsigned MAAP_count, const call_prop_t prop,
-                              double result, double arg, int exp) {
-  return;
-}
-
-CILKSAN_API void __csan_ldexpl(const csi_id_t call_id, const csi_id_t func_id,
-                               unsigned MAAP_count, const call_prop_t prop,
-                               long double result, long double arg, int exp) {
-  return;
-}
-
-CILKSAN_API void __csan_logf(const csi_id_t call_id, const csi_id_t func_id,
-                             unsigned MAAP_count, const call_prop_t prop,
-                             float result, float arg) {
-  return;
-}
-
-CILKSAN_API void __csan_log(const csi_id_t call_id, const csi_id_t func_id,
-                            unsigned MAAP_count, const call_prop_t prop,
-                            double result, double arg) {
-  return;
-}
-
-CILKSAN_API void __csan_logl(const csi_id_t call_id, const csi_id_t func_id,
-                             unsigned MAAP_count, const call_prop_t prop,
-                             long double result, long double arg) {
-  return;
-}
-
-CILKSAN_API void __csan_log10f(const csi_id_t call_id, const csi_id_t func_id,
-                               unsigned MAAP_count, const call_prop_t prop,
-                               float result, float arg) {
-  return;
-}
-
-CILKSAN_API void __csan_log10(const csi_id_t call_id, const csi_id_t func_id,
-                              unsigned MAAP_count, const call_prop_t prop,
-                              double result, double arg) {
-  return;
-}
-
-CILKSAN_API void __csan_log10l(const csi_id_t call_id, const csi_id_t func_id,
-                               unsigned MAAP_count, const call_prop_t prop,
-                               long double result, long double arg) {
-  return;
-}
-
-CILKSAN_API void __csan_log2f(const csi_id_t call_id, const csi_id_t func_id,
-                              unsigned MAAP_count, const call_prop_t prop,
-                              float result, float arg) {
-  return;
-}
-
-CILKSAN_API void __csan_log2(const csi_id_t call_id, const csi_id_t func_id,
-                             unsigned MAAP_count, const call_prop_t prop,
-                             double result, double arg) {
-  return;
-}
-
-CILKSAN_API void __csan_log2l(const csi_id_t call_id, const csi_id_t func_id,
-                              unsigned MAAP_count, const call_prop_t prop,
-                              long double result, long double arg) {
-  return;
-}
-
-CILKSAN_API void __csan_log1pf(const csi_id_t call_id, const csi_id_t func_id,
-                               unsigned MAAP_count, const call_prop_t prop,
-                               float result, float arg) {
-  return;
-}
-
-CILKSAN_API void __csan_log1p(const csi_id_t call_id, const csi_id_t func_id,
-                              unsigned MAAP_count, const call_prop_t prop,
-                              double result, double arg) {
-  return;
-}
-
-CILKSAN_API void __csan_log1pl(const csi_id_t call_id, const csi_id_t func_id,
-                               unsigned MAAP_count, const call_prop_t prop,
-                               long double result, long double arg) {
-  return;
-}
-
 CILKSAN_API void __csan_lstat(const csi_id_t call_id, const csi_id_t func_id,
                               unsigned MAAP_count, const call_prop_t prop,
                               int result, const char *path, struct stat *buf) {
@@ -2853,23 +2044,6 @@ CILKSAN_API void __csan_memset_pattern16(const csi_id_t call_id,
                              count);
 }
 
-CILKSAN_API void __csan_mkdir(const csi_id_t call_id, const csi_id_t func_id,
-                              unsigned MAAP_count, const call_prop_t prop,
-                              int result, const char *filename, mode_t mode) {
-  START_HOOK(call_id);
-
-  MAAP_t filename_MAAPVal = MAAP_t::ModRef;
-  if (MAAP_count > 0) {
-    filename_MAAPVal = MAAPs.back().second;
-    MAAPs.pop();
-  }
-
-  if (!is_execution_parallel())
-    return;
-
-  check_read_bytes(call_id, filename_MAAPVal, filename, strlen(filename) + 1);
-}
-
 CILKSAN_API void __csan_mktime(const csi_id_t call_id, const csi_id_t func_id,
                                unsigned MAAP_count, const call_prop_t prop,
                                time_t result, struct tm *timeptr) {
@@ -2939,39 +2113,6 @@ CILKSAN_API void __csan_modfl(const csi_id_t call_id, const csi_id_t func_id,
   check_write_bytes(call_id, iptr_MAAPVal, iptr, sizeof(long double));
 }
 
-CILKSAN_API void __csan_nearbyint(const csi_id_t call_id,
-                                  const csi_id_t func_id, unsigned MAAP_count,
-                                  const call_prop_t prop, double result,
-                                  double arg) {
-  return;
-}
-
-CILKSAN_API void __csan_nearbyintl(const csi_id_t call_id,
-                                   const csi_id_t func_id, unsigned MAAP_count,
-                                   const call_prop_t prop, float result,
-                                   float arg) {
-  return;
-}
-
-CILKSAN_API void __csan_nearbyintf(const csi_id_t call_id,
-                                   const csi_id_t func_id, unsigned MAAP_count,
-                                   const call_prop_t prop, long double result,
-                                   long double arg) {
-  return;
-}
-
-CILKSAN_API void __csan_ntohl(const csi_id_t call_id, const csi_id_t func_id,
-                              unsigned MAAP_count, const call_prop_t prop,
-                              uint32_t result, uint32_t netlong) {
-  return;
-}
-
-CILKSAN_API void __csan_ntohs(const csi_id_t call_id, const csi_id_t func_id,
-                              unsigned MAAP_count, const call_prop_t prop,
-                              uint16_t result, uint16_t netlong) {
-  return;
-}
-
 CILKSAN_API void __csan_open(const csi_id_t call_id, const csi_id_t func_id,
                              unsigned MAAP_count, const call_prop_t prop,
                              int result, const char *pathname, int flags, ...) {
@@ -2984,59 +2125,27 @@ CILKSAN_API void __csan_open(const csi_id_t call_id, const csi_id_t func_id,
   }
 
   if (!is_execution_parallel())
-    return;
-
-  check_read_bytes(call_id, pathname_MAAPVal, pathname, strlen(pathname) + 1);
-}
-
-CILKSAN_API void __csan_open64(const csi_id_t call_id, const csi_id_t func_id,
-                               unsigned MAAP_count, const call_prop_t prop,
-                               int result, const char *pathname, int flags,
-                               ...) {
-  START_HOOK(call_id);
-
-  MAAP_t pathname_MAAPVal = MAAP_t::ModRef;
-  if (MAAP_count > 0) {
-    pathname_MAAPVal = MAAPs.back().second;
-    MAAPs.pop();
-  }
-
-  if (!is_execution_parallel())
-    return;
-
-  check_read_bytes(call_id, pathname_MAAPVal, pathname, strlen(pathname) + 1);
-}
-
-CILKSAN_API void __csan_pclose(const csi_id_t call_id, const csi_id_t func_id,
-                               unsigned MAAP_count, const call_prop_t prop,
-                               int result, FILE *stream) {
-  if (!CILKSAN_INITIALIZED)
-    return;
-
-  if (!should_check())
-    return;
-
-  // Most operations on streams are locked by default
+    return;
 
-  for (unsigned i = 0; i < MAAP_count; ++i)
-    MAAPs.pop();
+  check_read_bytes(call_id, pathname_MAAPVal, pathname, strlen(pathname) + 1);
 }
 
-CILKSAN_API void __csan_perror(const csi_id_t call_id, const csi_id_t func_id,
+CILKSAN_API void __csan_open64(const csi_id_t call_id, const csi_id_t func_id,
                                unsigned MAAP_count, const call_prop_t prop,
-                               const char *str) {
+                               int result, const char *pathname, int flags,
+                               ...) {
   START_HOOK(call_id);
 
-  MAAP_t str_MAAPVal = MAAP_t::ModRef;
+  MAAP_t pathname_MAAPVal = MAAP_t::ModRef;
   if (MAAP_count > 0) {
-    str_MAAPVal = MAAPs.back().second;
+    pathname_MAAPVal = MAAPs.back().second;
     MAAPs.pop();
   }
 
   if (!is_execution_parallel())
     return;
 
-  check_read_bytes(call_id, str_MAAPVal, str, strlen(str) + 1);
+  check_read_bytes(call_id, pathname_MAAPVal, pathname, strlen(pathname) + 1);
 }
 
 CILKSAN_API void __csan_popen(const csi_id_t call_id, const csi_id_t func_id,
@@ -3061,25 +2170,6 @@ CILKSAN_API void __csan_popen(const csi_id_t call_id, const csi_id_t func_id,
   check_read_bytes(call_id, type_MAAPVal, type, strlen(type) + 1);
 }
 
-CILKSAN_API void __csan_powf(const csi_id_t call_id, const csi_id_t func_id,
-                             unsigned MAAP_count, const call_prop_t prop,
-                             float result, float base, float exponent) {
-  return;
-}
-
-CILKSAN_API void __csan_pow(const csi_id_t call_id, const csi_id_t func_id,
-                            unsigned MAAP_count, const call_prop_t prop,
-                            double result, double base, double exponent) {
-  return;
-}
-
-CILKSAN_API void __csan_powl(const csi_id_t call_id, const csi_id_t func_id,
-                             unsigned MAAP_count, const call_prop_t prop,
-                             long double result, long double base,
-                             long double exponent) {
-  return;
-}
-
 CILKSAN_API void __csan_pread(const csi_id_t call_id, const csi_id_t func_id,
                               unsigned MAAP_count, const call_prop_t prop,
                               ssize_t result, int fd, const void *buffer,
@@ -3120,27 +2210,6 @@ CILKSAN_API void __csan_printf(const csi_id_t call_id, const csi_id_t func_id,
   va_end(ap);
 }
 
-CILKSAN_API void __csan_putc(const csi_id_t call_id, const csi_id_t func_id,
-                             unsigned MAAP_count, const call_prop_t prop,
-                             int result, int ch, FILE *stream) {
-  if (!CILKSAN_INITIALIZED)
-    return;
-
-  if (!should_check())
-    return;
-
-  // Most operations on streams are locked by default
-
-  for (unsigned i = 0; i < MAAP_count; ++i)
-    MAAPs.pop();
-}
-
-CILKSAN_API void __csan_putchar(const csi_id_t call_id, const csi_id_t func_id,
-                                unsigned MAAP_count, const call_prop_t prop,
-                                int result, int ch) {
-  return;
-}
-
 CILKSAN_API void __csan_putchar_unlocked(const csi_id_t call_id,
                                          const csi_id_t func_id,
                                          unsigned MAAP_count,
@@ -3154,23 +2223,6 @@ CILKSAN_API void __csan_putchar_unlocked(const csi_id_t call_id,
   check_write_bytes(call_id, MAAP_t::ModRef, stdout, 1);
 }
 
-CILKSAN_API void __csan_puts(const csi_id_t call_id, const csi_id_t func_id,
-                             unsigned MAAP_count, const call_prop_t prop,
-                             int result, const char *str) {
-  START_HOOK(call_id);
-
-  MAAP_t str_MAAPVal = MAAP_t::ModRef;
-  if (MAAP_count > 0) {
-    str_MAAPVal = MAAPs.back().second;
-    MAAPs.pop();
-  }
-
-  if (!is_execution_parallel())
-    return;
-
-  check_read_bytes(call_id, str_MAAPVal, str, strlen(str) + 1);
-}
-
 CILKSAN_API void __csan_pwrite(const csi_id_t call_id, const csi_id_t func_id,
                                unsigned MAAP_count, const call_prop_t prop,
                                ssize_t result, int fd, const void *buffer,
@@ -3316,27 +2368,6 @@ CILKSAN_API void __csan_realpath(const csi_id_t call_id, const csi_id_t func_id,
     check_write_bytes(call_id, MAAP_t::ModRef, result, strlen(result) + 1);
 }
 
-CILKSAN_API void __csan_remainderf(const csi_id_t call_id,
-                                   const csi_id_t func_id, unsigned MAAP_count,
-                                   const call_prop_t prop, float result,
-                                   float x, float y) {
-  return;
-}
-
-CILKSAN_API void __csan_remainder(const csi_id_t call_id,
-                                  const csi_id_t func_id, unsigned MAAP_count,
-                                  const call_prop_t prop, double result,
-                                  double x, double y) {
-  return;
-}
-
-CILKSAN_API void __csan_remainderl(const csi_id_t call_id,
-                                   const csi_id_t func_id, unsigned MAAP_count,
-                                   const call_prop_t prop, long double result,
-                                   long double x, long double y) {
-  return;
-}
-
 CILKSAN_API void __csan_remove(const csi_id_t call_id, const csi_id_t func_id,
                                unsigned MAAP_count, const call_prop_t prop,
                                int result, const char *filename) {
@@ -3428,74 +2459,6 @@ CILKSAN_API void __csan_rename(const csi_id_t call_id, const csi_id_t func_id,
   check_read_bytes(call_id, newname_MAAPVal, newname, strlen(newname) + 1);
 }
 
-CILKSAN_API void __csan_rewind(const csi_id_t call_id, const csi_id_t func_id,
-                               unsigned MAAP_count, const call_prop_t prop,
-                               FILE *stream) {
-  if (!CILKSAN_INITIALIZED)
-    return;
-
-  if (!should_check())
-    return;
-
-  // Most operations on streams are locked by default
-
-  for (unsigned i = 0; i < MAAP_count; ++i)
-    MAAPs.pop();
-}
-
-CILKSAN_API void __csan_rint(const csi_id_t call_id, const csi_id_t func_id,
-                             unsigned MAAP_count, const call_prop_t prop,
-                             double result, double x) {
-  return;
-}
-
-CILKSAN_API void __csan_rintf(const csi_id_t call_id, const csi_id_t func_id,
-                              unsigned MAAP_count, const call_prop_t prop,
-                              float result, float x) {
-  return;
-}
-
-CILKSAN_API void __csan_rintl(const csi_id_t call_id, const csi_id_t func_id,
-                              unsigned MAAP_count, const call_prop_t prop,
-                              long double result, long double x) {
-  return;
-}
-
-CILKSAN_API void __csan_rmdir(const csi_id_t call_id, const csi_id_t func_id,
-                              unsigned MAAP_count, const call_prop_t prop,
-                              int result, const char *path) {
-  START_HOOK(call_id);
-
-  MAAP_t path_MAAPVal = MAAP_t::ModRef;
-  if (MAAP_count > 0) {
-    path_MAAPVal = MAAPs.back().second;
-    MAAPs.pop();
-  }
-
-  if (!is_execution_parallel())
-    return;
-
-  check_read_bytes(call_id, path_MAAPVal, path, strlen(path) + 1);
-}
-
-CILKSAN_API void __csan_round(const csi_id_t call_id, const csi_id_t func_id,
-                              unsigned MAAP_count, const call_prop_t prop,
-                              double result, double x) {
-  return;
-}
-
-CILKSAN_API void __csan_roundf(const csi_id_t call_id, const csi_id_t func_id,
-                               unsigned MAAP_count, const call_prop_t prop,
-                               float result, float x) {
-  return;
-}
-
-CILKSAN_API void __csan_roundl(const csi_id_t call_id, const csi_id_t func_id,
-                               unsigned MAAP_count, const call_prop_t prop,
-                               long double result, long double x) {
-  return;
-}
-
 CILKSAN_API void __csan_scanf(const csi_id_t call_id, const csi_id_t func_id,
                               unsigned MAAP_count, const call_prop_t prop,
                               int result, const char *format, ...) {
@@ -3546,42 +2509,6 @@ CILKSAN_API void __csan_setbuf(const csi_id_t call_id, const csi_id_t func_id,
                  buf ? _IOFBF : _IONBF, BUFSIZ);
 }
 
-CILKSAN_API void __csan_sinf(const csi_id_t call_id, const csi_id_t func_id,
-                             unsigned MAAP_count, const call_prop_t prop,
-                             float result, float arg) {
-  return;
-}
-
-CILKSAN_API void __csan_sin(const csi_id_t call_id, const csi_id_t func_id,
-                            unsigned MAAP_count, const call_prop_t prop,
-                            double result, double arg) {
-  return;
-}
-
-CILKSAN_API void __csan_sinl(const csi_id_t call_id, const csi_id_t func_id,
-                             unsigned MAAP_count, const call_prop_t prop,
-                             long double result, long double arg) {
-  return;
-}
-
-CILKSAN_API void __csan_sinhf(const csi_id_t call_id, const csi_id_t func_id,
-                              unsigned MAAP_count, const call_prop_t prop,
-                              float result, float arg) {
-  return;
-}
-
-CILKSAN_API void __csan_sinh(const csi_id_t call_id, const csi_id_t func_id,
-                             unsigned MAAP_count, const call_prop_t prop,
-                             double result, double arg) {
-  return;
-}
-
-CILKSAN_API void __csan_sinhl(const csi_id_t call_id, const csi_id_t func_id,
-                              unsigned MAAP_count, const call_prop_t prop,
-                              long double result, long double arg) {
-  return;
-}
-
 CILKSAN_API void __csan_snprintf(const csi_id_t call_id, const csi_id_t func_id,
                                  unsigned MAAP_count, const call_prop_t prop,
                                  int result, char *str, size_t n,
@@ -3696,24 +2623,6 @@ CILKSAN_API void __csan___sprintf_chk(const csi_id_t call_id,
   check_write_bytes(call_id, str_MAAPVal, str, result + 1);
 }
 
-CILKSAN_API void __csan_sqrtf(const csi_id_t call_id, const csi_id_t func_id,
-                              unsigned MAAP_count, const call_prop_t prop,
-                              float result, float arg) {
-  return;
-}
-
-CILKSAN_API void __csan_sqrt(const csi_id_t call_id, const csi_id_t func_id,
-                             unsigned MAAP_count, const call_prop_t prop,
-                             double result, double arg) {
-  return;
-}
-
-CILKSAN_API void __csan_sqrtl(const csi_id_t call_id, const csi_id_t func_id,
-                              unsigned MAAP_count, const call_prop_t prop,
-                              long double result, long double arg) {
-  return;
-}
-
 CILKSAN_API void __csan_sscanf(const csi_id_t call_id, const csi_id_t func_id,
                                unsigned MAAP_count, const call_prop_t prop,
                                int result, const char *s, const char *format,
@@ -4817,139 +3726,6 @@ CILKSAN_API void __csan_strxfrm(const csi_id_t call_id, const csi_id_t func_id,
     check_write_bytes(call_id, str2_MAAPVal, str2, xfrm_len);
 }
 
-CILKSAN_API void __csan_system(const csi_id_t call_id, const csi_id_t func_id,
-                               unsigned MAAP_count, const call_prop_t prop,
-                               int result, const char *command) {
-  START_HOOK(call_id);
-
-  MAAP_t command_MAAPVal = MAAP_t::ModRef;
-  if (MAAP_count > 0) {
-    command_MAAPVal = MAAPs.back().second;
-    MAAPs.pop();
-  }
-
-  if (!is_execution_parallel())
-    return;
-
-  check_read_bytes(call_id, command_MAAPVal, command, strlen(command) + 1);
-}
-
-CILKSAN_API void __csan_tanf(const csi_id_t call_id, const csi_id_t func_id,
-                             unsigned MAAP_count, const call_prop_t prop,
-                             float result, float arg) {
-  return;
-}
-
-CILKSAN_API void __csan_tan(const csi_id_t call_id, const csi_id_t func_id,
-                            unsigned MAAP_count, const call_prop_t prop,
-                            double result, double arg) {
-  return;
-}
-
-CILKSAN_API void __csan_tanl(const csi_id_t call_id, const csi_id_t func_id,
-                             unsigned MAAP_count, const call_prop_t prop,
-                             long double result, long double arg) {
-  return;
-}
-
-CILKSAN_API void __csan_tanhf(const csi_id_t call_id, const csi_id_t func_id,
-                              unsigned MAAP_count, const call_prop_t prop,
-                              float result, float arg) {
-  return;
-}
-
-CILKSAN_API void __csan_tanh(const csi_id_t call_id, const csi_id_t func_id,
-                             unsigned MAAP_count, const call_prop_t prop,
-                             double result, double arg) {
-  return;
-}
-
-CILKSAN_API void __csan_tanhl(const csi_id_t call_id, const csi_id_t func_id,
-                              unsigned MAAP_count, const call_prop_t prop,
-                              long double result, long double arg) {
-  return;
-}
-
-CILKSAN_API void __csan_toascii(const csi_id_t call_id, const csi_id_t func_id,
-                                unsigned MAAP_count, const call_prop_t prop,
-                                int result, int c) {
-  return;
-}
-
-CILKSAN_API void __csan_trunc(const csi_id_t call_id, const csi_id_t func_id,
-                              unsigned MAAP_count, const call_prop_t prop,
-                              double result, double arg) {
-  return;
-}
-
-CILKSAN_API void __csan_truncf(const csi_id_t call_id, const csi_id_t func_id,
-                               unsigned MAAP_count, const call_prop_t prop,
-                               float result, float arg) {
-  return;
-}
-
-CILKSAN_API void __csan_truncl(const csi_id_t call_id, const csi_id_t func_id,
-                               unsigned MAAP_count, const call_prop_t prop,
-                               long double result, long double arg) {
-  return;
-}
-
-CILKSAN_API void __csan_ungetc(const csi_id_t call_id, const csi_id_t func_id,
-                               unsigned MAAP_count, const call_prop_t prop,
-                               int result, int ch, FILE *stream) {
-  if (!CILKSAN_INITIALIZED)
-    return;
-
-  if (!should_check())
-    return;
-
-  // Most operations on streams are locked by default
-
-  for (unsigned i = 0; i < MAAP_count; ++i)
-    MAAPs.pop();
-}
-
-CILKSAN_API void __csan_unlink(const csi_id_t call_id, const csi_id_t func_id,
-                               unsigned MAAP_count, const call_prop_t prop,
-                               int result, const char *pathname) {
-  START_HOOK(call_id);
-
-  MAAP_t pathname_MAAPVal = MAAP_t::ModRef;
-  if (MAAP_count > 0) {
-    pathname_MAAPVal = MAAPs.back().second;
-    MAAPs.pop();
-  }
-
-  if (!is_execution_parallel())
-    return;
-
-  check_read_bytes(call_id, pathname_MAAPVal, pathname, strlen(pathname) + 1);
-
-  // TODO: Simulate system-level modifications to unlink pathname from the
-  // filesystem.
-}
-
-CILKSAN_API void __csan_unlinkat(const csi_id_t call_id, const csi_id_t func_id,
-                                 unsigned MAAP_count, const call_prop_t prop,
-                                 int result, int dirfd, const char *pathname,
-                                 int flags) {
-  START_HOOK(call_id);
-
-  MAAP_t pathname_MAAPVal = MAAP_t::ModRef;
-  if (MAAP_count > 0) {
-    pathname_MAAPVal = MAAPs.back().second;
-    MAAPs.pop();
-  }
-
-  if (!is_execution_parallel())
-    return;
-
-  check_read_bytes(call_id, pathname_MAAPVal, pathname, strlen(pathname) + 1);
-
-  // TODO: Simulate system-level modifications to unlink pathname from the
-  // filesystem.
-}
-
 CILKSAN_API void __csan_unsetenv(const csi_id_t call_id, const csi_id_t func_id,
                                  unsigned MAAP_count, const call_prop_t prop,
                                  int result, const char *name) {
@@ -12,9 +12,139 @@
 extern const LockID_t atomic_lock_id;
 static LockID_t next_lock_id = atomic_lock_id + 1;
 
+// IDs of destroyed locks, which are recycled for new locks, so that a program
+// that creates and destroys many locks over time still gets lock IDs small
+// enough for the bitset in LockSet_t.  Free IDs less than
+// LockSet_t::NUM_SMALL_IDS are kept in a bitset, and larger free IDs on a
+// stack.
+//
+// Accesses recorded under a destroyed lock keep its ID in their locksets, so a
+// recycled ID can make such an access appear to be protected by the new lock.
+static uint64_t free_small_lock_ids = 0;
+static Stack_t<LockID_t> free_large_lock_ids;
+
 // Map from memory addresses to locks allocated at those locations.
 static AddrMap_t<LockID_t> lock_ids;
 
+// Get an ID for a new lock, preferring the smallest free ID below
+// LockSet_t::NUM_SMALL_IDS.
+static LockID_t new_lock_id() {
+  if (free_small_lock_ids) {
+    LockID_t lock_id = __builtin_ctzl(free_small_lock_ids);
+    free_small_lock_ids &= free_small_lock_ids - 1;
+    return lock_id;
+  }
+  if (next_lock_id >= LockSet_t::NUM_SMALL_IDS && free_large_lock_ids.size()) {
+    LockID_t lock_id = free_large_lock_ids.back();
+    free_large_lock_ids.pop();
+    return lock_id;
+  }
+  return next_lock_id++;
+}
+
+// Register the lock at address lock, if it is not registered already.
+static inline void register_lock(const volatile void *lock) {
+  if (!lock_ids.contains((uintptr_t)lock))
+    lock_ids.insert((uintptr_t)lock, new_lock_id());
+}
+
+// Unregister the lock at address lock, if it is registered, and free its ID.
+static inline void unregister_lock(const volatile void *lock) {
+  const LockID_t *lock_id = lock_ids.get((uintptr_t)lock);
+  if (!lock_id)
+    return;
+  if (*lock_id < LockSet_t::NUM_SMALL_IDS)
+    free_small_lock_ids |= 1UL << *lock_id;
+  else
+    free_large_lock_ids.push_back(*lock_id);
+  lock_ids.remove((uintptr_t)lock);
+}
+
+// Table of interned locksets
+LockSet_t **LockSetTable_t::sets = nullptr;
+size_t LockSetTable_t::num_sets = 0;
+size_t LockSetTable_t::sets_capacity = 0;
+LockSetID_t *LockSetTable_t::table = nullptr;
+unsigned LockSetTable_t::lg_table_size = 0;
+LockSetTable_t::CacheEntry_t *LockSetTable_t::cache = nullptr;
+
+LockSetID_t LockSetTable_t::intern(const LockSet_t &LS) {
+  if (LS.isEmpty())
+    return EMPTY_ID;
+
+  if (__builtin_expect(!table, false)) {
+    lg_table_size = LG_MIN_TABLE_SIZE;
+    table = (LockSetID_t *)calloc(1UL << lg_table_size, sizeof(LockSetID_t));
+    cache = (CacheEntry_t *)calloc(1UL << LG_CACHE_SIZE, sizeof(CacheEntry_t));
+    // Reserve ID 0 for the empty lockset.
+    sets_capacity = 1UL << LG_MIN_TABLE_SIZE;
+    sets = (LockSet_t **)malloc(sets_capacity * sizeof(LockSet_t *));
+    sets[EMPTY_ID] = new LockSet_t();
+    num_sets = 1;
+  }
+
+  // Look up LS in the hash table.
+  size_t mask = (1UL << lg_table_size) - 1;
+  size_t i = LS.hash() & mask;
+  while (EMPTY_ID != table[i]) {
+    if (*sets[table[i]] == LS)
+      return table[i];
+    i = (i + 1) & mask;
+  }
+
+  // Intern a copy of LS.
+  if (num_sets == sets_capacity) {
+    sets_capacity *= 2;
+    sets = (LockSet_t **)realloc(sets, sets_capacity * sizeof(LockSet_t *));
+  }
+  LockSetID_t id = num_sets++;
+  sets[id] = new LockSet_t(LS);
+  table[i] = id;
+
+  // Keep the load factor of the hash table at most 1/2.
+  if (2 * num_sets > (1UL << lg_table_size)) {
+    LockSetID_t *old_table = table;
+    size_t old_size = 1UL << lg_table_size;
+    ++lg_table_size;
+    mask = (1UL << lg_table_size) - 1;
+    table = (LockSetID_t *)calloc(1UL << lg_table_size, sizeof(LockSetID_t));
+    for (size_t j = 0; j < old_size; ++j) {
+      if (EMPTY_ID == old_table[j])
+        continue;
+      size_t k = sets[old_table[j]]->hash() & mask;
+      while (EMPTY_ID != table[k])
+        k = (k + 1) & mask;
+      table[k] = old_table[j];
+    }
+    free(old_table);
+  }
+  return id;
+}
+
+IntersectionResult_t LockSetTable_t::intersect_slow(LockSetID_t LHS,
+                                                    LockSetID_t RHS) {
+  IntersectionResult_t result = LockSet_t::intersect(*sets[LHS], *sets[RHS]);
+  uint64_t key = (static_cast<uint64_t>(LHS) << 32) | RHS;
+  CacheEntry_t &entry =
+      cache[(key * 0x9E3779B97F4A7C15UL) >> (64 - LG_CACHE_SIZE)];
+  entry.key = key;
+  entry.result = result;
+  return result;
+}
+
+void LockSetTable_t::destroy() {
+  for (size_t i = 0; i < num_sets; ++i)
+    delete sets[i];
+  free(sets);
+  sets = nullptr;
+  num_sets = 0;
+  sets_capacity = 0;
+  free(table);
+  table = nullptr;
+  free(cache);
+  cache = nullptr;
+}
+
 static inline void emit_acquire_release_warning(bool is_aquire,
                                                 const void *mutex) {
   if (is_aquire)
@@ -33,7 +163,7 @@ static inline void emit_acquire_release_warning(bool is_aquire,
 // API for Cilk fake locks
 
 CILKSAN_API void __cilksan_acquire_lock(const void *mutex) {
-  if (CILKSAN_INITIALIZED && is_execution_parallel()) {
+  if (CILKSAN_INITIALIZED && is_parallel_for_locks()) {
     if (const LockID_t *lock_id = lock_ids.get((uintptr_t)mutex))
       CilkSanImpl.do_acquire_lock(*lock_id);
     else
@@ -41,8 +171,17 @@ CILKSAN_API void __cilksan_acquire_lock(const void *mutex) {
   }
 }
 
+CILKSAN_API void __cilksan_acquire_read_lock(const void *mutex) {
+  if (CILKSAN_INITIALIZED && is_parallel_for_locks()) {
+    if (const LockID_t *lock_id = lock_ids.get((uintptr_t)mutex))
+      CilkSanImpl.do_acquire_read_lock(*lock_id);
+    else
+      emit_acquire_release_warning(true, mutex);
+  }
+}
+
 CILKSAN_API void __cilksan_release_lock(const void *mutex) {
-  if (CILKSAN_INITIALIZED && is_execution_parallel()) {
+  if (CILKSAN_INITIALIZED && is_parallel_for_locks()) {
     if (const LockID_t *lock_id = lock_ids.get((uintptr_t)mutex))
       CilkSanImpl.do_release_lock(*lock_id);
     else
@@ -51,27 +190,25 @@ CILKSAN_API void __cilksan_release_lock(const void *mutex) {
 }
 
 CILKSAN_API void __cilksan_begin_atomic() {
-  if (CILKSAN_INITIALIZED && is_execution_parallel()) {
+  if (CILKSAN_INITIALIZED && is_parallel_for_locks()) {
     CilkSanImpl.do_acquire_lock(atomic_lock_id);
   }
 }
 
 CILKSAN_API void __cilksan_end_atomic() {
-  if (CILKSAN_INITIALIZED && is_execution_parallel()) {
+  if (CILKSAN_INITIALIZED && is_parallel_for_locks()) {
     CilkSanImpl.do_release_lock(atomic_lock_id);
   }
 }
 
 CILKSAN_API void __cilksan_register_lock_explicit(const void *mutex) {
-  if (CILKSAN_INITIALIZED && !lock_ids.contains((uintptr_t)mutex)) {
-    lock_ids.insert((uintptr_t)mutex, next_lock_id++);
-  }
+  if (CILKSAN_INITIALIZED)
+    register_lock(mutex);
 }
 
 CILKSAN_API void __cilksan_unregister_lock_explicit(const void *mutex) {
-  if (CILKSAN_INITIALIZED && lock_ids.contains((uintptr_t)mutex)) {
-    lock_ids.remove((uintptr_t)mutex);
-  }
+  if (CILKSAN_INITIALIZED)
+    unregister_lock(mutex);
 }
 
 ///////////////////////////////////////////////////////////////////////////
@@ -81,14 +218,14 @@ CILKSAN_API int __csan_pthread_mutex_init(pthread_mutex_t *mutex,
                                           const pthread_mutexattr_t *attr) {
   int result = pthread_mutex_init(mutex, attr);
   if (CILKSAN_INITIALIZED)
-    lock_ids.insert((uintptr_t)mutex, next_lock_id++);
+    register_lock(mutex);
   return result;
 }
 
 CILKSAN_API int __csan_pthread_mutex_destroy(pthread_mutex_t *mutex) {
   int result = pthread_mutex_destroy(mutex);
-  if (CILKSAN_INITIALIZED && lock_ids.contains((uintptr_t)mutex))
-    lock_ids.remove((uintptr_t)mutex);
+  if (CILKSAN_INITIALIZED)
+    unregister_lock(mutex);
   return result;
 }
 
@@ -96,14 +233,14 @@ CILKSAN_API int __csan_pthread_mutex_destroy(pthread_mutex_t *mutex) {
 CILKSAN_API int __csan_mtx_init(mtx_t *mutex, int type) {
   int result = mtx_init(mutex, type);
   if (CILKSAN_INITIALIZED)
-    lock_ids.insert((uintptr_t)mutex, next_lock_id++);
+    register_lock(mutex);
   return result;
 }
 
 CILKSAN_API void __csan_mtx_destroy(mtx_t *mutex) {
   mtx_destroy(mutex);
-  if (CILKSAN_INITIALIZED && lock_ids.contains((uintptr_t)mutex))
-    lock_ids.remove((uintptr_t)mutex);
+  if (CILKSAN_INITIALIZED)
+    unregister_lock(mutex);
 }
 #endif // __STDC_NO_THREADS__
 
@@ -124,9 +261,8 @@ CILKSAN_API int __csan_pthread_mutex_lock(pthread_mutex_t *mutex) {
   // Only record the lock acquire if the tool is initialized and this routine is
   // run on a Cilk worker.
   if (CILKSAN_INITIALIZED && __cilkrts_running_on_workers() &&
-      is_execution_parallel() && !result) {
-    if (!lock_ids.contains((uintptr_t)mutex))
-      lock_ids.insert((uintptr_t)mutex, next_lock_id++);
+      is_parallel_for_locks() && !result) {
+    register_lock(mutex);
     if (const LockID_t *lock_id = lock_ids.get((uintptr_t)mutex))
       CilkSanImpl.do_acquire_lock(*lock_id);
   }
@@ -138,9 +274,8 @@ CILKSAN_API int __csan_pthread_mutex_trylock(pthread_mutex_t *mutex) {
   // Only record the lock acquire if the tool is initialized and this routine is
   // run on a Cilk worker.
   if (CILKSAN_INITIALIZED && __cilkrts_running_on_workers() &&
-      is_execution_parallel() && !result) {
-    if (!lock_ids.contains((uintptr_t)mutex))
-      lock_ids.insert((uintptr_t)mutex, next_lock_id++);
+      is_parallel_for_locks() && !result) {
+    register_lock(mutex);
     if (const LockID_t *lock_id = lock_ids.get((uintptr_t)mutex))
       CilkSanImpl.do_acquire_lock(*lock_id);
   }
@@ -152,7 +287,7 @@ CILKSAN_API int __csan_pthread_mutex_unlock(pthread_mutex_t *mutex) {
   // Only record the lock release if the tool is initialized and this routine is
   // run on a Cilk worker.
   if (CILKSAN_INITIALIZED && __cilkrts_running_on_workers() &&
-      is_execution_parallel() && !result) {
+      is_parallel_for_locks() && !result) {
     if (const LockID_t *lock_id = lock_ids.get((uintptr_t)mutex))
       CilkSanImpl.do_release_lock(*lock_id);
   }
@@ -165,9 +300,8 @@ CILKSAN_API int __csan_mtx_lock(mtx_t *mutex) {
   // Only record the lock acquire if the tool is initialized and this routine is
   // run on a Cilk worker.
   if (CILKSAN_INITIALIZED && __cilkrts_running_on_workers() &&
-      is_execution_parallel() && !result) {
-    if (!lock_ids.contains((uintptr_t)mutex))
-      lock_ids.insert((uintptr_t)mutex, next_lock_id++);
+      is_parallel_for_locks() && !result) {
+    register_lock(mutex);
     if (const LockID_t *lock_id = lock_ids.get((uintptr_t)mutex))
       CilkSanImpl.do_acquire_lock(*lock_id);
   }
@@ -179,9 +313,8 @@ CILKSAN_API int __csan_mtx_trylock(mtx_t *mutex) {
   // Only record the lock acquire if the tool is initialized and this routine is
   // run on a Cilk worker.
   if (CILKSAN_INITIALIZED && __cilkrts_running_on_workers() &&
-      is_execution_parallel() && !result) {
-    if (!lock_ids.contains((uintptr_t)mutex))
-      lock_ids.insert((uintptr_t)mutex, next_lock_id++);
+      is_parallel_for_locks() && !result) {
+    register_lock(mutex);
     if (const LockID_t *lock_id = lock_ids.get((uintptr_t)mutex))
       CilkSanImpl.do_acquire_lock(*lock_id);
   }
@@ -195,7 +328,7 @@ __csan_mtx_timedlock(mtx_t *__restrict__ mutex,
   // Only record the lock acquire if the tool is initialized and this routine is
   // run on a Cilk worker.
   if ((thrd_success == result) && CILKSAN_INITIALIZED &&
-      __cilkrts_running_on_workers() && is_execution_parallel() && !result) {
+      __cilkrts_running_on_workers() && is_parallel_for_locks() && !result) {
     if (const LockID_t *lock_id = lock_ids.get((uintptr_t)mutex))
       CilkSanImpl.do_acquire_lock(*lock_id);
   }
@@ -207,7 +340,7 @@ CILKSAN_API int __csan_mtx_unlock(mtx_t *mutex) {
   // Only record the lock release if the tool is initialized and this routine is
   // run on a Cilk worker.
   if (CILKSAN_INITIALIZED && __cilkrts_running_on_workers() &&
-      is_execution_parallel() && !result) {
+      is_parallel_for_locks() && !result) {
     if (const LockID_t *lock_id = lock_ids.get((uintptr_t)mutex))
       CilkSanImpl.do_release_lock(*lock_id);
   }
@@ -215,6 +348,144 @@ CILKSAN_API int __csan_mtx_unlock(mtx_t *mutex) {
 }
 #endif // __STDC_NO_THREADS__
 
+///////////////////////////////////////////////////////////////////////////
+// Interposers for Pthread reader-writer locks and spin locks
+//
+// A reader-writer lock held for reading protects reads only, so a write
+// under a read lock can still race with a read under the same lock.  This
+// also covers std::shared_mutex and std::shared_lock, which libstdc++
+// implements using Pthread reader-writer locks.
+
+// Record the acquisition of lock, registering the lock if necessary.
+static inline void acquire_lock(const void *lock, bool for_write) {
+  register_lock(lock);
+  if (const LockID_t *lock_id = lock_ids.get((uintptr_t)lock)) {
+    if (for_write)
+      CilkSanImpl.do_acquire_lock(*lock_id);
+    else
+      CilkSanImpl.do_acquire_read_lock(*lock_id);
+  }
+}
+
+// Record the release of lock.
+static inline void release_lock(const void *lock) {
+  if (const LockID_t *lock_id = lock_ids.get((uintptr_t)lock))
+    CilkSanImpl.do_release_lock(*lock_id);
+}
+
+// Returns true if a lock operation that returned result should be recorded,
+// that is, if it succeeded, the tool is initialized, and this routine is run on
+// a Cilk worker.
+static inline bool should_record_lock_op(int result) {
+  return !result && CILKSAN_INITIALIZED && __cilkrts_running_on_workers() &&
+         is_parallel_for_locks();
+}
+
+CILKSAN_API int
+__csan_pthread_rwlock_init(pthread_rwlock_t *__restrict__ rwlock,
+                           const pthread_rwlockattr_t *__restrict__ attr) {
+  int result = pthread_rwlock_init(rwlock, attr);
+  if (CILKSAN_INITIALIZED)
+    register_lock(rwlock);
+  return result;
+}
+
+CILKSAN_API int __csan_pthread_rwlock_destroy(pthread_rwlock_t *rwlock) {
+  int result = pthread_rwlock_destroy(rwlock);
+  if (CILKSAN_INITIALIZED)
+    unregister_lock(rwlock);
+  return result;
+}
+
+CILKSAN_API int __csan_pthread_rwlock_rdlock(pthread_rwlock_t *rwlock) {
+  int result = pthread_rwlock_rdlock(rwlock);
+  if (should_record_lock_op(result))
+    acquire_lock(rwlock, false);
+  return result;
+}
+
+CILKSAN_API int __csan_pthread_rwlock_tryrdlock(pthread_rwlock_t *rwlock) {
+  int result = pthread_rwlock_tryrdlock(rwlock);
+  if (should_record_lock_op(result))
+    acquire_lock(rwlock, false);
+  return result;
+}
+
+CILKSAN_API int __csan_pthread_rwlock_timedrdlock(
+    pthread_rwlock_t *__restrict__ rwlock,
+    const struct timespec *__restrict__ abstime) {
+  int result = pthread_rwlock_timedrdlock(rwlock, abstime);
+  if (should_record_lock_op(result))
+    acquire_lock(rwlock, false);
+  return result;
+}
+
+CILKSAN_API int __csan_pthread_rwlock_wrlock(pthread_rwlock_t *rwlock) {
+  int result = pthread_rwlock_wrlock(rwlock);
+  if (should_record_lock_op(result))
+    acquire_lock(rwlock, true);
+  return result;
+}
+
+CILKSAN_API int __csan_pthread_rwlock_trywrlock(pthread_rwlock_t *rwlock) {
+  int result = pthread_rwlock_trywrlock(rwlock);
+  if (should_record_lock_op(result))
+    acquire_lock(rwlock, true);
+  return result;
+}
+
+CILKSAN_API int __csan_pthread_rwlock_timedwrlock(
+    pthread_rwlock_t *__restrict__ rwlock,
+    const struct timespec *__restrict__ abstime) {
+  int result = pthread_rwlock_timedwrlock(rwlock, abstime);
+  if (should_record_lock_op(result))
+    acquire_lock(rwlock, true);
+  return result;
+}
+
+CILKSAN_API int __csan_pthread_rwlock_unlock(pthread_rwlock_t *rwlock) {
+  int result = pthread_rwlock_unlock(rwlock);
+  if (should_record_lock_op(result))
+    release_lock(rwlock);
+  return result;
+}
+
+CILKSAN_API int __csan_pthread_spin_init(pthread_spinlock_t *lock,
+                                         int pshared) {
+  int result = pthread_spin_init(lock, pshared);
+  if (CILKSAN_INITIALIZED)
+    register_lock(lock);
+  return result;
+}
+
+CILKSAN_API int __csan_pthread_spin_destroy(pthread_spinlock_t *lock) {
+  int result = pthread_spin_destroy(lock);
+  if (CILKSAN_INITIALIZED)
+    unregister_lock(lock);
+  return result;
+}
+
+CILKSAN_API int __csan_pthread_spin_lock(pthread_spinlock_t *lock) {
+  int result = pthread_spin_lock(lock);
+  if (should_record_lock_op(result))
+    acquire_lock((const void *)lock, true);
+  return result;
+}
+
+CILKSAN_API int __csan_pthread_spin_trylock(pthread_spinlock_t *lock) {
+  int result = pthread_spin_trylock(lock);
+  if (should_record_lock_op(result))
+    acquire_lock((const void *)lock, true);
+  return result;
+}
+
+CILKSAN_API int __csan_pthread_spin_unlock(pthread_spinlock_t *lock) {
+  int result = pthread_spin_unlock(lock);
+  if (should_record_lock_op(result))
+    release_lock((const void *)lock);
+  return result;
+}
+
 CILKSAN_API int __csan_pthread_once(pthread_once_t *once_control,
                                     void (*init_routine)(void)) {
   // pthread_once ensures that the given function is run just once by any thread
@@ -21,20 +21,30 @@ enum IntersectionResult_t : uint8_t {
 using LockID_t = uint64_t;
 
 // Class representing a set of locks held during an access.
+//
+// Lock IDs are handed out densely, in the order in which locks are first
+// registered, and the IDs of destroyed locks are reused, so most programs only
+// ever hold locks with small IDs.  A lockset therefore stores IDs less than
+// NUM_SMALL_IDS as a bitset, and only falls back to a sorted array of IDs for
+// larger lock IDs.  When neither lockset has any
+// large IDs, intersections, subset tests and comparisons reduce to a few
+// bitwise operations, and copying a lockset never allocates memory.
 class LockSet_t {
+public:
+  static constexpr LockID_t NUM_SMALL_IDS = 64;
+
 private:
+  // Bitset of lock IDs less than NUM_SMALL_IDS.
+  uint64_t small = 0;
+  // Sorted array of lock IDs greater than or equal to NUM_SMALL_IDS.  The array
+  // is only allocated once such an ID is inserted.
   LockID_t *IDs = nullptr;
   size_t end = 0;
-  size_t capacity = 1;
+  size_t capacity = 0;
 
-  void resize(size_t new_capacity) {
-    // If we haven't yet allocated the IDs array, create a new array.
-    if (!IDs) {
-      IDs = new LockID_t[new_capacity];
-      capacity = new_capacity;
-      return;
-    }
+  static uint64_t bit(LockID_t lock_id) { return 1UL << lock_id; }
 
+  void resize(size_t new_capacity) {
     // Save a pointer to the old IDs array.
     LockID_t *oldIDs = IDs;
 
@@ -42,31 +52,67 @@ private:
     IDs = new LockID_t[new_capacity];
 
     // Copy from oldIDs into the new IDs array.
-    size_t copy_end = capacity > new_capacity ? new_capacity : capacity;
-    for (size_t i = 0; i < copy_end; ++i)
+    for (size_t i = 0; i < end; ++i)
       IDs[i] = oldIDs[i];
 
     // Update the capacity
     capacity = new_capacity;
 
     // Delete the old IDs array
-    delete[] oldIDs;
+    if (oldIDs)
+      delete[] oldIDs;
   }
-public:
-  // Default constructor
-  LockSet_t() {
-    IDs = new LockID_t[capacity];
-  }
-  // Copy constructor
-  LockSet_t(const LockSet_t &copy)
-      : end(copy.end), capacity(copy.capacity) {
-    IDs = new LockID_t[capacity];
+
+  void copyLarge(const LockSet_t &copy) {
+    end = copy.end;
+    capacity = copy.end;
+    IDs = capacity ? new LockID_t[capacity] : nullptr;
     for (size_t i = 0; i < end; ++i)
       IDs[i] = copy.IDs[i];
   }
+
+  // Compare the large lock IDs in LHS and RHS.  Sets common if the arrays share
+  // an ID, Lonly if LHS has an ID not in RHS, and Ronly if RHS has an ID not in
+  // LHS.  Returns early once all three are set.
+  static void compareLarge(const LockSet_t &LHS, const LockSet_t &RHS,
+                           bool &common, bool &Lonly, bool &Ronly) {
+    size_t Lsize = LHS.end, Rsize = RHS.end;
+    size_t Li = 0, Ri = 0;
+    while (Li < Lsize && Ri < Rsize) {
+      if (LHS.IDs[Li] < RHS.IDs[Ri]) {
+        Lonly = true;
+        ++Li;
+      } else if (RHS.IDs[Ri] < LHS.IDs[Li]) {
+        Ronly = true;
+        ++Ri;
+      } else {
+        common = true;
+        ++Li;
+        ++Ri;
+      }
+      if (common && Lonly && Ronly)
+        return;
+    }
+    if (Li < Lsize)
+      Lonly = true;
+    if (Ri < Rsize)
+      Ronly = true;
+  }
+
+public:
+  // Default constructor
+  LockSet_t() = default;
+  // Copy constructor
+  LockSet_t(const LockSet_t &copy) : small(copy.small) { copyLarge(copy); }
   // Move constructor
-  LockSet_t(const LockSet_t &&move)
-      : IDs(move.IDs), end(move.end), capacity(move.capacity) {}
+  LockSet_t(LockSet_t &&move)
+      : small(move.small), IDs(move.IDs), end(move.end),
+        capacity(move.capacity) {
+    move.small = 0;
+    move.IDs = nullptr;
+    move.end = 0;
+    move.capacity = 0;
+  }
 
   // Destructor
   ~LockSet_t() {
@@ -76,19 +122,38 @@ public:
     }
   }
 
+  LockSet_t &operator=(const LockSet_t &copy) {
+    if (this == &copy)
+      return *this;
+    if (IDs)
+      delete[] IDs;
+    small = copy.small;
+    copyLarge(copy);
+    return *this;
+  }
+
   // Return true if the lockset is empty, false otherwise.
-  bool isEmpty() const { return 0 == end; }
+  bool isEmpty() const { return 0 == small && 0 == end; }
 
   // Return the number of elements in this lockset.
-  size_t size() const { return end; }
-
-  // Get the lock ID at index i in this lockset.
-  LockID_t &operator[](size_t i) const { return IDs[i]; }
+  size_t size() const { return __builtin_popcountl(small) + end; }
+
+  // Return true if this lockset contains the given lock ID.
+  bool contains(LockID_t lock_id) const {
+    if (__builtin_expect(lock_id < NUM_SMALL_IDS, true))
+      return small & bit(lock_id);
+    for (size_t i = 0; i < end && IDs[i] <= lock_id; ++i)
+      if (IDs[i] == lock_id)
+        return true;
+    return false;
+  }
 
   // Insert a new lock ID into this lockset.
   void insert(LockID_t new_lock_id) {
-    if (end == capacity)
-      resize(2 * capacity);
+    if (__builtin_expect(new_lock_id < NUM_SMALL_IDS, true)) {
+      small |= bit(new_lock_id);
+      return;
+    }
 
     // Scan the IDs until we find where to insert the new ID to maintain the
     // sorted order.
@@ -101,6 +166,9 @@ public:
       return;
     }
 
+    if (end == capacity)
+      resize(capacity ? 2 * capacity : 1);
+
     // Move IDs at position >= i forward by 1.
     for (size_t j = end; j > i; --j)
       IDs[j] = IDs[j-1];
@@ -114,6 +182,15 @@ public:
 
   // Remove the specified lock ID from this lockset.
   void remove(LockID_t lock_id) {
+    if (__builtin_expect(lock_id < NUM_SMALL_IDS, true)) {
+      // cilksan_assert((small & bit(lock_id)) &&
+      //                "Lock ID to remove is not in this lockset.");
+      if (!(small & bit(lock_id)))
+        fprintf(stderr, "  Lock ID to remove is not in this lockset.\n");
+      small &= ~bit(lock_id);
+      return;
+    }
+
     // Scan the IDs until we find the given lock ID.
     size_t i = 0;
     while (i < end && IDs[i] < lock_id)
@@ -121,8 +198,10 @@ public:
 
     // cilksan_assert((IDs[i] == lock_id) &&
     //                "Lock ID to remove is not in this lockset.");
-    if (IDs[i] != lock_id)
+    if (i == end || IDs[i] != lock_id) {
       fprintf(stderr, "  Lock ID to remove is not in this lockset.\n");
+      return;
+    }
 
     // Move the IDs greater than the given lock ID back by 1.
     for (size_t j = i; j < end - 1; ++j)
@@ -132,83 +211,37 @@ public:
     --end;
   }
 
+  // Intersect the locksets LHS and RHS.  Returns EMPTY if the locksets share no
+  // lock, which includes the case that either lockset is empty.  Otherwise
+  // returns NONEMPTY combined with L_SUBSET_OF_R and L_SUPERSET_OF_R as
+  // appropriate.
   static IntersectionResult_t intersect(const LockSet_t &LHS,
                                         const LockSet_t &RHS) {
-    // If both LockSets are empty, return EMPTY.
-    if (LHS.isEmpty() || RHS.isEmpty())
-      return EMPTY;
-
-    size_t Lsize = LHS.size(), Rsize = RHS.size();
-    size_t Li = 0, Ri = 0;
-    IntersectionResult_t result = L_EQUAL_R;
-    do {
-      // Advance through the LHS lockset until we reach a lock that is greater
-      // than or equal to the lock at the start of RHS.
-      if (Ri < Rsize) {
-        while (Li < Lsize && LHS[Li] < RHS[Ri]) {
-          // We found a lock in LHS that is not in RHS, so L is not a subset of
-          // R.
-          result = static_cast<IntersectionResult_t>(
-              static_cast<uint8_t>(result) &
-              ~static_cast<uint8_t>(L_SUBSET_OF_R));
-          // Return early when we find the locksets share a lock but also both
-          // contain distinct locks.
-          if (NONEMPTY == result)
-            return result;
-          ++Li;
-        }
-      }
-
-      // Advance through the RHS lockset until we reach a lock that is greater
-      // than or equal to the lock at the start of LHS.
-      if (Li < Lsize) {
-        while (Ri < Rsize && RHS[Ri] < LHS[Li]) {
-          // We found a lock in RHS that is not in LHS, so R is not a subset of
-          // L.
-          result = static_cast<IntersectionResult_t>(
-              static_cast<uint8_t>(result) &
-              ~static_cast<uint8_t>(L_SUPERSET_OF_R));
-          // Return early when we find the locksets share a lock but also both
-          // contain distinct locks.
-          if (NONEMPTY == result)
-            return result;
-          ++Ri;
-        }
-      }
-
-      // Check if we have found that both locksets contain the same lock.
-      if (Li < Lsize && Ri < Rsize && LHS[Li] == RHS[Ri]) {
-        // Mark that we found a lock in common.
-        result = static_cast<IntersectionResult_t>(
-            static_cast<uint8_t>(result) | static_cast<uint8_t>(NONEMPTY));
-        // Return early when we find the locksets share a lock but also both
-        // contain distinct locks.
-        if (NONEMPTY == result)
-          return result;
-        ++Li;
-        ++Ri;
-      }
-    } while (Li < Lsize && Ri < Rsize);
+    bool common = LHS.small & RHS.small;
+    bool Lonly = LHS.small & ~RHS.small;
+    bool Ronly = RHS.small & ~LHS.small;
+    if (__builtin_expect(LHS.end || RHS.end, false))
+      compareLarge(LHS, RHS, common, Lonly, Ronly);
 
-    return result;
+    if (!common)
+      return EMPTY;
+    return static_cast<IntersectionResult_t>(
+        static_cast<uint8_t>(NONEMPTY) |
+        (Lonly ? 0 : static_cast<uint8_t>(L_SUBSET_OF_R)) |
+        (Ronly ? 0 : static_cast<uint8_t>(L_SUPERSET_OF_R)));
   }
 
   // Comparison operators for sorting
   bool operator<(const LockSet_t &RHS) const {
-    // If this is empty, then this < RHS as long as RHS is not empty
-    if (isEmpty())
-      return !RHS.isEmpty();
-
-    if (RHS.isEmpty())
-      // this is non-empty, but RHS is empty, so this > RHS
-      return false;
+    if (small != RHS.small)
+      return small < RHS.small;
 
-    size_t Lsize = size(), Rsize = RHS.size();
+    size_t Lsize = end, Rsize = RHS.end;
     size_t Li = 0, Ri = 0;
     while (Li < Lsize && Ri < Rsize) {
-      if ((*this)[Li] < RHS[Ri])
+      if (IDs[Li] < RHS.IDs[Ri])
         return true;
-      if ((*this)[Li] > RHS[Ri])
+      if (IDs[Li] > RHS.IDs[Ri])
         return false;
       // These locks are equal.  Go to the next lock
       ++Li;
@@ -221,29 +254,88 @@ public:
   }
 
   bool operator==(const LockSet_t &RHS) const {
-    // If either lockset is empty, then the locksets are equal only if they are
-    // both empty.
-    if (isEmpty() || RHS.isEmpty())
-      return (isEmpty() && RHS.isEmpty());
-
-    size_t Lsize = size(), Rsize = RHS.size();
-    size_t Li = 0, Ri = 0;
-    while (Li < Lsize && Ri < Rsize) {
-      if ((*this)[Li] != RHS[Ri])
+    if (small != RHS.small || end != RHS.end)
+      return false;
+    for (size_t i = 0; i < end; ++i)
+      if (IDs[i] != RHS.IDs[i])
         return false;
-      // These locks are equal.  Go to the next lock
-      ++Li;
-      ++Ri;
-    }
-
-    // this is a prefix of RHS or vice versa.  Return true if this is smaller than
-    // RHS, false otherwise.
-    return Lsize == Rsize;
+    return true;
   }
 
   bool operator!=(const LockSet_t &RHS) const {
     return !(*this == RHS);
   }
+
+  // Hash this lockset.
+  uint64_t hash() const {
+    uint64_t h = small * 0x9E3779B97F4A7C15UL;
+    for (size_t i = 0; i < end; ++i)
+      h = (h ^ (h >> 29) ^ IDs[i]) * 0xBF58476D1CE4E5B9UL;
+    return h ^ (h >> 32);
+  }
+};
+
+// ID of an interned lockset.
+using LockSetID_t = uint32_t;
+
+// Table of interned locksets.  Each distinct lockset is stored once and
+// identified by a 32-bit ID, so lockers store just an ID, and comparing the
+// locksets of two lockers compares two integers.  Results of intersecting
+// interned locksets are memoized in a small direct-mapped cache keyed by the
+// pair of IDs.
+class LockSetTable_t {
+public:
+  // ID of the empty lockset.
+  static constexpr LockSetID_t EMPTY_ID = 0;
+
+private:
+  static constexpr unsigned LG_MIN_TABLE_SIZE = 6;
+  static constexpr unsigned LG_CACHE_SIZE = 12;
+
+  struct CacheEntry_t {
+    uint64_t key;
+    IntersectionResult_t result;
+  };
+
+  // Interned locksets, indexed by ID.
+  static LockSet_t **sets;
+  static size_t num_sets;
+  static size_t sets_capacity;
+  // Hash table mapping locksets to their IDs.  Empty slots hold EMPTY_ID.
+  static LockSetID_t *table;
+  static unsigned lg_table_size;
+  // Cache of intersection results.
+  static CacheEntry_t *cache;
+
+  static IntersectionResult_t intersect_slow(LockSetID_t LHS, LockSetID_t RHS);
+
+public:
+  // Get the ID of lockset LS, interning LS if necessary.  Defined in
+  // locking.cpp.
+  static LockSetID_t intern(const LockSet_t &LS);
+
+  // Get the lockset with the given ID.
+  static const LockSet_t &get(LockSetID_t id) { return *sets[id]; }
+
+  // Intersect the locksets with IDs LHS and RHS, as LockSet_t::intersect.
+  __attribute__((always_inline)) static IntersectionResult_t
+  intersect(LockSetID_t LHS, LockSetID_t RHS) {
+    if (EMPTY_ID == LHS || EMPTY_ID == RHS)
+      return EMPTY;
+    if (LHS == RHS)
+      return static_cast<IntersectionResult_t>(
+          static_cast<uint8_t>(NONEMPTY) | static_cast<uint8_t>(L_EQUAL_R));
+    uint64_t key = (static_cast<uint64_t>(LHS) << 32) | RHS;
+    // The cache exists once any nonempty lockset has been interned.
+    const CacheEntry_t &entry =
+        cache[(key * 0x9E3779B97F4A7C15UL) >> (64 - LG_CACHE_SIZE)];
+    if (entry.key == key)
+      return entry.result;
+    return intersect_slow(LHS, RHS);
+  }
+
+  // Free the table.  Defined in locking.cpp.
+  static void destroy();
 };
 
 // Class representing a locker, which consists of a lock set and a
@@ -251,11 +343,11 @@ public:
 class Locker_t {
 public:
   MemoryAccess_t access;
-  LockSet_t lockset;
+  LockSetID_t lockset;
   Locker_t *next = nullptr;
 
   // Constructor
-  Locker_t(const MemoryAccess_t &access, const LockSet_t &lockset,
+  Locker_t(const MemoryAccess_t &access, LockSetID_t lockset,
            Locker_t *next = nullptr)
       : access(access), lockset(lockset), next(next) {}
   // Destructor
@@ -270,9 +362,8 @@ public:
   const MemoryAccess_t &getAccess() const { return access; }
   MemoryAccess_t &getAccess() { return access; }
 
-  // Get the lockset for this locker
-  const LockSet_t &getLockSet() const { return lockset; }
-  LockSet_t &getLockSet() { return lockset; }
+  // Get the ID of the lockset for this locker
+  LockSetID_t getLockSet() const { return lockset; }
 
   Locker_t *&getNext() { return next; }
   void setNext(Locker_t *locker) { next = locker; }
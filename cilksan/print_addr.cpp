@@ -1,13 +1,18 @@
 #include "csan.h"
 #include "cilksan_internal.h"
+#include "id_table.h"
+#include "race_writer.h"
+#include <algorithm>
 #include <cstring>
 #include <fstream>
 #include <iostream>
 #include <memory>
+#include <set>
 #include <signal.h>
 #include <sstream>
 #include <unistd.h>
 #include <unordered_map>
+#include <vector>
 
 extern bool is_running_under_rr;
 
@@ -15,15 +20,15 @@ std::ostream &outs = std::cerr;
 std::ofstream outf;
 
 // Mappings from CSI ID to associated program counter.
-uintptr_t *call_pc = nullptr;
-uintptr_t *spawn_pc = nullptr;
-uintptr_t *loop_pc = nullptr;
-uintptr_t *load_pc = nullptr;
-uintptr_t *store_pc = nullptr;
-uintptr_t *alloca_pc = nullptr;
-uintptr_t *allocfn_pc = nullptr;
-allocfn_prop_t *allocfn_prop = nullptr;
-uintptr_t *free_pc = nullptr;
+PCTable_t call_pc;
+PCTable_t spawn_pc;
+PCTable_t loop_pc;
+PCTable_t load_pc;
+PCTable_t store_pc;
+PCTable_t alloca_pc;
+PCTable_t allocfn_pc;
+AllocFnPropTable_t allocfn_prop;
+PCTable_t free_pc;
 
 typedef enum {
   LOAD_ACC,
@@ -371,18 +376,12 @@ bool CilkSanImpl_t::RunningUnderRR() {
   return false;
 }
 
-// static void print_race_info(const RaceInfo_t& race) {
-void RaceInfo_t::print(const AccessLoc_t &first_inst,
-                       const AccessLoc_t &second_inst,
-                       const AccessLoc_t &alloc_inst,
-                       const Decorator &d) const {
-  outs << d.Bold() << d.Error() << "Race detected on location "
-    // << (is_on_stack(race.addr) ? "stack address " : "address ")
-            << std::hex << addr << d.Default() << std::dec << "\n";
-
-  std::string first_acc_info, second_acc_info;
-  ACC_TYPE first_acc_type, second_acc_type;
-  switch(type) {
+// Helper function to determine the types of the two accesses involved in a
+// race.
+static void get_acc_types(enum RaceType_t type, const AccessLoc_t &first_inst,
+                          const AccessLoc_t &second_inst,
+                          ACC_TYPE &first_acc_type, ACC_TYPE &second_acc_type) {
+  switch (type) {
   case RW_RACE:
     switch(first_inst.getType()) {
     case MAType_t::FNRW:
@@ -492,6 +491,21 @@ void RaceInfo_t::print(const AccessLoc_t &first_inst,
     }
     break;
   }
+}
+
+// static void print_race_info(const RaceInfo_t& race) {
+void RaceInfo_t::print(const AccessLoc_t &first_inst,
+                       const AccessLoc_t &second_inst,
+                       const AccessLoc_t &alloc_inst,
+                       const Decorator &d) const {
+  outs << d.Bold() << d.Error() << "Race detected on location "
+    // << (is_on_stack(race.addr) ? "stack address " : "address ")
+            << std::hex << addr << d.Default() << std::dec << "\n";
+
+  std::string first_acc_info, second_acc_info;
+  ACC_TYPE first_acc_type, second_acc_type;
+  get_acc_types(type, first_inst, second_inst, first_acc_type,
+                second_acc_type);
   first_acc_info =
       get_info_on_mem_access(first_inst.getID(), first_acc_type, 0, d);
   second_acc_info =
@@ -547,31 +561,400 @@ static void open_outf(void) {
     outf.open("cilksan_races.out");
 }
 
+///////////////////////////////////////////////////////////////////////////
+// Machine-readable race records
+//
+// In the JSONL and BINARY output formats, Cilksan streams a compact record of
+// each distinct race when the race is found, rather than printing a full report
+// of the race.  A race record identifies the racing accesses and the
+// allocation by CSI ID, and it refers to their call stacks by ID.  Each call
+// stack is described once, by a stack record written before the first record
+// that refers to it.  Stack IDs are assigned in order of first use, so the
+// records for a given program and input do not depend on memory layout.
+//
+// Symbolization is deferred until Cilksan exits.  At that point, Cilksan
+// writes a location record for each CSI ID referenced by a race or stack
+// record, followed by a summary record.
+//
+// In the BINARY format, the output starts with the magic string "CSANRACE"
+// followed by a format version.  Each record starts with a tag byte, and
+// integers are written in unsigned LEB128 format.  CSI IDs, line numbers, and
+// column numbers are written incremented by 1, such that 0 denotes an unknown
+// value.
+
+// Kinds of program locations that CSI IDs in race records refer to.
+typedef enum {
+  LOAD_LOC,
+  STORE_LOC,
+  CALL_LOC,
+  SPAWN_LOC,
+  LOOP_LOC,
+  ALLOCFN_LOC,
+  FREE_LOC,
+  ALLOCA_LOC,
+  NUM_LOC_KINDS,
+} LOC_KIND;
+
+static const char *const loc_kind_str[NUM_LOC_KINDS] = {
+    "load", "store", "call", "spawn", "loop", "allocfn", "free", "alloca"};
+
+// Tags for records in the BINARY format.
+typedef enum : uint8_t {
+  STACK_RECORD = 1,
+  RACE_RECORD = 2,
+  LOC_RECORD = 3,
+  SUMMARY_RECORD = 4,
+} RECORD_TAG;
+
+static constexpr char BINARY_MAGIC[8] = {'C', 'S', 'A', 'N',
+                                         'R', 'A', 'C', 'E'};
+static constexpr uint64_t BINARY_VERSION = 1;
+
+static RaceWriter_t race_writer;
+// Map from call-stack nodes to the IDs of their stack records.  ID 0 denotes
+// the empty call stack.  Nodes in this map are pinned, so that they are never
+// reclaimed and their addresses are never reused for other call stacks.
+static std::unordered_map<const call_stack_node_t *, uint64_t> stack_record_ids;
+// CSI IDs referenced by records, for each kind of location.
+static std::set<csi_id_t> referenced_locs[NUM_LOC_KINDS];
+
+static LOC_KIND get_loc_kind(ACC_TYPE type) {
+  switch (type) {
+  case LOAD_ACC:
+    return LOAD_LOC;
+  case STORE_ACC:
+    return STORE_LOC;
+  case CALL_LOAD_ACC:
+  case CALL_STORE_ACC:
+  case STACK_FREE_ACC:
+    return CALL_LOC;
+  case ALLOC_LOAD_ACC:
+  case ALLOC_STORE_ACC:
+  case REALLOC_ACC:
+    return ALLOCFN_LOC;
+  case FREE_ACC:
+    return FREE_LOC;
+  }
+  return CALL_LOC;
+}
+
+static LOC_KIND get_loc_kind(CallType_t type) {
+  switch (type) {
+  case CALL:
+    return CALL_LOC;
+  case SPAWN:
+    return SPAWN_LOC;
+  case LOOP:
+    return LOOP_LOC;
+  }
+  return CALL_LOC;
+}
+
+static const char *get_acc_str(ACC_TYPE type) {
+  switch (type) {
+  case LOAD_ACC:
+  case CALL_LOAD_ACC:
+  case ALLOC_LOAD_ACC:
+    return "read";
+  case STORE_ACC:
+  case CALL_STORE_ACC:
+  case ALLOC_STORE_ACC:
+    return "write";
+  case FREE_ACC:
+  case STACK_FREE_ACC:
+    return "free";
+  case REALLOC_ACC:
+    return "realloc";
+  }
+  return "unknown";
+}
+
+static const char *get_race_str(enum RaceType_t type) {
+  switch (type) {
+  case RW_RACE:
+    return "RW";
+  case WW_RACE:
+    return "WW";
+  case WR_RACE:
+    return "WR";
+  }
+  return "unknown";
+}
+
+static void reference_loc(LOC_KIND kind, csi_id_t id) {
+  if (UNKNOWN_CSI_ID != id)
+    referenced_locs[kind].insert(id);
+}
+
+// Open the output for race records, if it is not open already.  Returns false
+// if the output could not be opened.
+static bool open_race_writer(CilkSanImpl_t::OutFormat_t format) {
+  if (race_writer.is_open())
+    return true;
+  const char *path = getenv("CILKSAN_OUT");
+  if (!path && format == CilkSanImpl_t::OutFormat_t::BINARY)
+    path = "cilksan_races.bin";
+  if (!path) {
+    race_writer.attach(STDERR_FILENO);
+  } else if (!race_writer.open(path)) {
+    outs << "WARNING: Failed to open " << path << " for race records.\n";
+    return false;
+  }
+  if (format == CilkSanImpl_t::OutFormat_t::BINARY) {
+    race_writer.write(BINARY_MAGIC, sizeof(BINARY_MAGIC));
+    race_writer.put_varint(BINARY_VERSION);
+  }
+  return true;
+}
+
+// Write stack records for any frames of the call stack ending at tail that
+// have not been written already.  Returns the ID of the call stack.
+static uint64_t write_stack_records(const call_stack_node_t *tail,
+                                    bool binary) {
+  if (!tail)
+    return 0;
+  auto found = stack_record_ids.find(tail);
+  if (found != stack_record_ids.end())
+    return found->second;
+
+  // Write the records for the parent call stack first, so that every record
+  // refers only to stacks described earlier in the output.
+  uint64_t parent = write_stack_records(tail->getPrev(), binary);
+  uint64_t id = stack_record_ids.size() + 1;
+  stack_record_ids.insert(std::make_pair(tail, id));
+  tail->pin();
+
+  const CallID_t &call = tail->getCallID();
+  LOC_KIND kind = get_loc_kind(call.getType());
+  csi_id_t csi_id = call.isUnknownID() ? UNKNOWN_CSI_ID : call.getID();
+  reference_loc(kind, csi_id);
+  if (binary) {
+    race_writer.put((char)STACK_RECORD);
+    race_writer.put_varint(id);
+    race_writer.put_varint(parent);
+    race_writer.put((char)kind);
+    race_writer.put_varint(csi_id + 1);
+  } else {
+    race_writer.put("{\"record\":\"stack\",\"id\":");
+    race_writer.put_dec(id);
+    race_writer.put(",\"parent\":");
+    race_writer.put_dec(parent);
+    race_writer.put(",\"loc\":\"");
+    race_writer.put(loc_kind_str[kind]);
+    race_writer.put("\",\"csi\":");
+    race_writer.put_dec((int64_t)csi_id);
+    race_writer.put("}\n");
+  }
+  return id;
+}
+
+// Write the description of one location involved in a race, whose kind is
+// kind and whose call stack has ID stack.
+static void write_race_loc(const char *acc, ACC_TYPE acc_type, LOC_KIND kind,
+                           csi_id_t csi_id, uint64_t stack, bool binary) {
+  reference_loc(kind, csi_id);
+  if (binary) {
+    if (acc)
+      race_writer.put((char)acc_type);
+    race_writer.put((char)kind);
+    race_writer.put_varint(csi_id + 1);
+    race_writer.put_varint(stack);
+  } else {
+    race_writer.put('{');
+    if (acc) {
+      race_writer.put("\"acc\":\"");
+      race_writer.put(acc);
+      race_writer.put("\",");
+    }
+    race_writer.put("\"loc\":\"");
+    race_writer.put(loc_kind_str[kind]);
+    race_writer.put("\",\"csi\":");
+    race_writer.put_dec((int64_t)csi_id);
+    race_writer.put(",\"stack\":");
+    race_writer.put_dec(stack);
+    race_writer.put('}');
+  }
+}
+
+void CilkSanImpl_t::write_race_record(const AccessLoc_t &first_inst,
+                                      const AccessLoc_t &second_inst,
+                                      const AccessLoc_t &alloc_inst,
+                                      uintptr_t addr,
+                                      enum RaceType_t race_type) {
+  if (!open_race_writer(out_format))
+    return;
+  bool binary = (out_format == OutFormat_t::BINARY);
+
+  ACC_TYPE first_acc_type, second_acc_type;
+  get_acc_types(race_type, first_inst, second_inst, first_acc_type,
+                second_acc_type);
+  uint64_t first_stack = write_stack_records(first_inst.getCallStack(), binary);
+  uint64_t second_stack =
+      write_stack_records(second_inst.getCallStack(), binary);
+  uint64_t alloc_stack = 0;
+  LOC_KIND alloc_kind = ALLOCA_LOC;
+  csi_id_t alloc_id = UNKNOWN_CSI_ID;
+  if (alloc_inst.isValid()) {
+    alloc_stack = write_stack_records(alloc_inst.getCallStack(), binary);
+    // Odd allocation IDs identify heap allocations, even IDs identify stack
+    // allocations.
+    alloc_kind = (alloc_inst.getID() % 2) ? ALLOCFN_LOC : ALLOCA_LOC;
+    alloc_id = alloc_inst.getID() / 2;
+  }
+
+  if (binary) {
+    race_writer.put((char)RACE_RECORD);
+    race_writer.put((char)race_type);
+    race_writer.put_varint(addr);
+  } else {
+    race_writer.put("{\"record\":\"race\",\"race\":\"");
+    race_writer.put(get_race_str(race_type));
+    race_writer.put("\",\"addr\":\"0x");
+    race_writer.put_hex(addr);
+    race_writer.put("\",\"first\":");
+  }
+  write_race_loc(get_acc_str(first_acc_type), first_acc_type,
+                 get_loc_kind(first_acc_type), first_inst.getID(), first_stack,
+                 binary);
+  if (!binary)
+    race_writer.put(",\"second\":");
+  write_race_loc(get_acc_str(second_acc_type), second_acc_type,
+                 get_loc_kind(second_acc_type), second_inst.getID(),
+                 second_stack, binary);
+  if (!binary)
+    race_writer.put(",\"alloc\":");
+  if (alloc_inst.isValid()) {
+    if (binary)
+      race_writer.put((char)1);
+    write_race_loc(nullptr, LOAD_ACC, alloc_kind, alloc_id, alloc_stack,
+                   binary);
+  } else if (binary) {
+    race_writer.put((char)0);
+  } else {
+    race_writer.put("null");
+  }
+  if (!binary)
+    race_writer.put("}\n");
+}
+
+// Get the PC and source information for the location of the given kind with
+// the given CSI ID.
+static uintptr_t get_loc_info(LOC_KIND kind, csi_id_t id,
+                              const csan_source_loc_t *&src_loc,
+                              const obj_source_loc_t *&obj_src_loc) {
+  src_loc = nullptr;
+  obj_src_loc = nullptr;
+  switch (kind) {
+  case LOAD_LOC:
+    src_loc = __csan_get_load_source_loc(id);
+    obj_src_loc = __csan_get_load_obj_source_loc(id);
+    return load_pc[id];
+  case STORE_LOC:
+    src_loc = __csan_get_store_source_loc(id);
+    obj_src_loc = __csan_get_store_obj_source_loc(id);
+    return store_pc[id];
+  case CALL_LOC:
+    src_loc = __csan_get_call_source_loc(id);
+    return call_pc[id];
+  case SPAWN_LOC:
+    src_loc = __csan_get_detach_source_loc(id);
+    return spawn_pc[id];
+  case LOOP_LOC:
+    src_loc = __csan_get_loop_source_loc(id);
+    return loop_pc[id];
+  case ALLOCFN_LOC:
+    src_loc = __csan_get_allocfn_source_loc(id);
+    obj_src_loc = __csan_get_allocfn_obj_source_loc(id);
+    return allocfn_pc[id];
+  case FREE_LOC:
+    src_loc = __csan_get_free_source_loc(id);
+    return free_pc[id];
+  case ALLOCA_LOC:
+    src_loc = __csan_get_alloca_source_loc(id);
+    obj_src_loc = __csan_get_alloca_obj_source_loc(id);
+    return alloca_pc[id];
+  case NUM_LOC_KINDS:
+    break;
+  }
+  return 0;
+}
+
+void CilkSanImpl_t::finish_race_records() {
+  if (!open_race_writer(out_format))
+    return;
+  bool binary = (out_format == OutFormat_t::BINARY);
+
+  // Symbolize all locations referenced by the records.
+  for (int kind = 0; kind < NUM_LOC_KINDS; ++kind) {
+    for (csi_id_t id : referenced_locs[kind]) {
+      const csan_source_loc_t *src_loc;
+      const obj_source_loc_t *obj_src_loc;
+      uintptr_t pc = get_loc_info((LOC_KIND)kind, id, src_loc, obj_src_loc);
+      const char *func = src_loc ? src_loc->name : nullptr;
+      const char *file = src_loc ? src_loc->filename : nullptr;
+      int32_t line = src_loc ? src_loc->line_number : -1;
+      int32_t col = src_loc ? src_loc->column_number : -1;
+      const char *var = obj_src_loc ? obj_src_loc->name : nullptr;
+      if (binary) {
+        race_writer.put((char)LOC_RECORD);
+        race_writer.put((char)kind);
+        race_writer.put_varint(id + 1);
+        race_writer.put_varint(pc);
+        race_writer.put_bin_str(func);
+        race_writer.put_bin_str(file);
+        race_writer.put_varint(line + 1);
+        race_writer.put_varint(col + 1);
+        race_writer.put_bin_str(var);
+      } else {
+        race_writer.put("{\"record\":\"loc\",\"loc\":\"");
+        race_writer.put(loc_kind_str[kind]);
+        race_writer.put("\",\"csi\":");
+        race_writer.put_dec((int64_t)id);
+        race_writer.put(",\"pc\":\"0x");
+        race_writer.put_hex(pc);
+        race_writer.put("\",\"func\":");
+        race_writer.put_json_str(func);
+        race_writer.put(",\"file\":");
+        race_writer.put_json_str(file);
+        race_writer.put(",\"line\":");
+        race_writer.put_dec((int64_t)line);
+        race_writer.put(",\"col\":");
+        race_writer.put_dec((int64_t)col);
+        race_writer.put(",\"var\":");
+        race_writer.put_json_str(var);
+        race_writer.put("}\n");
+      }
+    }
+  }
+
+  if (binary) {
+    race_writer.put((char)SUMMARY_RECORD);
+    race_writer.put_varint(get_num_races_found());
+    race_writer.put_varint(duplicated_races);
+  } else {
+    race_writer.put("{\"record\":\"summary\",\"races\":");
+    race_writer.put_dec((uint64_t)get_num_races_found());
+    race_writer.put(",\"duplicates\":");
+    race_writer.put_dec((uint64_t)duplicated_races);
+    race_writer.put("}\n");
+  }
+  race_writer.close();
+}
+
 // Log the race detected
 void CilkSanImpl_t::report_race(
     const AccessLoc_t &first_inst, const AccessLoc_t &second_inst,
     const AccessLoc_t &alloc_inst, uintptr_t addr,
     enum RaceType_t race_type) {
+  PhaseRAII_t phase(PHASE_REPORT);
   static int last_race_count = 0;
-  bool found = false;
-  // TODO: Make the key computation consistent with is_equivalent_race().
-  uint64_t key = first_inst < second_inst ?
-                              first_inst.getID() : second_inst.getID();
-  RaceInfo_t race(first_inst, second_inst, alloc_inst, addr, race_type);
-
-  std::pair<RaceMap_t::iterator, RaceMap_t::iterator> range;
-  range = races_found.equal_range(key);
-  while (range.first != range.second) {
-    const RaceInfo_t &in_map = range.first->second;
-    if (race.is_equivalent_race(in_map)) {
-      found = true;
-      break;
-    }
-    range.first++;
-  }
-  if (found) { // increment the dup count
-    duplicated_races++;
+  RaceSig_t sig(first_inst.getID(), first_inst.getType(), second_inst.getID(),
+                second_inst.getType(), alloc_inst.getID(), race_type);
+  if (is_duplicate_race(sig, addr)) {
+    return;
   } else {
+    if (summarize_races)
+      summarize_new_race(first_inst, second_inst, alloc_inst, addr, race_type);
     // have to get the info before user program exits
     if (is_running_under_rr) {
       // Open outf if it is not open already.
@@ -589,9 +972,12 @@ void CilkSanImpl_t::report_race(
              << " racing pairs.";
         last_race_count = get_num_races_found();
       }
-    } else
-      race.print(first_inst, second_inst, alloc_inst, Decorator(color_report));
-    races_found.insert(std::make_pair(key, race));
+    } else if (out_format != OutFormat_t::TEXT)
+      write_race_record(first_inst, second_inst, alloc_inst, addr, race_type);
+    else
+      RaceInfo_t(first_inst, second_inst, alloc_inst, addr, race_type)
+          .print(first_inst, second_inst, alloc_inst, Decorator(color_report));
+    races_found.insert(sig);
     if (PauseOnRace())
       // Raise a SIGTRAP to let the user examine the state of the program at
       // this point within the debugger.
@@ -605,11 +991,152 @@ void CilkSanImpl_t::report_race(
   report_race(first_inst, second_inst, AccessLoc_t(), addr, race_type);
 }
 
+// Summary of one distinct race, for summarizing races by allocation site.
+struct RaceSummary_t {
+  csi_id_t first_id;
+  csi_id_t second_id;
+  ACC_TYPE first_acc_type;
+  ACC_TYPE second_acc_type;
+  enum RaceType_t race_type;
+  // Index of the allocation group of this race.
+  uint32_t group;
+  // Number of reports of this race, including duplicates.
+  uint64_t count;
+};
+
+// Summary of all races on memory from one allocation site.
+struct AllocSummary_t {
+  csi_id_t alloc_id;
+  // Lowest and highest racing addresses.
+  uintptr_t low;
+  uintptr_t high;
+  // Number of race reports, including duplicates.
+  uint64_t count;
+  // Distinct races on this allocation, in order of detection.
+  std::vector<uint32_t> races;
+};
+
+// Race summaries, indexed by the number of the race in races_found.
+static std::vector<RaceSummary_t> race_summaries;
+static std::vector<AllocSummary_t> alloc_summaries;
+static std::unordered_map<csi_id_t, uint32_t> alloc_summary_index;
+
+static void update_alloc_summary(AllocSummary_t &group, uintptr_t addr) {
+  if (addr < group.low)
+    group.low = addr;
+  if (addr > group.high)
+    group.high = addr;
+  ++group.count;
+}
+
+void CilkSanImpl_t::summarize_new_race(const AccessLoc_t &first_inst,
+                                       const AccessLoc_t &second_inst,
+                                       const AccessLoc_t &alloc_inst,
+                                       uintptr_t addr,
+                                       enum RaceType_t race_type) {
+  csi_id_t alloc_id = alloc_inst.getID();
+  auto inserted =
+      alloc_summary_index.insert({alloc_id, (uint32_t)alloc_summaries.size()});
+  if (inserted.second)
+    alloc_summaries.push_back({alloc_id, addr, addr, 0, {}});
+  uint32_t group = inserted.first->second;
+  alloc_summaries[group].races.push_back(race_summaries.size());
+  update_alloc_summary(alloc_summaries[group], addr);
+
+  RaceSummary_t race;
+  get_acc_types(race_type, first_inst, second_inst, race.first_acc_type,
+                race.second_acc_type);
+  race.first_id = first_inst.getID();
+  race.second_id = second_inst.getID();
+  race.race_type = race_type;
+  race.group = group;
+  race.count = 1;
+  race_summaries.push_back(race);
+}
+
+void CilkSanImpl_t::summarize_duplicate_race(int64_t race_id, uintptr_t addr) {
+  // Races found before summarizing began have no summary.
+  if ((uint64_t)race_id >= race_summaries.size())
+    return;
+  RaceSummary_t &race = race_summaries[race_id];
+  ++race.count;
+  update_alloc_summary(alloc_summaries[race.group], addr);
+}
+
+// Helper function to get a brief description of one access in a race.
+static std::string get_summary_acc_str(ACC_TYPE type, csi_id_t id,
+                                       const Decorator &d) {
+  std::ostringstream convert;
+  convert << get_acc_str(type);
+  if (UNKNOWN_CSI_ID == id)
+    return convert.str();
+  const csan_source_loc_t *src_loc;
+  const obj_source_loc_t *obj_src_loc;
+  uintptr_t pc = get_loc_info(get_loc_kind(type), id, src_loc, obj_src_loc);
+  convert << " " << d.InstAddress() << std::hex << pc << std::dec
+          << d.Default();
+  if (src_loc)
+    convert << " in" << get_src_info_str(src_loc, d);
+  return convert.str();
+}
+
+void CilkSanImpl_t::print_race_summary() {
+  // Number of racing instruction pairs to print for each allocation site.
+  static constexpr unsigned MAX_PAIRS = 3;
+  Decorator d(color_report);
+
+  std::vector<uint32_t> groups(alloc_summaries.size());
+  for (uint32_t i = 0; i < groups.size(); ++i)
+    groups[i] = i;
+  std::stable_sort(groups.begin(), groups.end(), [](uint32_t a, uint32_t b) {
+    return alloc_summaries[a].count > alloc_summaries[b].count;
+  });
+
+  outs << "\n" << d.Bold() << "Race summary by allocation site:" << d.Default()
+       << "\n";
+  for (uint32_t g : groups) {
+    AllocSummary_t &group = alloc_summaries[g];
+    outs << "\n";
+    if (UNKNOWN_CSI_ID != group.alloc_id)
+      outs << get_info_on_alloca(group.alloc_id, d) << "\n";
+    else
+      outs << "<no allocation information>\n";
+    outs << "  " << group.races.size() << " distinct races, " << group.count
+         << " reports, on addresses [" << std::hex << group.low << ", "
+         << group.high << "]" << std::dec << "\n";
+
+    std::stable_sort(group.races.begin(), group.races.end(),
+                     [](uint32_t a, uint32_t b) {
+                       return race_summaries[a].count >
+                              race_summaries[b].count;
+                     });
+    for (size_t i = 0; i < group.races.size() && i < MAX_PAIRS; ++i) {
+      const RaceSummary_t &race = race_summaries[group.races[i]];
+      outs << "  " << race.count << " x " << get_race_str(race.race_type)
+           << " race:\n";
+      outs << "    "
+           << get_summary_acc_str(race.first_acc_type, race.first_id, d)
+           << "\n";
+      outs << "    "
+           << get_summary_acc_str(race.second_acc_type, race.second_id, d)
+           << "\n";
+    }
+    if (group.races.size() > MAX_PAIRS)
+      outs << "  ... and " << (group.races.size() - MAX_PAIRS)
+           << " more distinct races\n";
+  }
+}
+
 int CilkSanImpl_t::get_num_races_found() {
   return races_found.size();
 }
 
 void CilkSanImpl_t::print_race_report() {
+  PhaseRAII_t phase(PHASE_REPORT);
+  if (out_format != OutFormat_t::TEXT && !is_running_under_rr)
+    finish_race_records();
+  if (summarize_races && !is_running_under_rr)
+    print_race_summary();
   outs << "\n";
   outs << "Cilksan detected " << get_num_races_found() << " distinct races.\n";
   if (!is_running_under_rr) {
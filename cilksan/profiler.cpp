@@ -0,0 +1,145 @@
+#include "profiler.h"
+#include <algorithm>
+#include <csignal>
+#include <cstdio>
+#include <sys/time.h>
+
+extern FILE *err_io;
+
+volatile uint8_t tool_phase = PHASE_PROGRAM;
+volatile uintptr_t hook_pc = 0;
+
+// Sampling interval of the profiler, in microseconds of CPU time.
+static constexpr long SAMPLE_INTERVAL_US = 1000;
+
+// log_2 of the number of hook call sites the profile can distinguish.
+static constexpr unsigned LG_NUM_SITES = 10;
+// Number of hook call sites to print in the profile.
+static constexpr unsigned NUM_SITES_PRINTED = 20;
+
+static const char *const phase_names[NUM_TOOL_PHASES] = {
+    "program", "hook", "libhook", "shadow", "bags", "call stack", "report"};
+
+// Samples taken while a hook invoked from a given program PC was executing.
+struct SiteSamples_t {
+  uintptr_t pc;
+  uint64_t samples[NUM_TOOL_PHASES];
+  uint64_t total;
+};
+
+// The profile.  The signal handler updates these tables, so they are
+// statically allocated, and the handler never allocates memory.
+static uint64_t phase_samples[NUM_TOOL_PHASES] = {0};
+static SiteSamples_t sites[1UL << LG_NUM_SITES];
+// Number of samples whose hook call site did not fit in sites.
+static uint64_t dropped_site_samples = 0;
+
+bool profiler_enabled = false;
+static struct sigaction old_action;
+
+static void record_sample(int) {
+  uint8_t phase = tool_phase;
+  ++phase_samples[phase];
+  if (phase == PHASE_PROGRAM)
+    return;
+
+  // Find the entry for the hook call site in the open-addressing table sites.
+  uintptr_t pc = hook_pc;
+  uintptr_t mask = (1UL << LG_NUM_SITES) - 1;
+  uintptr_t i = (pc * 0x9E3779B97F4A7C15UL) >> (64 - LG_NUM_SITES);
+  for (uintptr_t probes = 0; probes <= mask; ++probes, i = (i + 1) & mask) {
+    if (sites[i].pc == pc || !sites[i].total) {
+      sites[i].pc = pc;
+      ++sites[i].samples[phase];
+      ++sites[i].total;
+      return;
+    }
+  }
+  ++dropped_site_samples;
+}
+
+void start_profiler() {
+  struct sigaction action = {};
+  action.sa_handler = record_sample;
+  action.sa_flags = SA_RESTART;
+  sigemptyset(&action.sa_mask);
+  if (sigaction(SIGPROF, &action, &old_action)) {
+    perror("Cilksan: failed to install profiler");
+    return;
+  }
+
+  struct itimerval timer = {};
+  timer.it_interval.tv_usec = SAMPLE_INTERVAL_US;
+  timer.it_value.tv_usec = SAMPLE_INTERVAL_US;
+  if (setitimer(ITIMER_PROF, &timer, nullptr)) {
+    perror("Cilksan: failed to start profiler");
+    sigaction(SIGPROF, &old_action, nullptr);
+    return;
+  }
+  profiler_enabled = true;
+}
+
+// Helper function to print a number of samples and its percentage of total.
+static void print_samples(uint64_t samples, uint64_t total) {
+  fprintf(err_io, " %10lu %6.2f%%", samples,
+          total ? (100.0 * samples) / total : 0.0);
+}
+
+void stop_profiler() {
+  if (!profiler_enabled)
+    return;
+  profiler_enabled = false;
+
+  struct itimerval timer = {};
+  setitimer(ITIMER_PROF, &timer, nullptr);
+  sigaction(SIGPROF, &old_action, nullptr);
+
+  uint64_t total = 0;
+  for (unsigned p = 0; p < NUM_TOOL_PHASES; ++p)
+    total += phase_samples[p];
+  uint64_t tool_total = total - phase_samples[PHASE_PROGRAM];
+
+  fprintf(err_io, "\nCilksan profile: %lu samples at %ld us intervals\n",
+          total, SAMPLE_INTERVAL_US);
+  fprintf(err_io, "%-12s %10s %7s\n", "phase", "samples", "total");
+  for (unsigned p = 0; p < NUM_TOOL_PHASES; ++p) {
+    fprintf(err_io, "%-12s", phase_names[p]);
+    print_samples(phase_samples[p], total);
+    fprintf(err_io, "\n");
+  }
+  if (!tool_total) {
+    fflush(err_io);
+    return;
+  }
+
+  // Sort the hook call sites by their total samples.
+  SiteSamples_t *ranked[1UL << LG_NUM_SITES];
+  unsigned num_sites = 0;
+  for (SiteSamples_t &site : sites)
+    if (site.total)
+      ranked[num_sites++] = &site;
+  unsigned num_printed = std::min(num_sites, NUM_SITES_PRINTED);
+  std::partial_sort(ranked, ranked + num_printed, ranked + num_sites,
+                    [](const SiteSamples_t *a, const SiteSamples_t *b) {
+                      return a->total > b->total;
+                    });
+
+  fprintf(err_io, "\nTop hook call sites by tool samples:\n");
+  fprintf(err_io, "%-18s %10s %7s", "call site", "samples", "tool");
+  for (unsigned p = PHASE_PROGRAM + 1; p < NUM_TOOL_PHASES; ++p)
+    fprintf(err_io, " %10s", phase_names[p]);
+  fprintf(err_io, "\n");
+  for (unsigned i = 0; i < num_printed; ++i) {
+    const SiteSamples_t *site = ranked[i];
+    fprintf(err_io, "%#-18lx", site->pc);
+    print_samples(site->total, tool_total);
+    for (unsigned p = PHASE_PROGRAM + 1; p < NUM_TOOL_PHASES; ++p)
+      fprintf(err_io, " %10lu", site->samples[p]);
+    fprintf(err_io, "\n");
+  }
+  if (dropped_site_samples)
+    fprintf(err_io, "(%lu samples from call sites that did not fit in the "
+            "profile)\n",
+            dropped_site_samples);
+  fflush(err_io);
+}
@@ -0,0 +1,66 @@
+// -*- C++ -*-
+#ifndef __PROFILER_H__
+#define __PROFILER_H__
+
+#include <cstdint>
+
+// Sampling profiler for the overhead of Cilksan itself, enabled by setting the
+// CILKSAN_PROFILE environment variable.  Cilksan tags the phase of the tool it
+// is executing by writing a global variable, and a profiling timer
+// periodically samples that phase, together with the program PC that invoked
+// the current hook.  At exit, Cilksan prints a breakdown of the samples by
+// phase and by hook call site.
+//
+// Because Cilksan executes the program serially, the phase is a single global
+// variable, rather than a thread-local variable, which also lets the timer
+// signal sample it regardless of which thread the signal is delivered to.
+
+// Phases of the tool.
+enum ToolPhase_t : uint8_t {
+  PHASE_PROGRAM = 0, // Executing the program, outside of any hook
+  PHASE_HOOK,        // Driver bookkeeping in a hook
+  PHASE_LIBHOOK,     // Modeling a library call
+  PHASE_SHADOW,      // Checking and updating shadow memory
+  PHASE_BAGS,        // Maintaining SP-bags
+  PHASE_CALL_STACK,  // Maintaining the call stack and stack frames
+  PHASE_REPORT,      // Reporting races
+  NUM_TOOL_PHASES,
+};
+
+// Current phase of the tool, and the program PC that invoked the current hook.
+extern volatile uint8_t tool_phase;
+extern volatile uintptr_t hook_pc;
+
+// Whether the profiler is running.
+extern bool profiler_enabled;
+
+// RAII object to tag the tool phase for the duration of a scope.  Phases are
+// tagged only while the profiler is running, so that otherwise the hooks pay
+// for just a predictable branch, not for stores to volatile variables.
+struct PhaseRAII_t {
+  uint8_t prev = PHASE_PROGRAM;
+
+  __attribute__((always_inline)) PhaseRAII_t(ToolPhase_t phase) {
+    if (__builtin_expect(profiler_enabled, false)) {
+      prev = tool_phase;
+      tool_phase = phase;
+    }
+  }
+  // Constructor for the outermost phase of a hook invoked from program PC pc.
+  __attribute__((always_inline)) PhaseRAII_t(ToolPhase_t phase, uintptr_t pc)
+      : PhaseRAII_t(phase) {
+    if (__builtin_expect(profiler_enabled, false))
+      hook_pc = pc;
+  }
+  __attribute__((always_inline)) ~PhaseRAII_t() {
+    if (__builtin_expect(profiler_enabled, false))
+      tool_phase = prev;
+  }
+};
+
+// Start the profiler, sampling once per millisecond of CPU time.
+void start_profiler();
+// Stop the profiler, and print the profile to err_io.
+void stop_profiler();
+
+#endif // __PROFILER_H__
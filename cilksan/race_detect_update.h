@@ -54,14 +54,14 @@ check_races_and_update_fast(const csi_id_t acc_id, MAType_t type,
 // done checking, update shadow_memory with this new read access.
 __attribute__((always_inline)) void check_data_races_and_update_with_read(
     const csi_id_t acc_id, MAType_t type, uintptr_t addr, size_t mem_size,
-    FrameData_t *f, const LockSet_t &lockset, SimpleShadowMem &shadow_memory);
+    FrameData_t *f, LockSetID_t lockset, SimpleShadowMem &shadow_memory);
 
 // Check data races on memory [addr, addr+mem_size) with this write access. Once
 // done checking, update shadow_memory with this new read access.  Very similar
 // to check_data_races_and_update_with_read function.
 __attribute__((always_inline)) void check_data_races_and_update_with_write(
     const csi_id_t acc_id, MAType_t type, uintptr_t addr, size_t mem_size,
-    FrameData_t *f, const LockSet_t &lockset, SimpleShadowMem &shadow_memory);
+    FrameData_t *f, LockSetID_t lockset, SimpleShadowMem &shadow_memory);
 
 // Check data races on memory [addr, addr+mem_size) with this memory access.
 // Once done checking, update shadow_memory with the new access.
@@ -76,7 +76,7 @@ __attribute__((always_inline)) void check_data_races_and_update_with_write(
 template <bool is_read>
 void check_data_races_and_update(const csi_id_t acc_id, MAType_t type,
                                  uintptr_t addr, size_t mem_size, FrameData_t *f,
-                                 const LockSet_t &lockset,
+                                 LockSetID_t lockset,
                                  SimpleShadowMem &shadow_memory);
 
 #endif // __RACE_DETECT_UPDATE__
@@ -4,6 +4,7 @@
 
 #include "debug_util.h"
 #include <csi/csi.h>
+#include <cstdint>
 #include <ostream>
 
 #ifndef CHECK_EQUIVALENT_STACKS
@@ -101,6 +102,11 @@ public:
     return typed_id.getID();
   }
 
+  // Get the type and CSI ID of this call-stack frame, packed into one value
+  inline csi_id_t get() const {
+    return typed_id.get();
+  }
+
   // Returns true if this frame has an unknown ID.
   inline bool isUnknownID() const {
     return typed_id.isUnknownID();
@@ -132,44 +138,106 @@ public:
 };
 
 // Specialized stack data structure for representing the call stack.  Cilksan
-// models the call stack using a singly-linked list with reference-counted
-// nodes.  When a race is recorded, the call stack for that race is preserved by
-// saving a pointer to the tail of the call stack.
-
-// Class for reference-counted nodes on the call stack.
+// models the call stack using a singly-linked list of nodes, where each node
+// refers to its parent.  Nodes are hash-consed into a trie keyed by (parent,
+// CallID_t), so that identical call stacks share a single node.  Pushing or
+// popping a frame is therefore a lookup in the trie, and a call stack can be
+// saved, e.g., when a race is recorded, by simply copying a pointer to its
+// tail.
+//
+// Nodes are not reference counted.  Instead, nodes are reclaimed in epochs:
+// once the number of nodes reaches a threshold, the next lookup that would
+// create a node first marks every node reachable from a live call stack, and
+// then returns all unmarked nodes to a free list.  The live call stacks are the
+// call stack being pushed, the call stacks stored in live disjoint sets, which
+// cover all call stacks referenced from shadow memory, and any pinned stacks.
+// The threshold is then set to twice the number of surviving nodes, so the
+// cost of collection is amortized over the nodes created between collections.
+// Nodes are allocated from an arena, which is released in one shot when
+// Cilksan shuts down.
+
+// Class for hash-consed nodes on the call stack.
 class call_stack_node_t {
   friend class call_stack_t;
   friend class AccessLoc_t;
 
-  // A node on the call stack contains a frame, a pointer to a previous (parent)
-  // node, and a reference count.
+  // A node on the call stack contains a frame and a pointer to a previous
+  // (parent) node.
   CallID_t id;
   call_stack_node_t *prev;
-  int64_t ref_count;
+  // Next node in the same bucket of the hash-consing table.
+  call_stack_node_t *next_in_bucket = nullptr;
+  // Most recent child of this node returned by a lookup.  Most calls from a
+  // given context target the same callee, so caching this child lets most
+  // pushes avoid probing the hash-consing table.
+  call_stack_node_t *last_child = nullptr;
+  // Set on nodes reachable from a live call stack during a collection.
+  mutable bool marked = false;
+  // Set on nodes that must never be reclaimed.
+  mutable bool pinned = false;
 
-public:
   // Constructor
-  call_stack_node_t(CallID_t id, call_stack_node_t *prev = nullptr)
-      // Set ref_count to 1, under the assumption that only call_stack_t
-      // constructs nodes and will immediately set the tail pointer to point to
-      // this node.
-      : id(id), prev(prev), ref_count(1) {
-    if (prev)
-      prev->ref_count++;
-  }
-  // Destructor
-  ~call_stack_node_t() {
-    cilksan_assert(!ref_count);
-    if (prev) {
-      call_stack_node_t *old_prev = prev;
-      prev = nullptr;
-      cilksan_assert(old_prev->ref_count > 0);
-      old_prev->ref_count--;
-      if (!old_prev->ref_count)
-        delete old_prev;
+  call_stack_node_t(CallID_t id, call_stack_node_t *prev)
+      : id(id), prev(prev) {}
+
+  // Arena of call-stack nodes.  Nodes are bump-allocated from fixed-size
+  // chunks, which are chained together so they can be released at the end of
+  // execution.  Defined in cilksan.cpp.
+  struct Chunk_t;
+  static Chunk_t *arena;
+
+  // Hash-consing table.  Buckets are chained through next_in_bucket.
+  static constexpr unsigned LG_MIN_TABLE_SIZE = 10;
+  static call_stack_node_t **table;
+  static unsigned lg_table_size;
+  static size_t num_nodes;
+  // Cached root node, analogous to last_child for the empty call stack.
+  static call_stack_node_t *last_root;
+
+  // Reclaimed nodes, chained through next_in_bucket.
+  static call_stack_node_t *free_nodes;
+  // Number of nodes at which the next collection happens.
+  static constexpr size_t MIN_COLLECT_THRESHOLD = 1UL << 16;
+  static size_t collect_threshold;
+
+  static inline size_t hash(CallID_t id, const call_stack_node_t *prev,
+                            unsigned lg_size) {
+    uint64_t key = reinterpret_cast<uintptr_t>(prev) ^
+                   (id.get() * 0x9E3779B97F4A7C15UL);
+    key ^= key >> 29;
+    key *= 0xBF58476D1CE4E5B9UL;
+    key ^= key >> 32;
+    return key & ((1UL << lg_size) - 1);
+  }
+
+  // Slow path for lookup.  Find the node for id with parent prev in the
+  // hash-consing table, creating it if necessary.  Defined in cilksan.cpp.
+  static call_stack_node_t *intern(CallID_t id, call_stack_node_t *prev);
+
+  // Reclaim all nodes that are not reachable from live_tail, from the call
+  // stack of a live disjoint set, or from a pinned node.  Defined in
+  // cilksan.cpp.
+  static void collect(call_stack_node_t *live_tail);
+
+  // Mark node and its ancestors, stopping at the first node already marked.
+  static void mark(const call_stack_node_t *node) {
+    while (node && !node->marked) {
+      node->marked = true;
+      node = node->prev;
     }
   }
 
+public:
+  // Get the unique node for id with parent prev.
+  static inline call_stack_node_t *lookup(CallID_t id,
+                                          call_stack_node_t *prev) {
+    call_stack_node_t *&cache = prev ? prev->last_child : last_root;
+    if (__builtin_expect(cache && cache->id == id, true))
+      return cache;
+    cache = intern(id, prev);
+    return cache;
+  }
+
   // Get the ID of this call-stack frame
   inline const CallID_t &getCallID() const {
     return id;
@@ -180,37 +248,20 @@ public:
     return prev;
   }
 
-  // Simple free-list allocator to conserve space and time in managing
-  // call_stack_node_t objects.
-  static call_stack_node_t *free_list;
-
-  // Overloaded new operator for free-list allocator
-  void *operator new(size_t size) {
-    if (free_list) {
-      call_stack_node_t *new_node = free_list;
-      free_list = free_list->prev;
-      return new_node;
-    }
-    return ::operator new(size);
-  }
+  // Get the number of call-stack nodes currently allocated.
+  static size_t getNumNodes() { return num_nodes; }
 
-  // Overloaded delete operator for free-list allocator
-  void operator delete(void *ptr) {
-    call_stack_node_t *del_node = reinterpret_cast<call_stack_node_t *>(ptr);
-    del_node->prev = free_list;
-    free_list = del_node;
+  // Prevent this node and its ancestors from being reclaimed, e.g., because
+  // their addresses are used as keys in an output table.
+  void pin() const {
+    for (const call_stack_node_t *node = this; node && !node->pinned;
+         node = node->prev)
+      node->pinned = true;
   }
 
-  // Static method for cleaning up the free-list at the end of the program
-  static void cleanup_freelist() {
-    call_stack_node_t *node = free_list;
-    call_stack_node_t *next = nullptr;
-    while (node) {
-      next = node->prev;
-      ::operator delete(node);
-      node = next;
-    }
-  }
+  // Static method for releasing all call-stack nodes at the end of the
+  // program.  Defined in cilksan.cpp.
+  static void cleanup();
 };
 
 // Top-level class for the call stack.
@@ -221,25 +272,6 @@ class call_stack_t {
   call_stack_node_t *tail = nullptr;
 
 public:
-  // Default constructor
-  call_stack_t() {}
-  // Copy constructor
-  call_stack_t(const call_stack_t &copy) : tail(copy.tail) {
-    if (tail)
-      tail->ref_count++;
-  }
-  // Destructor
-  ~call_stack_t() {
-    if (tail) {
-      call_stack_node_t *old_tail = tail;
-      tail = nullptr;
-      cilksan_assert(old_tail->ref_count > 0);
-      old_tail->ref_count--;
-      if (!old_tail->ref_count)
-        delete old_tail;
-    }
-  }
-
   // Get the end of this call stack
   inline const call_stack_node_t *getTail() const {
     return tail;
@@ -250,63 +282,15 @@ public:
     return tail->id == id;
   }
 
-  // Copy-assignment operator
-  inline call_stack_t &operator=(const call_stack_t &copy) {
-    call_stack_node_t *old_tail = tail;
-    tail = copy.tail;
-    if (tail)
-      tail->ref_count++;
-    if (old_tail) {
-      old_tail->ref_count--;
-      if (!old_tail->ref_count)
-        delete old_tail;
-    }
-    return *this;
-  }
-
-  // Move-assignment operator
-  inline call_stack_t &operator=(const call_stack_t &&move) {
-    if (tail) {
-      tail->ref_count--;
-      if (!tail->ref_count)
-        delete tail;
-    }
-    tail = move.tail;
-    return *this;
-  }
-
-  inline void overwrite(const call_stack_t &copy) {
-    tail = copy.tail;
-  }
-
   // Push a new call-stack frame onto this call stack
   inline void push(CallID_t id) {
-    call_stack_node_t *new_node = new call_stack_node_t(id, tail);
-    // new_node has ref_count 1 and, if tail was not null, has incremented
-    // tail's ref count.
-    tail = new_node;
-    // Decrement the tail's ref_count, since we no longer point to that tail
-    if (tail->prev) {
-      cilksan_assert(tail->prev->ref_count > 1);
-      tail->prev->ref_count--;
-    }
-    // Now the ref_count's should reflect the pointer structure.
+    tail = call_stack_node_t::lookup(id, tail);
   }
 
   // Pop the call-stack frame off the end of this call stack
   inline void pop() {
     cilksan_assert(tail);
-    call_stack_node_t *old_node = tail;
     tail = tail->prev;
-    // Increment the new tail's ref_count, since we now point to it
-    if (tail)
-      tail->ref_count++;
-    // Decrement the old tail's ref_count, and delete it if necessary
-    cilksan_assert(old_node->ref_count > 0);
-    old_node->ref_count--;
-    if (!old_node->ref_count)
-      // Deleting the old node will decrement tail's ref_count.
-      delete old_node;
   }
 
   // Get the size of this call stack
@@ -342,16 +326,8 @@ public:
               const call_stack_t &_call_stack)
       : acc_loc(_acc_loc), type(_type), call_stack(_call_stack) {}
 
-  // Copy constructor
-  AccessLoc_t(const AccessLoc_t &copy)
-      : acc_loc(copy.acc_loc), type(copy.type), call_stack(copy.call_stack) {}
-
-  // Move constructor
-  AccessLoc_t(AccessLoc_t &&move) : acc_loc(move.acc_loc), type(move.type) {
-    call_stack.overwrite(move.call_stack);
-  }
-
-  // Destructor
+  AccessLoc_t(const AccessLoc_t &copy) = default;
+  AccessLoc_t(AccessLoc_t &&move) = default;
   ~AccessLoc_t() = default;
 
   // Accessors
@@ -365,61 +341,20 @@ public:
   inline bool isValid() const { return acc_loc != UNKNOWN_CSI_ID; }
 
   inline void invalidate() {
-    dec_ref_count();
     call_stack.tail = nullptr;
     acc_loc = UNKNOWN_CSI_ID;
   }
 
-  // Copy assignment operator
-  inline AccessLoc_t& operator=(const AccessLoc_t &copy) {
-    acc_loc = copy.acc_loc;
-    type = copy.type;
-    call_stack = copy.call_stack;
-    return *this;
-  }
-  // Move assignment operator
-  inline AccessLoc_t& operator=(AccessLoc_t &&move) {
-    acc_loc = move.acc_loc;
-    type = move.type;
-    call_stack = std::move(move.call_stack);
-    return *this;
-  }
-
-  // Methods for managing the reference count
-  inline int64_t inc_ref_count(int64_t count = 1) {
-    if (!call_stack.tail)
-      return 0;
-    call_stack.tail->ref_count += count;
-    return call_stack.tail->ref_count;
-  }
-
-  inline int64_t dec_ref_count(int64_t count = 1) {
-    if (!call_stack.tail)
-      return 0;
-    cilksan_assert(call_stack.tail->ref_count >= count);
-    call_stack.tail->ref_count -= count;
-    if (!call_stack.tail->ref_count) {
-      delete call_stack.tail;
-      call_stack.tail = nullptr;
-      return 0;
-    }
-    return call_stack.tail->ref_count;
-  }
+  AccessLoc_t &operator=(const AccessLoc_t &copy) = default;
+  AccessLoc_t &operator=(AccessLoc_t &&move) = default;
 
   // Equality comparison operator
   inline bool operator==(const AccessLoc_t &that) const {
     if (acc_loc != that.acc_loc || type != that.type)
       return false;
 #if CHECK_EQUIVALENT_STACKS
-    call_stack_node_t *this_node = call_stack.tail;
-    call_stack_node_t *that_node = that.call_stack.tail;
-    while (this_node && that_node) {
-      if (this_node->id != that_node->id)
-        return false;
-      this_node = this_node->prev;
-      that_node = that_node->prev;
-    }
-    if (this_node || that_node)
+    // Call-stack nodes are hash-consed, so equivalent stacks share a tail.
+    if (call_stack.tail != that.call_stack.tail)
       return false;
 #endif // CHECK_EQUIVALENT_STACKS
     return true;
@@ -521,17 +456,6 @@ public:
 
   ~RaceInfo_t() = default;
 
-  bool is_equivalent_race(const RaceInfo_t& other) const {
-    if (((first_acc == other.first_acc && second_acc == other.second_acc &&
-          type == other.type) ||
-         (first_acc == other.second_acc && second_acc == other.first_acc &&
-          type == flipRaceType(other.type))) &&
-        alloc_id == other.alloc_id) {
-      return true;
-    }
-    return false;
-  }
-
   inline void print(const AccessLoc_t &first, const AccessLoc_t &second,
                     const AccessLoc_t &alloc, const Decorator &d) const;
 };
@@ -0,0 +1,134 @@
+// -*- C++ -*-
+#ifndef __RACE_SET_H__
+#define __RACE_SET_H__
+
+#include <cstdint>
+#include <cstdlib>
+
+#include "race_info.h"
+
+// 128-bit signature of a race, used to recognize duplicate races.  Two races
+// are equivalent if they involve the same pair of instructions performing the
+// same types of accesses, in either order, on memory from the same allocation
+// site.  The signature hashes exactly that information, so equivalent races
+// always have the same signature, and the probability that two distinct races
+// share a signature is negligible.
+struct RaceSig_t {
+  uint64_t lo = 0;
+  uint64_t hi = 0;
+
+  RaceSig_t() = default;
+  RaceSig_t(csi_id_t first_id, MAType_t first_type, csi_id_t second_id,
+            MAType_t second_type, csi_id_t alloc_id, enum RaceType_t type) {
+    uint64_t first = typed_id_t<MAType_t>(first_type, first_id).get();
+    uint64_t second = typed_id_t<MAType_t>(second_type, second_id).get();
+    // Canonicalize the order of the two accesses.
+    if (first > second) {
+      uint64_t tmp = first;
+      first = second;
+      second = tmp;
+      type = flipRaceType(type);
+    }
+    if (first == second && type == WR_RACE)
+      type = RW_RACE;
+
+    // Compute the two halves of the signature with independent seeds.
+    lo = hash(first, second, alloc_id, type, 0x9E3779B97F4A7C15UL);
+    hi = hash(first, second, alloc_id, type, 0xC2B2AE3D27D4EB4FUL);
+    // Reserve the all-zero signature to mark empty slots.
+    if (!lo && !hi)
+      lo = 1;
+  }
+
+  bool isEmpty() const { return !lo && !hi; }
+  bool operator==(const RaceSig_t &that) const {
+    return lo == that.lo && hi == that.hi;
+  }
+
+private:
+  static uint64_t mix(uint64_t x) {
+    x ^= x >> 31;
+    x *= 0xBF58476D1CE4E5B9UL;
+    x ^= x >> 29;
+    x *= 0x94D049BB133111EBUL;
+    x ^= x >> 32;
+    return x;
+  }
+  static uint64_t hash(uint64_t first, uint64_t second, uint64_t alloc_id,
+                       uint64_t type, uint64_t seed) {
+    uint64_t h = mix(seed ^ type);
+    h = mix(h ^ alloc_id);
+    h = mix(h ^ second);
+    return mix(h ^ first);
+  }
+};
+
+// Set of signatures of the races found so far.  The set is a flat,
+// open-addressing hash table with linear probing, so that checking whether a
+// race is a duplicate touches just a few contiguous cache lines.  Each race in
+// the set is numbered in order of insertion.
+class RaceSet_t {
+  static constexpr unsigned LG_MIN_CAPACITY = 6;
+
+  struct Entry_t {
+    RaceSig_t sig;
+    uint32_t id;
+  };
+
+  Entry_t *table = nullptr;
+  size_t capacity = 0;
+  size_t num_races = 0;
+
+  size_t findSlot(const RaceSig_t &sig) const {
+    size_t mask = capacity - 1;
+    size_t i = sig.lo & mask;
+    while (!table[i].sig.isEmpty() && !(table[i].sig == sig))
+      i = (i + 1) & mask;
+    return i;
+  }
+
+  void grow() {
+    Entry_t *old_table = table;
+    size_t old_capacity = capacity;
+    capacity = old_capacity ? 2 * old_capacity : (1UL << LG_MIN_CAPACITY);
+    table = (Entry_t *)calloc(capacity, sizeof(Entry_t));
+    for (size_t i = 0; i < old_capacity; ++i)
+      if (!old_table[i].sig.isEmpty())
+        table[findSlot(old_table[i].sig)] = old_table[i];
+    free(old_table);
+  }
+
+public:
+  ~RaceSet_t() { free(table); }
+
+  size_t size() const { return num_races; }
+
+  // Returns the number of the race with signature sig, or -1 if the set does
+  // not contain sig.
+  __attribute__((always_inline)) int64_t find(const RaceSig_t &sig) const {
+    if (!num_races)
+      return -1;
+    const Entry_t &entry = table[findSlot(sig)];
+    return entry.sig.isEmpty() ? -1 : entry.id;
+  }
+
+  // Returns true if the set contains sig.
+  __attribute__((always_inline)) bool contains(const RaceSig_t &sig) const {
+    return find(sig) >= 0;
+  }
+
+  // Insert sig into the set.  Returns true if sig was not already in the set.
+  bool insert(const RaceSig_t &sig) {
+    // Keep the load factor at most 1/2.
+    if (2 * (num_races + 1) > capacity)
+      grow();
+    size_t i = findSlot(sig);
+    if (!table[i].sig.isEmpty())
+      return false;
+    table[i].sig = sig;
+    table[i].id = num_races++;
+    return true;
+  }
+};
+
+#endif // __RACE_SET_H__
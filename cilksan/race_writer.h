@@ -0,0 +1,171 @@
+// -*- C++ -*-
+#ifndef __RACE_WRITER_H__
+#define __RACE_WRITER_H__
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+// Buffered writer for machine-readable race records.  The writer accumulates
+// output in a fixed-size buffer and writes it to a file descriptor only when
+// the buffer fills or the writer is flushed, so that emitting a record costs
+// little more than a few memory copies.
+class RaceWriter_t {
+  static constexpr size_t BUF_SIZE = 1 << 16;
+
+  int fd = -1;
+  bool owns_fd = false;
+  char *buf = nullptr;
+  size_t len = 0;
+
+public:
+  ~RaceWriter_t() { close(); }
+
+  // Open the file at path for writing.  Returns false on failure.
+  bool open(const char *path) {
+    int new_fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (new_fd < 0)
+      return false;
+    attach(new_fd);
+    owns_fd = true;
+    return true;
+  }
+
+  // Write to the existing file descriptor new_fd, which the writer does not
+  // close.
+  void attach(int new_fd) {
+    close();
+    fd = new_fd;
+    owns_fd = false;
+    if (!buf)
+      buf = (char *)malloc(BUF_SIZE);
+  }
+
+  bool is_open() const { return fd >= 0; }
+
+  void flush() {
+    size_t written = 0;
+    while (written < len) {
+      ssize_t n = ::write(fd, buf + written, len - written);
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n <= 0)
+        break;
+      written += n;
+    }
+    len = 0;
+  }
+
+  void close() {
+    if (fd < 0)
+      return;
+    flush();
+    if (owns_fd)
+      ::close(fd);
+    fd = -1;
+    free(buf);
+    buf = nullptr;
+  }
+
+  // Methods for writing raw data.
+  void write(const void *data, size_t size) {
+    if (len + size > BUF_SIZE) {
+      flush();
+      if (size > BUF_SIZE) {
+        // Write large data directly, bypassing the buffer.
+        const char *p = (const char *)data;
+        while (size > 0) {
+          ssize_t n = ::write(fd, p, size);
+          if (n < 0 && errno == EINTR)
+            continue;
+          if (n <= 0)
+            return;
+          p += n;
+          size -= n;
+        }
+        return;
+      }
+    }
+    memcpy(buf + len, data, size);
+    len += size;
+  }
+  void put(char c) {
+    if (len == BUF_SIZE)
+      flush();
+    buf[len++] = c;
+  }
+  void put(const char *str) { write(str, strlen(str)); }
+
+  // Methods for writing text.
+  void put_dec(uint64_t val) {
+    char tmp[20];
+    int i = sizeof(tmp);
+    do {
+      tmp[--i] = '0' + (val % 10);
+      val /= 10;
+    } while (val);
+    write(&tmp[i], sizeof(tmp) - i);
+  }
+  void put_dec(int64_t val) {
+    if (val < 0) {
+      put('-');
+      put_dec(-(uint64_t)val);
+    } else {
+      put_dec((uint64_t)val);
+    }
+  }
+  void put_hex(uint64_t val) {
+    char tmp[16];
+    int i = sizeof(tmp);
+    do {
+      tmp[--i] = "0123456789abcdef"[val & 0xf];
+      val >>= 4;
+    } while (val);
+    write(&tmp[i], sizeof(tmp) - i);
+  }
+  // Write str as a JSON string literal, or null if str is null.
+  void put_json_str(const char *str) {
+    if (!str) {
+      put("null");
+      return;
+    }
+    put('"');
+    for (; *str; ++str) {
+      unsigned char c = *str;
+      if (c == '"' || c == '\\') {
+        put('\\');
+        put(c);
+      } else if (c < 0x20) {
+        put("\\u00");
+        put("0123456789abcdef"[c >> 4]);
+        put("0123456789abcdef"[c & 0xf]);
+      } else {
+        put(c);
+      }
+    }
+    put('"');
+  }
+
+  // Methods for writing binary data.  Integers are written in unsigned LEB128
+  // format.
+  void put_varint(uint64_t val) {
+    while (val >= 0x80) {
+      put((char)(val | 0x80));
+      val >>= 7;
+    }
+    put((char)val);
+  }
+  // Write str as its length followed by its bytes.  A null str is written the
+  // same as an empty string.
+  void put_bin_str(const char *str) {
+    size_t size = str ? strlen(str) : 0;
+    put_varint(size);
+    if (size)
+      write(str, size);
+  }
+};
+
+#endif // __RACE_WRITER_H__
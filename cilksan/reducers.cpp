@@ -148,7 +148,7 @@ void CilkSanImpl_t::reduce_local_views() {
   int32_t capacity = reducer_views->capacity;
   hyper_table::bucket *buckets = reducer_views->buckets;
   bool holdsLeftmostViews = false;
-  Vector_t<int32_t> keysToRemove;
+  Vector_t<uintptr_t> keysToRemove;
   for (int32_t i = 0; i < capacity; ++i) {
     hyper_table::bucket b = buckets[i];
     if (!is_valid(b.key))
@@ -180,7 +180,7 @@ void CilkSanImpl_t::reduce_local_views() {
     f->reducer_views = nullptr;
   } else {
     for (int32_t i = 0; i < keysToRemove.size(); ++i)
-      reducer_views->remove(buckets[keysToRemove[i]].key);
+      reducer_views->remove(keysToRemove[i]);
   }
 }
 
@@ -216,6 +216,13 @@ hyper_table::merge_two_hyper_tables(CilkSanImpl_t *__restrict__ tool,
     left_dst = false;
   }
 
+  // Grow the destination table at most once, up front, rather than letting
+  // individual insertions trigger a series of rebuilds.  Most merges combine
+  // tables holding views of the same reducers, so only grow the destination if
+  // it might overflow.
+  if (dst->occupancy + src->occupancy > (int32_t)dst->capacity)
+    dst->reserve(dst->occupancy + src->occupancy);
+
   int32_t src_capacity =
       (src->capacity < MIN_HT_CAPACITY) ? src->occupancy : src->capacity;
   hyper_table::bucket *src_buckets = src->buckets;
@@ -226,13 +233,14 @@ hyper_table::merge_two_hyper_tables(CilkSanImpl_t *__restrict__ tool,
       continue;
 
     // For each valid key in the source table, lookup that key in the
-    // destination table.
-    hyper_table::bucket *dst_bucket = dst->find(b.key);
+    // destination table.  The source bucket caches the hash of its key, so the
+    // key need not be rehashed.
+    hyper_table::bucket *dst_bucket = dst->find_hashed(b.key, b.hash);
 
     if (nullptr == dst_bucket) {
       // The destination table does not contain this key.  Insert the
       // key-value pair from the source table into the destination.
-      dst->insert(b);
+      dst->insert_hashed(b);
     } else {
       // Merge the two views in the source and destination buckets, being sure
       // to preserve left-to-right ordering.  Free the right view when done.
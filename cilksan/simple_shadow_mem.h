@@ -8,8 +8,12 @@
 #include "dictionary.h"
 #include "locksets.h"
 #include "shadow_mem_allocator.h"
+#include "stats.h"
+#include "suppressions.h"
 #include "vector.h"
 #include <cstdlib>
+#include <map>
+#include <tuple>
 #include <sys/mman.h>
 
 class SimpleShadowMem;
@@ -113,6 +117,15 @@ private:
       return Chunk_t(nextAddr, size - chunkSize);
     }
 
+    // Get the chunk after this chunk that starts at nextAddr, which must not
+    // precede addr.
+    __attribute__((always_inline)) Chunk_t skipTo(uintptr_t nextAddr) const {
+      size_t chunkSize = nextAddr - addr;
+      if (chunkSize >= size)
+        return Chunk_t(nextAddr, 0);
+      return Chunk_t(nextAddr, size - chunkSize);
+    }
+
     // Returns true if this Chunk_t is entirely contained within the line.
     __attribute__((always_inline)) bool withinLine() const {
       uintptr_t nextLineAddr = alignByNextGrainsize(addr, LG_LINE_SIZE);
@@ -183,6 +196,57 @@ private:
     __attribute__((always_inline)) static void invalidate(MemoryAccess_t &MA) {
       MA.invalidate();
     }
+
+    // Lines of MemoryAccess_t's can be coalesced when an access overwrites
+    // every entry in the line.
+    static constexpr bool CanCoalesce = true;
+
+    // Scans for runs of entries in a line.  Two MemoryAccess_t's are equal if
+    // and only if their ver_func fields are equal, and invalid entries have a
+    // null ver_func, so these scans compare just one word per entry.  The main
+    // loops test four entries at a time without branching on each entry, which
+    // compilers can turn into vector compares.
+
+    // Returns the index of the first entry in Data[Idx, NumEls) that is valid
+    // and differs from *Prev, or NumEls if there is none.  Prev may be null.
+    __attribute__((always_inline)) static uintptr_t
+    findNextDistinct(const MemoryAccess_t *Data, uintptr_t Idx,
+                     uintptr_t NumEls, const MemoryAccess_t *Prev) {
+      uintptr_t Key = Prev ? Prev->ver_func : 0;
+      for (; Idx + 4 <= NumEls; Idx += 4) {
+        uintptr_t V0 = Data[Idx].ver_func, V1 = Data[Idx + 1].ver_func;
+        uintptr_t V2 = Data[Idx + 2].ver_func, V3 = Data[Idx + 3].ver_func;
+        if ((V0 && V0 != Key) | (V1 && V1 != Key) | (V2 && V2 != Key) |
+            (V3 && V3 != Key))
+          break;
+      }
+      for (; Idx < NumEls; ++Idx) {
+        uintptr_t V = Data[Idx].ver_func;
+        if (V && V != Key)
+          return Idx;
+      }
+      return NumEls;
+    }
+
+    // Returns the index of the first entry in Data[Idx, NumEls) that is invalid
+    // or differs from *Prev, or NumEls if there is none.  Returns Idx if Prev
+    // is null or invalid.
+    __attribute__((always_inline)) static uintptr_t
+    findRunEnd(const MemoryAccess_t *Data, uintptr_t Idx, uintptr_t NumEls,
+               const MemoryAccess_t *Prev) {
+      if (!Prev || !Prev->isValid())
+        return Idx;
+      uintptr_t Key = Prev->ver_func;
+      for (; Idx + 4 <= NumEls; Idx += 4) {
+        if ((Data[Idx].ver_func != Key) | (Data[Idx + 1].ver_func != Key) |
+            (Data[Idx + 2].ver_func != Key) | (Data[Idx + 3].ver_func != Key))
+          break;
+      }
+      for (; Idx < NumEls; ++Idx)
+        if (Data[Idx].ver_func != Key)
+          return Idx;
+      return NumEls;
+    }
   };
 
   struct MASetFn {
@@ -312,6 +376,7 @@ private:
     void refine(unsigned newLgGrainsize) {
       cilksan_assert(newLgGrainsize < getLgGrainsize() &&
                      "Invalid grainsize for refining Line_t.");
+      CILKSAN_STAT(++cilksan_stats.line_refinements);
       // If Data hasn't been materialzed yet, then just update LgGrainsize.
       if (!isMaterialized()) {
         setLgGrainsize(newLgGrainsize);
@@ -374,6 +439,38 @@ private:
       return getData()[getIdx(byte)];
     }
 
+    // Advance Accessed past the entry it starts in and past the following
+    // entries in this line that continue the run of Prev, scanning the line
+    // directly.  If SkipInvalid is true, the run continues through invalid
+    // entries and Prev may be null.  Otherwise the run ends at the first
+    // invalid entry.  This line must be materialized.
+    __attribute__((always_inline)) Chunk_t
+    skipRun(Chunk_t Accessed, const LineData_t *Prev, bool SkipInvalid) const {
+      unsigned LgGrainsize = getLgGrainsize();
+      uintptr_t NumEls = 1UL << (LG_LINE_SIZE - LgGrainsize);
+      uintptr_t Idx = getIdx(byte(Accessed.addr)) + 1;
+      uintptr_t End =
+          SkipInvalid
+              ? LineDataMethods::findNextDistinct(getData(), Idx, NumEls, Prev)
+              : LineDataMethods::findRunEnd(getData(), Idx, NumEls, Prev);
+      uintptr_t nextAddr =
+          alignByPrevGrainsize(Accessed.addr, LG_LINE_SIZE) +
+          (End << LgGrainsize);
+      size_t chunkSize = nextAddr - Accessed.addr;
+      if (chunkSize >= Accessed.size)
+        return Chunk_t(nextAddr, 0);
+      return Chunk_t(nextAddr, Accessed.size - chunkSize);
+    }
+
+    // Replace the entries of this line, which an access has just overwritten
+    // entirely, with a single entry formed by SetFn covering the whole line.
+    void coalesce(LineDataSetFn SetFn) {
+      reset();
+      materialize();
+      SetFn(getData()[0]);
+      incNumNonNullEls();
+    }
+
     // Set all entries in this line covered by Accessed to be the LineData_t
     // formed by LineDataSetFn.  The func parameter must be valid.
     __attribute__((always_inline)) void set(Chunk_t &Accessed,
@@ -489,6 +586,11 @@ private:
         AccessedLgGrainsize = LgGrainsize;
       }
 
+      // If this access covers the whole line, then once every entry in the
+      // line is overwritten, the line can be coalesced into a single entry.
+      bool CoversLine = LineDataMethods::CanCoalesce && isLineStart(Accessed) &&
+                        Accessed.size >= LINE_SIZE;
+
       LineData_t *Data = getData();
       const LineData_t Previous = Data[PrevIdx];
       bool PrevIsValid = LineDataMethods::isValid(Previous);
@@ -505,12 +607,13 @@ private:
 
         // Get the next location.
         Accessed = Accessed.next(AccessedLgGrainsize);
-        if (Accessed.isEmpty())
-          return;
 
-        // Exit early when we reach the end of the line
-        if (isLineStart(Accessed))
+        // Exit early when we reach the end of the access or the line
+        if (Accessed.isEmpty() || isLineStart(Accessed)) {
+          if (CoversLine)
+            coalesce(SetFn);
           return;
+        }
 
         EntryIdx = getIdx(byte(Accessed.addr));
       } while (!LineDataMethods::isValid(Data[EntryIdx]) ||
@@ -580,6 +683,63 @@ private:
   // [0, LG_LINE_SIZE].
   using Line_t = AbstractLine_t<MemoryAccess_t, MALineMethods, MASetFn>;
 
+  // Summary of which lines in a page may contain valid entries.  Bit i of
+  // Lines is set if line i may be nonempty, and bit j of Words is set if word
+  // j of Lines may be nonzero.  Scans over a range of memory use this summary
+  // to skip lines the program never touched, such that, for example, freeing a
+  // large allocation costs time proportional to the number of lines in it that
+  // hold entries, rather than to its size.
+  struct TouchedLines_t {
+    static constexpr uintptr_t LG_WORD_SIZE = 6;
+    static constexpr uintptr_t WORD_SIZE = 1UL << LG_WORD_SIZE;
+    static constexpr uintptr_t NUM_LINES = 1UL << LG_PAGE_SIZE;
+    static constexpr uintptr_t NUM_LINE_WORDS = NUM_LINES / WORD_SIZE;
+    static_assert(NUM_LINE_WORDS % WORD_SIZE == 0,
+                  "Lines per page is not a multiple of WORD_SIZE^2");
+
+    uint64_t Words[NUM_LINE_WORDS / WORD_SIZE] = {0};
+    uint64_t Lines[NUM_LINE_WORDS] = {0};
+
+    // Record that line may be nonempty.
+    __attribute__((always_inline)) void mark(uintptr_t line) {
+      uintptr_t word = line >> LG_WORD_SIZE;
+      if (__builtin_expect(!Lines[word], false))
+        Words[word >> LG_WORD_SIZE] |= 1UL << (word & (WORD_SIZE - 1));
+      Lines[word] |= 1UL << (line & (WORD_SIZE - 1));
+    }
+
+    // Record that line is empty.
+    __attribute__((always_inline)) void unmark(uintptr_t line) {
+      uintptr_t word = line >> LG_WORD_SIZE;
+      Lines[word] &= ~(1UL << (line & (WORD_SIZE - 1)));
+      if (!Lines[word])
+        Words[word >> LG_WORD_SIZE] &= ~(1UL << (word & (WORD_SIZE - 1)));
+    }
+
+    // Returns the index of the first line at or after line that may be
+    // nonempty, or NUM_LINES if there is no such line.
+    uintptr_t findNext(uintptr_t line) const {
+      uintptr_t word = line >> LG_WORD_SIZE;
+      uint64_t bits = Lines[word] & (~0UL << (line & (WORD_SIZE - 1)));
+      if (bits)
+        return (word << LG_WORD_SIZE) + __builtin_ctzl(bits);
+
+      // Scan the summary for the next nonzero word of Lines.
+      ++word;
+      if (word == NUM_LINE_WORDS)
+        return NUM_LINES;
+      uintptr_t summary = word >> LG_WORD_SIZE;
+      uint64_t words = Words[summary] & (~0UL << (word & (WORD_SIZE - 1)));
+      while (!words) {
+        if (++summary == NUM_LINE_WORDS / WORD_SIZE)
+          return NUM_LINES;
+        words = Words[summary];
+      }
+      word = (summary << LG_WORD_SIZE) + __builtin_ctzl(words);
+      return (word << LG_WORD_SIZE) + __builtin_ctzl(Lines[word]);
+    }
+  };
+
   // A page is an array of lines.
   struct Page_t {
     using LineType = Line_t;
@@ -591,13 +751,15 @@ private:
         (1UL << LG_OCCUPANCY_PAGE_SIZE) / (8 * sizeof(uint64_t));
     uint64_t occupancy[OCC_ARR_SIZE] = {0};
 
-    // Memory-access entries for the page
+    // Memory-access entries for the page, and the lines that may hold them.
     LineType lines[1UL << LG_PAGE_SIZE];
+    TouchedLines_t touched;
 
     // To accommodate their size and sparse access pattern, use mmap/munmap to
     // allocate and free Page_t's.
     void *operator new(size_t size) {
       CheckingRAII nocheck;
+      CILKSAN_STAT(++cilksan_stats.shadow_pages);
       return mmap(nullptr, sizeof(Page_t), PROT_READ | PROT_WRITE,
                   MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
     }
@@ -711,10 +873,34 @@ private:
     __attribute__((always_inline)) static void invalidate(LockerList_t &LL) {
       LL.invalidate();
     }
+
+    // Setting a LockerList_t merges a new locker into the list, so entries
+    // updated by the same access need not be equal.
+    static constexpr bool CanCoalesce = false;
+
+    // Scans for runs of entries in a line, analogous to those in
+    // MALineMethods.
+    static uintptr_t findNextDistinct(const LockerList_t *Data, uintptr_t Idx,
+                                      uintptr_t NumEls,
+                                      const LockerList_t *Prev) {
+      for (; Idx < NumEls; ++Idx)
+        if (Data[Idx].isValid() && !(Prev && *Prev == Data[Idx]))
+          return Idx;
+      return NumEls;
+    }
+    static uintptr_t findRunEnd(const LockerList_t *Data, uintptr_t Idx,
+                                uintptr_t NumEls, const LockerList_t *Prev) {
+      if (!Prev || !Prev->isValid())
+        return Idx;
+      for (; Idx < NumEls; ++Idx)
+        if (!Data[Idx].isValid() || !(*Prev == Data[Idx]))
+          return Idx;
+      return NumEls;
+    }
   };
 
   struct LockerSetFn {
-    const LockSet_t &lockset;
+    LockSetID_t lockset;
     csi_id_t acc_id;
     MAType_t type;
     const FrameData_t *f;
@@ -729,7 +915,7 @@ private:
       version_t version = sbag->get_version();
       while (locker) {
         IntersectionResult_t result =
-            LockSet_t::intersect(locker->getLockSet(), lockset);
+            LockSetTable_t::intersect(locker->getLockSet(), lockset);
         if (!MemoryAccess_t::previousAccessInParallel(&locker->getAccess(),
                                                       f)) {
           if (result & L_SUPERSET_OF_R) {
@@ -773,11 +959,13 @@ private:
     using LineType = LockerLine_t;
 
     LockerLine_t lines[1UL << LG_PAGE_SIZE];
+    TouchedLines_t touched;
 
     // To accommodate their size and sparse access pattern, use mmap/munmap to
     // allocate and free Page_t's.
     void *operator new(size_t size) {
       CheckingRAII nocheck;
+      CILKSAN_STAT(++cilksan_stats.shadow_pages);
       return mmap(nullptr, sizeof(LockerPage_t), PROT_READ | PROT_WRITE,
                   MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
     }
@@ -939,6 +1127,25 @@ public:
     return Line;
   }
 
+  // Record that the line containing addr, whose page must exist, may be
+  // nonempty.
+  template <typename PageType>
+  __attribute__((always_inline)) void markTouched(uintptr_t addr) {
+    getPage<PageType>(page(addr))->touched.mark(line(addr));
+  }
+
+  // Advance Accessed past the line it starts in, to the next line in Page that
+  // may be nonempty or, if there is none, to the start of the next page.
+  template <typename PageType>
+  __attribute__((always_inline)) static Chunk_t
+  nextTouchedLine(const PageType *Page, Chunk_t Accessed) {
+    uintptr_t Next = line(Accessed.addr) + 1;
+    if (Next < TouchedLines_t::NUM_LINES)
+      Next = Page->touched.findNext(Next);
+    return Accessed.skipTo((Accessed.addr & PAGE_MASK) +
+                           (Next << LG_LINE_SIZE));
+  }
+
   // Iterator class for querying the entries of the shadow memory corresponding
   // to a given accessed chunk.
   template <typename PageType> class Query_iterator {
@@ -1007,6 +1214,10 @@ public:
       do {
         if (Line->isEmpty())
           Accessed = Accessed.next(LG_LINE_SIZE);
+        else if (Line->getLgGrainsize() < LG_LINE_SIZE)
+          // Skip the rest of the run in this refined line with one scan of the
+          // line, rather than looking up each entry separately.
+          Accessed = Line->skipRun(Accessed, PrevData, true);
         else
           Accessed = Accessed.next(Line->getLgGrainsize());
 
@@ -1056,7 +1267,8 @@ public:
       // Scan to find the non-null line.
       Line = &(*Page)[line(Accessed.addr)];
       while (!Line || Line->isEmpty()) {
-        Accessed = Accessed.next(LG_LINE_SIZE);
+        // Skip lines the program has not touched.
+        Accessed = nextTouchedLine(Page, Accessed);
         // Return early if the access becomes empty.
         if (Accessed.isEmpty())
           return false;
@@ -1143,7 +1355,12 @@ public:
       // Remember the previous Entry.
       const Entry_t Previous = Entry;
       do {
-        Accessed = Accessed.next(Line->getLgGrainsize());
+        if (!Line->isEmpty() && Line->getLgGrainsize() < LG_LINE_SIZE)
+          // Skip the rest of the run in this refined line with one scan of the
+          // line, rather than looking up each entry separately.
+          Accessed = Line->skipRun(Accessed, Previous.get(), false);
+        else
+          Accessed = Accessed.next(Line->getLgGrainsize());
         if (Accessed.isEmpty())
           return;
 
@@ -1175,6 +1392,7 @@ public:
         }
 
         // Set DataType objects in the current line.
+        Page->touched.mark(line(Accessed.addr));
         Line->set(Accessed, SetFn);
 
         // Return early if we've handled the whole access.
@@ -1211,6 +1429,7 @@ public:
         }
 
         // Set the object in the current line.
+        Page->touched.mark(line(Accessed.addr));
         Line->insert(Accessed, Line->getIdx(byte(Accessed.addr)), SetFn);
 
         // Return early if we've handled the whole access.
@@ -1240,7 +1459,10 @@ public:
         if (!nextNonNullLine())
           return;
 
+        uintptr_t LineIdx = line(Accessed.addr);
         Line->clear(Accessed);
+        if (Line->isEmpty())
+          Page->touched.unmark(LineIdx);
 
         // Return early if we've handled the whole access.
         if (Accessed.isEmpty())
@@ -1296,7 +1518,8 @@ public:
       // Scan to find the non-null line.
       Line = &(*Page)[line(Accessed.addr)];
       while (!Line || Line->isEmpty()) {
-        Accessed = Accessed.next(LG_LINE_SIZE);
+        // Skip lines the program has not touched.
+        Accessed = nextTouchedLine(Page, Accessed);
         // Return early if the access becomes empty.
         if (Accessed.isEmpty())
           return false;
@@ -1352,7 +1575,9 @@ public:
   // High-level method to clear any occupancy information recorded.
   void clearOccupied() {
     for (uintptr_t wordAddr : TouchedWords)
-      Table[page(wordAddr)]->clear(wordAddr);
+      // Skip words in pages that dropPages freed.
+      if (Page_t *Page = Table[page(wordAddr)])
+        Page->clear(wordAddr);
     TouchedWords.clear();
   }
 
@@ -1366,6 +1591,24 @@ public:
     AllocatedPages.clear();
   }
 
+  // Free the pages of shadow memory, including lockers, that lie entirely
+  // within [addr, addr+size).  Unlike clear, this method takes time
+  // proportional to the number of such pages, regardless of their contents.
+  void dropPages(uintptr_t addr, size_t size) {
+    uintptr_t FirstPage = page(addr + PAGE_OFF - 1);
+    uintptr_t EndPage = page(addr + size);
+    for (uintptr_t Idx = FirstPage; Idx < EndPage; ++Idx) {
+      if (Table[Idx]) {
+        delete Table[Idx];
+        Table[Idx] = nullptr;
+      }
+      if (LockerTableUsed && LockerTable[Idx]) {
+        delete LockerTable[Idx];
+        LockerTable[Idx] = nullptr;
+      }
+    }
+  }
+
   // High-level method to find a MemoryAccess_t object at the specified address.
   const MemoryAccess_t *find(uintptr_t addr) const {
     Query_iterator<Page_t> QI(*this, Chunk_t(addr, 1));
@@ -1415,6 +1658,80 @@ public:
   }
 };
 
+// Map from disjoint, half-open address ranges [start, end) to the allocations
+// that created them, keyed by their start addresses.  SimpleShadowMem stores
+// large allocations here, rather than in a dictionary, so that recording or
+// clearing a large allocation takes time logarithmic in the number of stored
+// ranges instead of time proportional to its size.
+class AllocRanges_t {
+  struct Range_t {
+    uintptr_t end;
+    MemoryAccess_t alloc;
+    Range_t(uintptr_t end, const MemoryAccess_t &alloc)
+        : end(end), alloc(alloc) {}
+  };
+  using RangeMap_t = std::map<uintptr_t, Range_t>;
+  RangeMap_t Ranges;
+
+  // Insert the range [start, end) for alloc.  The range must not overlap any
+  // stored range.  Constructs the entry in place, because moving a
+  // MemoryAccess_t does not maintain the reference count of its function.
+  RangeMap_t::iterator insert(RangeMap_t::iterator hint, uintptr_t start,
+                              uintptr_t end, const MemoryAccess_t &alloc) {
+    return Ranges.emplace_hint(hint, std::piecewise_construct,
+                               std::forward_as_tuple(start),
+                               std::forward_as_tuple(end, alloc));
+  }
+
+public:
+  bool empty() const { return Ranges.empty(); }
+
+  // Returns the allocation whose range contains addr, or nullptr if there is
+  // no such allocation.
+  const MemoryAccess_t *find(uintptr_t addr) const {
+    auto iter = Ranges.upper_bound(addr);
+    if (iter == Ranges.begin())
+      return nullptr;
+    --iter;
+    if (addr >= iter->second.end)
+      return nullptr;
+    return &iter->second.alloc;
+  }
+
+  // Remove [start, start+size) from all stored ranges, splitting ranges that
+  // it partially overlaps.
+  void clear(uintptr_t start, size_t size) {
+    uintptr_t end = start + size;
+    if (Ranges.empty() || end <= start)
+      return;
+
+    auto iter = Ranges.upper_bound(start);
+    if (iter != Ranges.begin() && std::prev(iter)->second.end > start)
+      --iter;
+
+    while (iter != Ranges.end() && iter->first < end) {
+      uintptr_t iter_end = iter->second.end;
+      if (iter_end > end)
+        insert(std::next(iter), end, iter_end, iter->second.alloc);
+      if (iter->first < start) {
+        iter->second.end = start;
+        ++iter;
+      } else {
+        iter = Ranges.erase(iter);
+      }
+    }
+  }
+
+  // Record alloc as the allocation for [start, start+size), replacing any
+  // allocations previously recorded for that range.
+  void set(uintptr_t start, size_t size, DS_t *func, version_t version,
+           csi_id_t acc_id, MAType_t type) {
+    clear(start, size);
+    insert(Ranges.lower_bound(start), start, start + size,
+           MemoryAccess_t(func, version, acc_id, type));
+  }
+};
+
 class SimpleShadowMem {
 private:
   CilkSanImpl_t &CilkSanImpl;
@@ -1424,6 +1741,21 @@ private:
   SimpleDictionary<ReadMAAllocator> Reads;
   SimpleDictionary<WriteMAAllocator> Writes;
   SimpleDictionary<AllocMAAllocator> Allocs;
+  // Allocations of at least LARGE_ALLOC_SIZE bytes are stored as ranges in
+  // LargeAllocs rather than in Allocs.  Each address belongs to at most one of
+  // Allocs and LargeAllocs.
+  AllocRanges_t LargeAllocs;
+  static constexpr size_t LARGE_ALLOC_SIZE =
+      SimpleDictionary<AllocMAAllocator>::LINE_SIZE * 64;
+
+  __attribute__((always_inline)) const MemoryAccess_t *
+  findAlloc(uintptr_t addr) const {
+    if (const MemoryAccess_t *Alloc = Allocs.find(addr))
+      return Alloc;
+    if (LargeAllocs.empty())
+      return nullptr;
+    return LargeAllocs.find(addr);
+  }
 
   using RLine_t = SimpleDictionary<ReadMAAllocator>::Line_t;
   using WLine_t = SimpleDictionary<WriteMAAllocator>::Line_t;
@@ -1443,24 +1775,36 @@ private:
     return MemoryAccess_t::previousAccessInParallel(PrevAccess, f);
   }
 
-  // Logic to try to get memory-allocation information on the given address
-  __attribute__((always_inline)) AccessLoc_t
-  findAllocLoc(uintptr_t addr) const {
-    // Try to get information on the allocation for this memory access.
-    if (auto AllocFind = Allocs.find(addr))
-      return AllocFind->getLoc();
-    return AccessLoc_t();
+  // Report a race between the previous access PrevAccess and the current
+  // access, unless an equivalent race has been reported already.  Duplicate
+  // races are recognized using only the CSI IDs of the accesses and the
+  // allocation, before fetching any call stacks.
+  __attribute__((always_inline)) void
+  reportRace(const MemoryAccess_t &PrevAccess, const csi_id_t acc_id,
+             MAType_t type, uintptr_t addr, enum RaceType_t race_type) const {
+    const MemoryAccess_t *AllocFind = findAlloc(addr);
+    if (AllocFind && is_suppressed_alloc(AllocFind->getAccID()))
+      return;
+    RaceSig_t sig(PrevAccess.getAccID(), PrevAccess.getAccType(), acc_id, type,
+                  AllocFind ? AllocFind->getAccID() : UNKNOWN_CSI_ID,
+                  race_type);
+    if (CilkSanImpl.is_duplicate_race(sig, addr))
+      return;
+    CilkSanImpl.report_race(
+        PrevAccess.getLoc(),
+        AccessLoc_t(acc_id, type, CilkSanImpl.get_current_call_stack()),
+        AllocFind ? AllocFind->getLoc() : AccessLoc_t(), addr, race_type);
   }
 
   // Logic to check for a data race with the given previous accesses.
   __attribute__((always_inline)) static bool
   dataRaceWithPreviousAccesses(LockerList_t *PrevAccesses, const FrameData_t *f,
-                               const LockSet_t &LS) {
+                               LockSetID_t LS) {
     Locker_t *locker = PrevAccesses->getHead();
     while (locker) {
       if (previousAccessInParallel(&locker->getAccess(), f)) {
         if (IntersectionResult_t::EMPTY ==
-            LockSet_t::intersect(locker->getLockSet(), LS))
+            LockSetTable_t::intersect(locker->getLockSet(), LS))
           return true;
       }
       locker = locker->getNext();
@@ -1469,7 +1813,7 @@ private:
   }
   __attribute__((always_inline)) static bool
   dataRaceWithPreviousAccesses(const LockerList_t *PrevAccesses,
-                               const FrameData_t *f, const LockSet_t &LS) {
+                               const FrameData_t *f, LockSetID_t LS) {
     return dataRaceWithPreviousAccesses(
         const_cast<LockerList_t *>(PrevAccesses), f, LS);
   }
@@ -1525,23 +1869,12 @@ public:
 
           // Report the race
           if (prev_read)
-            CilkSanImpl.report_race(
-                PrevAccess->getLoc(),
-                AccessLoc_t(acc_id, type, CilkSanImpl.get_current_call_stack()),
-                findAllocLoc(AccAddr), AccAddr, RW_RACE);
+            reportRace(*PrevAccess, acc_id, type, AccAddr, RW_RACE);
           else {
             if (is_read)
-              CilkSanImpl.report_race(
-                  PrevAccess->getLoc(),
-                  AccessLoc_t(acc_id, type,
-                              CilkSanImpl.get_current_call_stack()),
-                  findAllocLoc(AccAddr), AccAddr, WR_RACE);
+              reportRace(*PrevAccess, acc_id, type, AccAddr, WR_RACE);
             else
-              CilkSanImpl.report_race(
-                  PrevAccess->getLoc(),
-                  AccessLoc_t(acc_id, type,
-                              CilkSanImpl.get_current_call_stack()),
-                  findAllocLoc(AccAddr), AccAddr, WW_RACE);
+              reportRace(*PrevAccess, acc_id, type, AccAddr, WW_RACE);
           }
         }
       }
@@ -1640,10 +1973,7 @@ public:
         if (__builtin_expect(previousAccessInParallel(PrevAccess, f), false)) {
           uintptr_t AccAddr = UI.getAddress();
           // Report the race
-          CilkSanImpl.report_race(
-              PrevAccess->getLoc(),
-              AccessLoc_t(acc_id, type, CilkSanImpl.get_current_call_stack()),
-              findAllocLoc(AccAddr), AccAddr, WW_RACE);
+          reportRace(*PrevAccess, acc_id, type, AccAddr, WW_RACE);
 
           // Get the next location to check
           UI.next();
@@ -1702,6 +2032,7 @@ public:
         // If we're inserting a new read, increment the count of non-null
         // accesses in this line
         read_line->incNumNonNullEls();
+        Reads.markTouched<RDict::Page_t>(addr);
 
         // Update the read MemoryAccess_t
         SBag_t *sbag = f->getSbagForAccess();
@@ -1730,10 +2061,7 @@ public:
         // If the previous access is in parallel, then we have a race
         if (__builtin_expect(previousAccessInParallel(&write_ma, f), false)) {
           // Report the race
-          CilkSanImpl.report_race(
-              write_ma.getLoc(),
-              AccessLoc_t(acc_id, type, CilkSanImpl.get_current_call_stack()),
-              findAllocLoc(addr), addr, WR_RACE);
+          reportRace(write_ma, acc_id, type, addr, WR_RACE);
         }
       }
     }
@@ -1786,6 +2114,7 @@ public:
         // If we're inserting a new write, increment the count of non-null
         // accesses in this line.
         write_line->incNumNonNullEls();
+        Writes.markTouched<WDict::Page_t>(addr);
 
         // Update the write MemoryAccess_t
         SBag_t *sbag = f->getSbagForAccess();
@@ -1796,10 +2125,7 @@ public:
         // Otherwise, check against the existing write.
         if (previousAccessInParallel(write_ma, f)) {
           // Report the race
-          CilkSanImpl.report_race(
-              write_ma->getLoc(),
-              AccessLoc_t(acc_id, type, CilkSanImpl.get_current_call_stack()),
-              findAllocLoc(addr), addr, WW_RACE);
+          reportRace(*write_ma, acc_id, type, addr, WW_RACE);
         } else {
           // This write access is in series with the previous access, so update
           // the shadow memory.
@@ -1819,10 +2145,7 @@ public:
         // If the previous access was in parallel, then we have a race
         if (previousAccessInParallel(&read_ma, f)) {
           // Report the race
-          CilkSanImpl.report_race(
-              read_ma.getLoc(),
-              AccessLoc_t(acc_id, type, CilkSanImpl.get_current_call_stack()),
-              findAllocLoc(addr), addr, RW_RACE);
+          reportRace(read_ma, acc_id, type, addr, RW_RACE);
         }
       }
     }
@@ -1835,7 +2158,7 @@ public:
   __attribute__((always_inline)) void
   check_data_race(const DictTy &Dict, QITy &QI, const csi_id_t acc_id,
                   MAType_t type, const FrameData_t *f,
-                  const LockSet_t &LS) const {
+                  LockSetID_t LS) const {
     while (!QI.isEnd()) {
       // Find a previous access
       const MemoryAccess_t *PrevAccess = QI.get();
@@ -1861,24 +2184,12 @@ public:
               uintptr_t AccAddr = LQI.getAddress();
 
               if (prev_read)
-                CilkSanImpl.report_race(
-                    PrevAccess->getLoc(),
-                    AccessLoc_t(acc_id, type,
-                                CilkSanImpl.get_current_call_stack()),
-                    findAllocLoc(AccAddr), AccAddr, RW_RACE);
+                reportRace(*PrevAccess, acc_id, type, AccAddr, RW_RACE);
               else {
                 if (is_read)
-                  CilkSanImpl.report_race(
-                      PrevAccess->getLoc(),
-                      AccessLoc_t(acc_id, type,
-                                  CilkSanImpl.get_current_call_stack()),
-                      findAllocLoc(AccAddr), AccAddr, WR_RACE);
+                  reportRace(*PrevAccess, acc_id, type, AccAddr, WR_RACE);
                 else
-                  CilkSanImpl.report_race(
-                      PrevAccess->getLoc(),
-                      AccessLoc_t(acc_id, type,
-                                  CilkSanImpl.get_current_call_stack()),
-                      findAllocLoc(AccAddr), AccAddr, WW_RACE);
+                  reportRace(*PrevAccess, acc_id, type, AccAddr, WW_RACE);
               }
             }
             LQI.next();
@@ -1892,7 +2203,7 @@ public:
 
   __attribute__((always_inline)) void check_data_race_with_prev_read(
       const csi_id_t acc_id, MAType_t type, uintptr_t addr, size_t mem_size,
-      const FrameData_t *f, const LockSet_t &LS) const {
+      const FrameData_t *f, LockSetID_t LS) const {
     using RDict = SimpleDictionary<ReadMAAllocator>;
     using QITy = RDict::Query_iterator<RDict::Page_t>;
     using LQITy = RDict::Query_iterator<RDict::LockerPage_t>;
@@ -1905,7 +2216,7 @@ public:
   template <bool is_read>
   __attribute__((always_inline)) void check_data_race_with_prev_write(
       const csi_id_t acc_id, MAType_t type, uintptr_t addr, size_t mem_size,
-      const FrameData_t *f, const LockSet_t &LS) const {
+      const FrameData_t *f, LockSetID_t LS) const {
     using WDict = SimpleDictionary<WriteMAAllocator>;
     using QITy = WDict::Query_iterator<WDict::Page_t>;
     using LQITy = WDict::Query_iterator<WDict::LockerPage_t>;
@@ -1917,7 +2228,7 @@ public:
   template <typename UITy, class LockerSetFn>
   __attribute__((always_inline)) void
   update_lockers(UITy &UI, const csi_id_t acc_id, MAType_t type,
-                 const FrameData_t *f, const LockSet_t &LS) {
+                 const FrameData_t *f, LockSetID_t LS) {
     while (!UI.isEnd()) {
       UI.insert(LockerSetFn({LS, acc_id, type, f}));
     }
@@ -1926,7 +2237,7 @@ public:
   __attribute__((always_inline)) void
   update_lockers_with_read(const csi_id_t acc_id, MAType_t type, uintptr_t addr,
                            size_t mem_size, const FrameData_t *f,
-                           const LockSet_t &LS) {
+                           LockSetID_t LS) {
     using RDict = SimpleDictionary<ReadMAAllocator>;
     using UITy = RDict::Update_iterator<RDict::LockerPage_t>;
     UITy UI = Reads.getLockerUpdateIterator(addr, mem_size);
@@ -1936,7 +2247,7 @@ public:
   __attribute__((always_inline)) void
   check_data_race_and_update_write(const csi_id_t acc_id, MAType_t type,
                                    uintptr_t addr, size_t mem_size,
-                                   const FrameData_t *f, const LockSet_t &LS) {
+                                   const FrameData_t *f, LockSetID_t LS) {
     using WDict = SimpleDictionary<WriteMAAllocator>;
     using UITy = WDict::Update_iterator<WDict::Page_t>;
     using LUITy = WDict::Update_iterator<WDict::LockerPage_t>;
@@ -1981,11 +2292,7 @@ public:
                 dataRaceWithPreviousAccesses(PrevAccesses, f, LS)) {
               // Report the race
               uintptr_t AccAddr = LUI.getAddress();
-              CilkSanImpl.report_race(
-                  PrevAccess->getLoc(),
-                  AccessLoc_t(acc_id, type,
-                              CilkSanImpl.get_current_call_stack()),
-                  findAllocLoc(AccAddr), AccAddr, WW_RACE);
+              reportRace(*PrevAccess, acc_id, type, AccAddr, WW_RACE);
             }
             // Insert the new locker
             LUI.insert(WDict::LockerSetFn({LS, acc_id, type, f}));
@@ -2011,24 +2318,40 @@ public:
     Writes.clear(start, size);
   }
 
+  // Free the read and write shadow pages that lie entirely within
+  // [start, start+size).
+  void drop_pages(size_t start, size_t size) {
+    Reads.dropPages(start, size);
+    Writes.dropPages(start, size);
+  }
+
   void record_alloc(size_t start, size_t size, FrameData_t *f,
                     csi_id_t alloca_id) {
     SBag_t *sbag = f->getSbagForAccess();
     DS_t *ds = sbag->get_ds();
     version_t version = sbag->get_version();
-    Allocs.set(start, size, ds, version, alloca_id, MAType_t::ALLOC);
+    if (size >= LARGE_ALLOC_SIZE) {
+      Allocs.clear(start, size);
+      LargeAllocs.set(start, size, ds, version, alloca_id, MAType_t::ALLOC);
+    } else {
+      LargeAllocs.clear(start, size);
+      Allocs.set(start, size, ds, version, alloca_id, MAType_t::ALLOC);
+    }
   }
 
   void record_free(size_t start, size_t size, FrameData_t *f, csi_id_t free_id,
                    MAType_t type) {
-    Allocs.clear(start, size);
+    clear_alloc(start, size);
     SBag_t *sbag = f->getSbagForAccess();
     DS_t *ds = sbag->get_ds();
     version_t version = sbag->get_version();
     Writes.set(start, size, ds, version, free_id, type);
   }
 
-  void clear_alloc(size_t start, size_t size) { Allocs.clear(start, size); }
+  void clear_alloc(size_t start, size_t size) {
+    Allocs.clear(start, size);
+    LargeAllocs.clear(start, size);
+  }
 };
 
 #endif // __SIMPLE_SHADOW_MEM__
@@ -0,0 +1,210 @@
+// -*- C++ -*-
+#ifndef __STACK_REGISTRY_H__
+#define __STACK_REGISTRY_H__
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "checking.h"
+#include "debug_util.h"
+
+// Registry of the memory regions used as stacks by the program, including the
+// fiber stacks the Cilk runtime allocates for its workers.  Cilksan uses this
+// registry to decide exactly whether a stack pointer lies on the current stack
+// or whether execution has switched stacks.
+//
+// Regions are registered either explicitly, e.g., by the mmap interposers, or
+// on demand by looking up the memory mapping containing a stack pointer.
+class StackRegistry_t {
+  struct Region_t {
+    uintptr_t low;
+    uintptr_t high;
+  };
+
+  static constexpr unsigned DEFAULT_CAPACITY = 16;
+
+  // Registered regions, sorted by address.
+  Region_t *regions = nullptr;
+  unsigned num_regions = 0;
+  unsigned capacity = 0;
+
+  // Region of the stack currently in use, cached for fast membership tests.
+  Region_t current = {0, 0};
+
+  // Unmapped range containing the address of the last failed lookup of a
+  // memory mapping, cached so that repeated lookups in the range fail fast.
+  Region_t unmapped = {0, 0};
+  // Whether the memory mappings of the process cannot be read at all, e.g.,
+  // because /proc is not available.
+  bool maps_unavailable = false;
+
+  // Returns the index of the first registered region whose high address is
+  // greater than addr.
+  unsigned lower_bound(uintptr_t addr) const {
+    unsigned lo = 0, hi = num_regions;
+    while (lo < hi) {
+      unsigned mid = lo + (hi - lo) / 2;
+      if (regions[mid].high <= addr)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+    return lo;
+  }
+
+  // Look up the memory mapping containing addr in /proc/self/maps.  If no
+  // mapping contains addr, returns false and sets [low, high) to the unmapped
+  // range containing addr.  This routine avoids stdio and memory allocation,
+  // since it may be called from within instrumentation hooks.
+  bool find_mapping(uintptr_t addr, uintptr_t &low, uintptr_t &high) {
+    low = 0;
+    high = UINTPTR_MAX;
+#if __linux__
+    CheckingRAII nocheck;
+    int fd = open("/proc/self/maps", O_RDONLY);
+    if (fd < 0) {
+      maps_unavailable = true;
+      return false;
+    }
+
+    // The mappings are listed in increasing order of address.
+    char buf[4096];
+    size_t len = 0;
+    bool found = false;
+    bool done = false;
+    bool eof = false;
+    while (!done && !eof) {
+      ssize_t n = read(fd, buf + len, sizeof(buf) - len);
+      if (n <= 0)
+        eof = true;
+      else
+        len += n;
+
+      // Parse each complete line in the buffer.
+      size_t start = 0;
+      for (size_t i = 0; i < len; ++i) {
+        if (buf[i] != '\n')
+          continue;
+        uintptr_t line_low = 0, line_high = 0;
+        size_t j = start;
+        for (; j < i && buf[j] != '-'; ++j)
+          line_low = (line_low << 4) | hex_value(buf[j]);
+        for (++j; j < i && buf[j] != ' '; ++j)
+          line_high = (line_high << 4) | hex_value(buf[j]);
+        start = i + 1;
+        if (line_high <= addr) {
+          low = line_high;
+        } else {
+          if (line_low <= addr) {
+            low = line_low;
+            found = true;
+          }
+          high = found ? line_high : line_low;
+          done = true;
+          break;
+        }
+      }
+      // Move any partial line to the front of the buffer.
+      memmove(buf, buf + start, len - start);
+      len -= start;
+    }
+    close(fd);
+    return found;
+#else
+    maps_unavailable = true;
+    return false;
+#endif // __linux__
+  }
+
+  static uintptr_t hex_value(char c) {
+    if (c >= '0' && c <= '9')
+      return c - '0';
+    if (c >= 'a' && c <= 'f')
+      return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+      return c - 'A' + 10;
+    return 0;
+  }
+
+public:
+  ~StackRegistry_t() {
+    if (regions)
+      free(regions);
+  }
+
+  // Register [low, high) as a stack region.
+  void add(uintptr_t low, uintptr_t high) {
+    DBG_TRACE(STACK, "StackRegistry_t::add %p--%p\n", low, high);
+    // Drop any registered regions that the new region overlaps.
+    remove(low, high);
+    mapped(low, high);
+    if (num_regions == capacity) {
+      capacity = capacity ? 2 * capacity : DEFAULT_CAPACITY;
+      regions = (Region_t *)realloc(regions, capacity * sizeof(Region_t));
+    }
+    unsigned idx = lower_bound(low);
+    memmove(&regions[idx + 1], &regions[idx],
+            (num_regions - idx) * sizeof(Region_t));
+    regions[idx] = {low, high};
+    ++num_regions;
+  }
+
+  // Unregister all stack regions overlapping [low, high).
+  void remove(uintptr_t low, uintptr_t high) {
+    unsigned idx = lower_bound(low);
+    unsigned end = idx;
+    while (end < num_regions && regions[end].low < high)
+      ++end;
+    if (end == idx)
+      return;
+    memmove(&regions[idx], &regions[end],
+            (num_regions - end) * sizeof(Region_t));
+    num_regions -= end - idx;
+    if (current.low < high && low < current.high)
+      current = {0, 0};
+  }
+
+  // Note that [low, high) has been mapped, which invalidates any cached failed
+  // lookup in that range.
+  void mapped(uintptr_t low, uintptr_t high) {
+    if (unmapped.low < high && low < unmapped.high)
+      unmapped = {0, 0};
+  }
+
+  // Find the stack region containing addr, registering the memory mapping
+  // containing addr if no such region is registered.  Returns false if no
+  // region could be found.
+  bool find(uintptr_t addr, uintptr_t &low, uintptr_t &high) {
+    unsigned idx = lower_bound(addr);
+    if (idx < num_regions && regions[idx].low <= addr) {
+      low = regions[idx].low;
+      high = regions[idx].high;
+      return true;
+    }
+    if (maps_unavailable || (unmapped.low <= addr && addr < unmapped.high))
+      return false;
+    if (!find_mapping(addr, low, high)) {
+      DBG_TRACE(STACK, "StackRegistry_t: no mapping in %p--%p\n", low, high);
+      unmapped = {low, high};
+      return false;
+    }
+    add(low, high);
+    return true;
+  }
+
+  // Methods for the region of the stack currently in use.
+  __attribute__((always_inline)) bool in_current(uintptr_t addr) const {
+    return current.low <= addr && addr < current.high;
+  }
+  bool has_current() const { return current.low != current.high; }
+  void get_current(uintptr_t &low, uintptr_t &high) const {
+    low = current.low;
+    high = current.high;
+  }
+  void set_current(uintptr_t low, uintptr_t high) { current = {low, high}; }
+};
+
+#endif // __STACK_REGISTRY_H__
@@ -0,0 +1,141 @@
+// -*- C++ -*-
+#ifndef __STATS_H__
+#define __STATS_H__
+
+#include <cstdint>
+#include <ctime>
+
+// Statistics about the work Cilksan performs, collected when the CILKSAN_STATS
+// environment variable is set.  All statistics are kept in fixed-size arrays of
+// counters, so collecting a statistic never allocates memory, and histograms
+// are indexed by the base-2 logarithm of the measured quantity.  Because
+// Cilksan executes the program serially, the counters need no synchronization.
+
+// Categories of hooks whose time is measured.
+enum HookCategory_t : uint8_t {
+  HOOK_MEMORY = 0,  // Loads and stores
+  HOOK_FUNCTION,    // Function entry and exit
+  HOOK_PARALLEL,    // Spawns, tasks, syncs, and parallel loops
+  HOOK_LIBRARY,     // Library functions and intrinsics
+  NUM_HOOK_CATEGORIES,
+};
+
+struct Stats_t {
+  // Number of buckets in each histogram.  Bucket i counts values in
+  // [2^i, 2^(i+1)), and bucket 0 also counts the value 0.
+  static constexpr unsigned NUM_BUCKETS = 64;
+
+  __attribute__((always_inline)) static unsigned bucket(uint64_t val) {
+    return val ? (63 - __builtin_clzl(val)) : 0;
+  }
+
+  bool enabled = false;
+
+  // Histograms of the sizes of checked reads and writes.
+  uint64_t reads[NUM_BUCKETS] = {0};
+  uint64_t writes[NUM_BUCKETS] = {0};
+  uint64_t total_reads = 0;
+  uint64_t total_writes = 0;
+
+  // Histograms of the sizes of reads and writes checked in the current strand,
+  // and the maximum count for each size over all strands.  Bitmasks identify
+  // the buckets updated in the current strand, so that only those buckets are
+  // folded into the maxima at the end of the strand.
+  uint64_t strand_reads[NUM_BUCKETS] = {0};
+  uint64_t strand_writes[NUM_BUCKETS] = {0};
+  uint64_t strand_read_buckets = 0;
+  uint64_t strand_write_buckets = 0;
+  uint64_t max_strand_reads[NUM_BUCKETS] = {0};
+  uint64_t max_strand_writes[NUM_BUCKETS] = {0};
+  uint64_t strands = 0;
+
+  // Number of pages of shadow memory allocated.
+  uint64_t shadow_pages = 0;
+  // Number of shadow-memory lines refined to a smaller grainsize.
+  uint64_t line_refinements = 0;
+  // Histogram of the number of links traversed by disjoint-set finds that do
+  // not find the root within one link.
+  uint64_t find_lengths[NUM_BUCKETS] = {0};
+
+  // Number of calls and total time, in cycles, of hooks in each category.
+  uint64_t hook_calls[NUM_HOOK_CATEGORIES] = {0};
+  uint64_t hook_cycles[NUM_HOOK_CATEGORIES] = {0};
+
+  __attribute__((always_inline)) void record_read(uint64_t size) {
+    unsigned b = bucket(size);
+    ++total_reads;
+    ++reads[b];
+    ++strand_reads[b];
+    strand_read_buckets |= (1UL << b);
+  }
+  __attribute__((always_inline)) void record_write(uint64_t size) {
+    unsigned b = bucket(size);
+    ++total_writes;
+    ++writes[b];
+    ++strand_writes[b];
+    strand_write_buckets |= (1UL << b);
+  }
+
+  // Fold the counts for the current strand into the maxima over all strands.
+  void end_strand() {
+    ++strands;
+    fold(strand_reads, max_strand_reads, strand_read_buckets);
+    fold(strand_writes, max_strand_writes, strand_write_buckets);
+  }
+
+  // Read a cycle counter, for measuring the time spent in hooks.
+  __attribute__((always_inline)) static uint64_t cycles() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#elif defined(__aarch64__)
+    uint64_t val;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(val));
+    return val;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000UL + ts.tv_nsec;
+#endif
+  }
+
+private:
+  static void fold(uint64_t *strand, uint64_t *max, uint64_t &buckets) {
+    while (buckets) {
+      unsigned b = __builtin_ctzl(buckets);
+      buckets &= buckets - 1;
+      if (strand[b] > max[b])
+        max[b] = strand[b];
+      strand[b] = 0;
+    }
+  }
+};
+
+extern Stats_t cilksan_stats;
+
+// Helper macro to update statistics only when they are enabled.
+#define CILKSAN_STAT(stmt)                                                     \
+  do {                                                                         \
+    if (__builtin_expect(cilksan_stats.enabled, false)) {                      \
+      stmt;                                                                    \
+    }                                                                          \
+  } while (0)
+
+// RAII object to measure the time spent in a hook.
+struct HookTimer_t {
+  uint64_t start = 0;
+  HookCategory_t category;
+
+  __attribute__((always_inline)) HookTimer_t(HookCategory_t category)
+      : category(category) {
+    if (__builtin_expect(cilksan_stats.enabled, false))
+      start = Stats_t::cycles();
+  }
+  __attribute__((always_inline)) ~HookTimer_t() {
+    if (__builtin_expect(start != 0, false)) {
+      ++cilksan_stats.hook_calls[category];
+      cilksan_stats.hook_cycles[category] += Stats_t::cycles() - start;
+    }
+  }
+};
+
+#endif // __STATS_H__
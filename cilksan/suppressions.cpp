@@ -0,0 +1,268 @@
+#include "suppressions.h"
+#include "csan.h"
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+uint64_t *suppressed_load_ids = nullptr;
+uint64_t *suppressed_store_ids = nullptr;
+uint64_t *suppressed_alloca_ids = nullptr;
+uint64_t *suppressed_allocfn_ids = nullptr;
+
+bool check_selected_only = false;
+uint64_t *checked_func_ids = nullptr;
+
+// A rule parsed from the suppressions file.
+struct Rule_t {
+  enum Kind_t { FUN, SRC, ALLOC_FUN, ALLOC_SRC, ALLOC_VAR } kind;
+  std::string pattern;
+  // Range of line numbers for SRC and ALLOC_SRC rules, or -1 to match any
+  // line.
+  int32_t line = -1;
+  int32_t last_line = -1;
+};
+
+// Suppression rules.  The rules are allocated on first use, since units may be
+// initialized before static constructors in this file run.
+static std::vector<Rule_t> *rules = nullptr;
+static bool rules_loaded = false;
+
+// Rules selecting the functions to check, from CILKSAN_ONLY.
+static std::vector<Rule_t> *only_rules = nullptr;
+static bool only_rules_loaded = false;
+
+// Returns true if str matches the glob pattern pat, which may contain the
+// wildcards '*' and '?'.
+static bool glob_match(const char *pat, const char *str) {
+  const char *star = nullptr;
+  const char *backtrack = nullptr;
+  while (*str) {
+    if (*pat == '*') {
+      star = pat++;
+      backtrack = str;
+    } else if (*pat == '?' || *pat == *str) {
+      ++pat;
+      ++str;
+    } else if (star) {
+      pat = star + 1;
+      str = ++backtrack;
+    } else {
+      return false;
+    }
+  }
+  while (*pat == '*')
+    ++pat;
+  return !*pat;
+}
+
+// Parse the pattern and optional line number or range of line numbers of a SRC
+// or ALLOC_SRC rule.
+static void parse_src_pattern(Rule_t &rule, const std::string &text) {
+  rule.pattern = text;
+  size_t colon = text.rfind(':');
+  if (colon == std::string::npos || colon + 1 == text.size())
+    return;
+  size_t dash = std::string::npos;
+  for (size_t i = colon + 1; i < text.size(); ++i) {
+    if (text[i] == '-' && dash == std::string::npos && i > colon + 1 &&
+        i + 1 < text.size())
+      dash = i;
+    else if (text[i] < '0' || text[i] > '9')
+      return;
+  }
+  rule.pattern = text.substr(0, colon);
+  rule.line = atoi(text.c_str() + colon + 1);
+  rule.last_line =
+      (dash == std::string::npos) ? rule.line : atoi(text.c_str() + dash + 1);
+}
+
+// Read the suppression rules from the file named by CILKSAN_SUPPRESSIONS.
+static void load_rules() {
+  rules_loaded = true;
+  const char *path = getenv("CILKSAN_SUPPRESSIONS");
+  if (!path)
+    return;
+
+  std::ifstream file(path);
+  if (!file.is_open()) {
+    std::cerr << "WARNING: Could not open suppressions file " << path << "\n";
+    return;
+  }
+
+  static const struct {
+    const char *prefix;
+    Rule_t::Kind_t kind;
+  } kinds[] = {
+      {"fun:", Rule_t::FUN},
+      {"src:", Rule_t::SRC},
+      {"alloc_fun:", Rule_t::ALLOC_FUN},
+      {"alloc_src:", Rule_t::ALLOC_SRC},
+      {"alloc_var:", Rule_t::ALLOC_VAR},
+  };
+
+  rules = new std::vector<Rule_t>;
+  std::string line;
+  unsigned line_no = 0;
+  while (std::getline(file, line)) {
+    ++line_no;
+    // Trim whitespace.
+    size_t begin = line.find_first_not_of(" \t\r");
+    if (begin == std::string::npos || line[begin] == '#')
+      continue;
+    size_t end = line.find_last_not_of(" \t\r");
+    line = line.substr(begin, end - begin + 1);
+
+    bool parsed = false;
+    for (const auto &k : kinds) {
+      size_t len = strlen(k.prefix);
+      if (line.compare(0, len, k.prefix) != 0)
+        continue;
+      Rule_t rule;
+      rule.kind = k.kind;
+      if (k.kind == Rule_t::SRC || k.kind == Rule_t::ALLOC_SRC)
+        parse_src_pattern(rule, line.substr(len));
+      else
+        rule.pattern = line.substr(len);
+      rules->push_back(rule);
+      parsed = true;
+      break;
+    }
+    if (!parsed)
+      std::cerr << "WARNING: Ignoring unknown suppression at " << path << ":"
+                << line_no << ": " << line << "\n";
+  }
+}
+
+// Read the rules selecting the functions to check from CILKSAN_ONLY, a
+// comma-separated list of fun: and src: rules.  Entries without either prefix
+// are function-name patterns.
+static void load_only_rules() {
+  only_rules_loaded = true;
+  const char *list = getenv("CILKSAN_ONLY");
+  if (!list)
+    return;
+
+  check_selected_only = true;
+  only_rules = new std::vector<Rule_t>;
+  std::string entries(list);
+  size_t begin = 0;
+  while (begin <= entries.size()) {
+    size_t end = entries.find(',', begin);
+    if (end == std::string::npos)
+      end = entries.size();
+    std::string entry = entries.substr(begin, end - begin);
+    begin = end + 1;
+    if (entry.empty())
+      continue;
+
+    Rule_t rule;
+    if (entry.compare(0, 4, "src:") == 0) {
+      rule.kind = Rule_t::SRC;
+      parse_src_pattern(rule, entry.substr(4));
+    } else {
+      rule.kind = Rule_t::FUN;
+      rule.pattern =
+          (entry.compare(0, 4, "fun:") == 0) ? entry.substr(4) : entry;
+    }
+    only_rules->push_back(rule);
+  }
+}
+
+// Returns true if any rule in rules of the given kinds matches the source
+// location src_loc or the object obj_src_loc.
+static bool matches(const std::vector<Rule_t> &rules, Rule_t::Kind_t fun_kind,
+                    Rule_t::Kind_t src_kind, const csan_source_loc_t *src_loc,
+                    const obj_source_loc_t *obj_src_loc) {
+  for (const Rule_t &rule : rules) {
+    if (rule.kind == fun_kind) {
+      if (src_loc && src_loc->name &&
+          glob_match(rule.pattern.c_str(), src_loc->name))
+        return true;
+    } else if (rule.kind == src_kind) {
+      if (src_loc && src_loc->filename &&
+          (rule.line < 0 || (rule.line <= src_loc->line_number &&
+                             src_loc->line_number <= rule.last_line)) &&
+          glob_match(rule.pattern.c_str(), src_loc->filename))
+        return true;
+    } else if (rule.kind == Rule_t::ALLOC_VAR &&
+               fun_kind == Rule_t::ALLOC_FUN) {
+      if (obj_src_loc && obj_src_loc->name &&
+          glob_match(rule.pattern.c_str(), obj_src_loc->name))
+        return true;
+    }
+  }
+  return false;
+}
+
+// Grow the bitmask mask from old_ids to new_ids IDs, and set the bits for the
+// new IDs that match the rules in rules of the given kinds.
+static void grow_mask(uint64_t *&mask, csi_id_t old_ids, csi_id_t new_ids,
+                      const std::vector<Rule_t> &rules,
+                      Rule_t::Kind_t fun_kind, Rule_t::Kind_t src_kind,
+                      const csan_source_loc_t *(*get_src_loc)(const csi_id_t),
+                      const obj_source_loc_t *(*get_obj_src_loc)(
+                          const csi_id_t)) {
+  size_t old_words = (old_ids + 63) / 64;
+  size_t new_words = (new_ids + 63) / 64;
+  if (!mask) {
+    mask = (uint64_t *)calloc(new_words ? new_words : 1, sizeof(uint64_t));
+  } else if (new_words > old_words) {
+    mask = (uint64_t *)realloc(mask, new_words * sizeof(uint64_t));
+    memset(&mask[old_words], 0, (new_words - old_words) * sizeof(uint64_t));
+  }
+  for (csi_id_t id = old_ids; id < new_ids; ++id)
+    if (matches(rules, fun_kind, src_kind, get_src_loc(id),
+                get_obj_src_loc ? get_obj_src_loc(id) : nullptr))
+      mask[id / 64] |= (1UL << (id % 64));
+}
+
+void init_unit_suppressions(csi_id_t old_load, csi_id_t new_load,
+                            csi_id_t old_store, csi_id_t new_store,
+                            csi_id_t old_alloca, csi_id_t new_alloca,
+                            csi_id_t old_allocfn, csi_id_t new_allocfn) {
+  if (!rules_loaded)
+    load_rules();
+  if (!rules || rules->empty())
+    return;
+
+  grow_mask(suppressed_load_ids, old_load, new_load, *rules, Rule_t::FUN,
+            Rule_t::SRC, __csan_get_load_source_loc, nullptr);
+  grow_mask(suppressed_store_ids, old_store, new_store, *rules, Rule_t::FUN,
+            Rule_t::SRC, __csan_get_store_source_loc, nullptr);
+  grow_mask(suppressed_alloca_ids, old_alloca, new_alloca, *rules,
+            Rule_t::ALLOC_FUN, Rule_t::ALLOC_SRC, __csan_get_alloca_source_loc,
+            __csan_get_alloca_obj_source_loc);
+  grow_mask(suppressed_allocfn_ids, old_allocfn, new_allocfn, *rules,
+            Rule_t::ALLOC_FUN, Rule_t::ALLOC_SRC,
+            __csan_get_allocfn_source_loc, __csan_get_allocfn_obj_source_loc);
+}
+
+void init_unit_checked_funcs(csi_id_t old_func, csi_id_t new_func) {
+  if (!only_rules_loaded)
+    load_only_rules();
+  if (!check_selected_only)
+    return;
+
+  grow_mask(checked_func_ids, old_func, new_func, *only_rules, Rule_t::FUN,
+            Rule_t::SRC, __csan_get_func_source_loc, nullptr);
+}
+
+void free_suppressions() {
+  free(suppressed_load_ids);
+  suppressed_load_ids = nullptr;
+  free(suppressed_store_ids);
+  suppressed_store_ids = nullptr;
+  free(suppressed_alloca_ids);
+  suppressed_alloca_ids = nullptr;
+  free(suppressed_allocfn_ids);
+  suppressed_allocfn_ids = nullptr;
+  delete rules;
+  rules = nullptr;
+  free(checked_func_ids);
+  checked_func_ids = nullptr;
+  delete only_rules;
+  only_rules = nullptr;
+}
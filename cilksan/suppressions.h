@@ -0,0 +1,95 @@
+// -*- C++ -*-
+#ifndef __SUPPRESSIONS_H__
+#define __SUPPRESSIONS_H__
+
+#include <csi/csi.h>
+#include <cstdint>
+
+// Support for suppressing known races, specified in the file named by the
+// CILKSAN_SUPPRESSIONS environment variable.  Each nonempty line of the file
+// that does not start with '#' is a rule of one of the following forms:
+//
+//   fun:<pattern>              Loads and stores in functions matching pattern.
+//   src:<pattern>[:<line>[-<line>]]
+//                              Loads and stores in source files matching
+//                              pattern, optionally only at the given line or
+//                              range of lines.
+//   alloc_fun:<pattern>        Memory allocated in functions matching pattern.
+//   alloc_src:<pattern>[:<line>[-<line>]]
+//                              Memory allocated in source files matching
+//                              pattern, optionally only at the given line or
+//                              range of lines.
+//   alloc_var:<pattern>        Variables whose names match pattern.
+//
+// Patterns may use the wildcards '*' and '?'.
+//
+// Rules are compiled into bitmasks over CSI IDs as each instrumented unit is
+// initialized.  Suppressed loads and stores skip shadow-memory checking
+// entirely, so they neither race with nor update the record of other
+// accesses.  Races on memory from suppressed allocation sites are dropped
+// before any information about the race is collected.
+
+// Bitmasks of suppressed CSI IDs.  Each bitmask is null if no suppression
+// rules were given.
+extern uint64_t *suppressed_load_ids;
+extern uint64_t *suppressed_store_ids;
+extern uint64_t *suppressed_alloca_ids;
+extern uint64_t *suppressed_allocfn_ids;
+
+__attribute__((always_inline)) static inline bool
+is_suppressed(const uint64_t *mask, csi_id_t id) {
+  return __builtin_expect(mask != nullptr, false) &&
+         ((mask[id / 64] >> (id % 64)) & 1);
+}
+
+// Returns true if races on memory from the allocation with the given ID are
+// suppressed.  Odd allocation IDs identify heap allocations, even IDs identify
+// stack allocations.
+__attribute__((always_inline)) static inline bool
+is_suppressed_alloc(csi_id_t alloc_id) {
+  if (alloc_id == UNKNOWN_CSI_ID)
+    return false;
+  if (alloc_id % 2)
+    return is_suppressed(suppressed_allocfn_ids, alloc_id / 2);
+  return is_suppressed(suppressed_alloca_ids, alloc_id / 2);
+}
+
+// Extend the suppression bitmasks to cover a newly initialized unit, whose CSI
+// IDs of each type start at the given previous totals and end at the given new
+// totals.  Defined in suppressions.cpp.
+void init_unit_suppressions(csi_id_t old_load, csi_id_t new_load,
+                            csi_id_t old_store, csi_id_t new_store,
+                            csi_id_t old_alloca, csi_id_t new_alloca,
+                            csi_id_t old_allocfn, csi_id_t new_allocfn);
+
+// Support for checking only selected functions, specified by the CILKSAN_ONLY
+// environment variable, a comma-separated list of fun: and src: rules as above,
+// where entries without a prefix are function-name patterns.  For example,
+// CILKSAN_ONLY=kernel*,src:solver.cpp:100-200 selects functions named kernel*
+// and functions defined on lines 100 through 200 of solver.cpp.  When
+// CILKSAN_ONLY is set, Cilksan checks only accesses that execute dynamically
+// within a selected function or a checked region of the program, marked by
+// __cilksan_begin_checked_region() and __cilksan_end_checked_region().  In
+// particular, setting CILKSAN_ONLY to the empty string checks only checked
+// regions.  Cilksan treats all other accesses as if they executed serially.
+
+// True if CILKSAN_ONLY is set.
+extern bool check_selected_only;
+// Bitmask of selected function IDs, or null if CILKSAN_ONLY is not set.
+extern uint64_t *checked_func_ids;
+
+__attribute__((always_inline)) static inline bool
+is_checked_func(csi_id_t func_id) {
+  return __builtin_expect(checked_func_ids != nullptr, false) &&
+         ((checked_func_ids[func_id / 64] >> (func_id % 64)) & 1);
+}
+
+// Extend the bitmask of selected functions to cover a newly initialized unit,
+// whose function IDs start at old_func and end at new_func.  Defined in
+// suppressions.cpp.
+void init_unit_checked_funcs(csi_id_t old_func, csi_id_t new_func);
+
+// Release the suppression rules and bitmasks.  Defined in suppressions.cpp.
+void free_suppressions();
+
+#endif // __SUPPRESSIONS_H__
@@ -2,6 +2,8 @@
 #ifndef INCLUDED_CILK_CILKSAN_H
 #define INCLUDED_CILK_CILKSAN_H
 
+#include <stdint.h>
+
 #ifdef __cplusplus
 
 #define CILKSAN_EXTERN_C extern "C"
@@ -21,8 +23,14 @@
 CILKSAN_EXTERN_C void __cilksan_enable_checking(void) CILKSAN_NOTHROW;
 CILKSAN_EXTERN_C void __cilksan_disable_checking(void) CILKSAN_NOTHROW;
 CILKSAN_EXTERN_C bool __cilksan_is_checking_enabled(void) CILKSAN_NOTHROW;
+CILKSAN_EXTERN_C void __cilksan_begin_checked_region(void) CILKSAN_NOTHROW;
+CILKSAN_EXTERN_C void __cilksan_end_checked_region(void) CILKSAN_NOTHROW;
+CILKSAN_EXTERN_C void __cilksan_region_begin(uint64_t id) CILKSAN_NOTHROW;
+CILKSAN_EXTERN_C void __cilksan_region_end(uint64_t id) CILKSAN_NOTHROW;
 
 CILKSAN_EXTERN_C void __cilksan_acquire_lock(const void *mutex) CILKSAN_NOTHROW;
+CILKSAN_EXTERN_C void
+__cilksan_acquire_read_lock(const void *mutex) CILKSAN_NOTHROW;
 CILKSAN_EXTERN_C void __cilksan_release_lock(const void *mutex) CILKSAN_NOTHROW;
 CILKSAN_EXTERN_C void __cilksan_begin_atomic() CILKSAN_NOTHROW;
 CILKSAN_EXTERN_C void __cilksan_end_atomic() CILKSAN_NOTHROW;
@@ -40,8 +48,14 @@ extern "C" {
 static inline void __cilksan_enable_checking(void) CILKSAN_NOTHROW {}
 static inline void __cilksan_disable_checking(void) CILKSAN_NOTHROW {}
 static inline bool __cilksan_is_checking_enabled(void) { return false; }
+static inline void __cilksan_begin_checked_region(void) CILKSAN_NOTHROW {}
+static inline void __cilksan_end_checked_region(void) CILKSAN_NOTHROW {}
+static inline void __cilksan_region_begin(uint64_t id) CILKSAN_NOTHROW {}
+static inline void __cilksan_region_end(uint64_t id) CILKSAN_NOTHROW {}
 
 static inline void __cilksan_acquire_lock(const void *mutex) CILKSAN_NOTHROW {}
+static inline void
+__cilksan_acquire_read_lock(const void *mutex) CILKSAN_NOTHROW {}
 static inline void __cilksan_release_lock(const void *mutex) CILKSAN_NOTHROW {}
 static inline void __cilksan_begin_atomic() CILKSAN_NOTHROW {}
 static inline void __cilksan_end_atomic() CILKSAN_NOTHROW {}
@@ -84,6 +98,17 @@ public:
   }
 };
 
+// Scoped checked region.  When the CILKSAN_ONLY environment variable restricts
+// checking to selected functions, Cilksan also checks the accesses executed
+// during the lifetime of a Cilksan_checked_region.
+class Cilksan_checked_region {
+public:
+  Cilksan_checked_region() { __cilksan_begin_checked_region(); }
+  ~Cilksan_checked_region() { __cilksan_end_checked_region(); }
+  Cilksan_checked_region(const Cilksan_checked_region &) = delete;
+  Cilksan_checked_region &operator=(const Cilksan_checked_region &) = delete;
+};
+
 #endif
 
 #endif // INCLUDED_CILK_CILKSAN_H
@@ -0,0 +1,44 @@
+// RUN: %clangxx_cilksan -fopencilk -Og %s -o %t -g
+// RUN: %run %t 2>&1 | FileCheck %s
+// RUN: env CILKSAN_ONLY='*selected_update*' %run %t 2>&1 | FileCheck %s
+
+#include <cilk/cilk.h>
+#include <pthread.h>
+#include <stdio.h>
+
+int locked_count = 0, unlocked_count = 0;
+
+// Separate functions update the two counters, so that races on locked_count
+// are not duplicates of races on unlocked_count.
+__attribute__((noinline))
+void selected_update_locked(int *x) {
+  (*x)++;
+}
+
+__attribute__((noinline))
+void selected_update_unlocked(int *x) {
+  (*x)++;
+}
+
+int main(int argc, char** argv) {
+  pthread_mutex_t mutex;
+  pthread_mutex_init(&mutex, NULL);
+  // The unselected caller holds the mutex around the updates of locked_count,
+  // so only the updates of unlocked_count race.
+  cilk_for (int i = 0; i < 1000; i++) {
+    pthread_mutex_lock(&mutex);
+    selected_update_locked(&locked_count);
+    pthread_mutex_unlock(&mutex);
+    selected_update_unlocked(&unlocked_count);
+  }
+  pthread_mutex_destroy(&mutex);
+
+  printf("%d %d\n", locked_count, unlocked_count);
+  return 0;
+}
+
+// CHECK-NOT: {{Lock ID to remove is not in this lockset|selected_update_locked}}
+// CHECK: Race detected on location
+// CHECK: {{Read|Write}} {{[0-9a-f]+}} selected_update_unlocked
+// CHECK-NOT: {{Lock ID to remove is not in this lockset|selected_update_locked}}
+// CHECK: Cilksan detected 2 distinct races.
@@ -0,0 +1,66 @@
+// RUN: %clangxx_cilksan -fopencilk -Og %s -o %t -g
+// RUN: %run %t 2>&1 | FileCheck %s --check-prefix=CHECK-ALL
+// RUN: env CILKSAN_ONLY='*selected_kernel*' %run %t 2>&1 | FileCheck %s --check-prefix=CHECK-ONLY
+// RUN: env CILKSAN_ONLY= %run %t 2>&1 | FileCheck %s --check-prefix=CHECK-REGION
+
+#include <cilk/cilk.h>
+#include <cilk/cilksan.h>
+#include <iostream>
+
+int global_a = 0, global_b = 0, global_c = 0;
+
+// Each kernel uses its own helper, so that the races in different kernels are
+// distinct.
+__attribute__((noinline))
+void helper_a(int *x) {
+  (*x)++;
+}
+
+__attribute__((noinline))
+void helper_b(int *x) {
+  (*x)++;
+}
+
+__attribute__((noinline))
+void helper_c(int *x) {
+  (*x)++;
+}
+
+__attribute__((noinline))
+void selected_kernel() {
+  cilk_for (int i = 0; i < 1000; i++)
+    helper_a(&global_a);
+}
+
+__attribute__((noinline))
+void other_kernel() {
+  cilk_for (int i = 0; i < 1000; i++)
+    helper_b(&global_b);
+}
+
+int main(int argc, char** argv) {
+  selected_kernel();
+  other_kernel();
+  {
+    Cilksan_checked_region region;
+    cilk_for (int i = 0; i < 1000; i++)
+      helper_c(&global_c);
+  }
+
+  std::cout << global_a << " " << global_b << " " << global_c << '\n';
+  return 0;
+}
+
+// CHECK-ALL: Cilksan detected 6 distinct races.
+
+// CHECK-ONLY-NOT: {{other_kernel|helper_b}}
+// CHECK-ONLY: Race detected on location
+// CHECK-ONLY: Call {{[0-9a-f]+}} selected_kernel
+// CHECK-ONLY-NOT: {{other_kernel|helper_b}}
+// CHECK-ONLY: Cilksan detected 4 distinct races.
+
+// CHECK-REGION-NOT: {{selected_kernel|other_kernel}}
+// CHECK-REGION: Race detected on location
+// CHECK-REGION: Call {{[0-9a-f]+}} main
+// CHECK-REGION-NOT: {{selected_kernel|other_kernel}}
+// CHECK-REGION: Cilksan detected 2 distinct races.
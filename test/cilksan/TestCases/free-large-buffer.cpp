@@ -0,0 +1,56 @@
+// RUN: %clangxx_cilksan -fopencilk -Og %s -o %t -g
+// RUN: %run %t 2>&1 | FileCheck %s
+
+#include <cilk/cilk.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static const size_t buf_size = 1UL << 24;
+
+__attribute__((noinline)) void touch_line(char *buf) { buf[buf_size / 2] = 1; }
+
+__attribute__((noinline)) void touch_lines(char *buf) {
+  cilk_for (size_t i = 0; i < 8; ++i)
+    buf[i * (buf_size / 8)] = i;
+}
+
+// Freeing a large buffer, of which the program touched a single line, races
+// with the write to that line.  The race report still identifies the buffer.
+__attribute__((noinline)) int test_racing_free() {
+  char *buf = (char *)malloc(buf_size);
+  cilk_spawn touch_line(buf);
+  free(buf);
+  cilk_sync;
+  return buf != nullptr;
+}
+
+// Freeing a large buffer after its accesses have synced does not race.
+__attribute__((noinline)) int test_synced_free() {
+  char *buf = (char *)malloc(buf_size);
+  cilk_spawn touch_lines(buf);
+  cilk_sync;
+  int res = buf[0];
+  free(buf);
+  return res;
+}
+
+int main() {
+  // 1 distinct race
+  printf("test_racing_free: %d\n", test_racing_free());
+  // 0 distinct races
+  printf("test_synced_free: %d\n", test_synced_free());
+  return 0;
+}
+
+// CHECK: Race detected on location
+// CHECK-NEXT: * Write {{[0-9a-f]+}} touch_line
+// CHECK-NEXT: to variable buf
+// CHECK-NEXT: Spawn {{[0-9a-f]+}} test_racing_free
+// CHECK-NEXT: * Free {{[0-9a-f]+}} test_racing_free
+// CHECK: Heap object buf
+// CHECK: test_racing_free: 1
+
+// CHECK-NOT: Race detected
+// CHECK: test_synced_free: 0
+
+// CHECK: Cilksan detected 1 distinct races.
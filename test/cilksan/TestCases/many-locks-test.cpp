@@ -0,0 +1,77 @@
+// RUN: %clangxx_cilksan -fopencilk -Og %s -o %t
+// RUN: %run %t 2>&1 | FileCheck %s
+
+// This test also serves as a benchmark of lockset operations: pass a larger
+// trip count as the first argument.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <cilk/cilk.h>
+#include <cilk/opadd_reducer.h>
+#include <pthread.h>
+
+#define NUM_LOCKS 100
+
+int main(int argc, char **argv) {
+  int n = 10000;
+  if (argc > 1)
+    n = atoi(argv[1]);
+
+  pthread_mutex_t mtex[NUM_LOCKS];
+  for (int i = 0; i < NUM_LOCKS; i++)
+    pthread_mutex_init(&mtex[i], NULL);
+  // Register this lock last, so its lock ID does not fit in a small lockset.
+  pthread_mutex_t total_mtex;
+  pthread_mutex_init(&total_mtex, NULL);
+
+  cilk::opadd_reducer<long> sum = 0;
+  long lsum[NUM_LOCKS] = {0};
+  long tsum = 0;
+  long msum = 0;
+  cilk_for (int i = 0; i < n; i++) {
+    int l = i % NUM_LOCKS;
+    sum += i;
+
+    // Each element of lsum is protected by its own lock.
+    pthread_mutex_lock(&mtex[l]);
+    lsum[l] += i;
+    pthread_mutex_unlock(&mtex[l]);
+
+    // tsum is protected by total_mtex, together with another lock.
+    pthread_mutex_lock(&total_mtex);
+    pthread_mutex_lock(&mtex[l]);
+    tsum += i;
+    pthread_mutex_unlock(&mtex[l]);
+    pthread_mutex_unlock(&total_mtex);
+
+    // msum is protected by different locks in different iterations.
+    pthread_mutex_lock(&mtex[l]);
+    msum += i;
+    pthread_mutex_unlock(&mtex[l]);
+  }
+
+  long total = 0;
+  for (int i = 0; i < NUM_LOCKS; i++)
+    total += lsum[i];
+  printf("%p\n", (void*)&msum);
+  printf("%ld\n%ld\n%ld\n", (long)sum, total, tsum);
+  return 0;
+}
+
+// CHECK: Race detected on location [[MSUM:[0-9a-f]+]]
+// CHECK-NEXT: * {{Read|Write}} {{[0-9a-f]+}} main
+// CHECK-NEXT: to variable msum
+
+// CHECK: Race detected on location [[MSUM]]
+// CHECK-NEXT: * Write {{[0-9a-f]+}} main
+// CHECK-NEXT: to variable msum
+
+// Verify that no other races are detected
+// CHECK-NOT: Race detected on location
+
+// CHECK: 0x[[MSUM]]
+// CHECK-NEXT: 49995000
+// CHECK-NEXT: 49995000
+// CHECK-NEXT: 49995000
+
+// CHECK: Cilksan detected 2 distinct races.
@@ -0,0 +1,120 @@
+// RUN: %clang_cilksan -fopencilk -Og -mavx2 -g %s -o %t
+// RUN: %run %t 2>&1 | FileCheck %s
+// REQUIRES: x86_64-target-arch
+
+#include <cilk/cilk.h>
+#include <immintrin.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+__attribute__((noinline))
+void write_lanes(int *x) {
+  x[0] = 0;
+  x[1] = 1;
+  x[2] = 2;
+  x[3] = 3;
+  x[4] = 4;
+  x[5] = 5;
+  x[6] = 6;
+  x[7] = 7;
+}
+
+__attribute__((noinline))
+int read_lanes(int *x) {
+  return x[0] + x[1] + x[2] + x[3] + x[4] + x[5] + x[6] + x[7];
+}
+
+__attribute__((noinline))
+void write_gathered(int *x) {
+  x[0] = 0;
+  x[100] = 100;
+  x[101] = 101;
+  x[200] = 200;
+  x[201] = 201;
+}
+
+// Only lanes 0, 2, 3, and 5 are active.
+static __m256i lanes_mask() {
+  return _mm256_set_epi32(0, 0, -1, 0, -1, -1, 0, -1);
+}
+
+__attribute__((noinline))
+int test_mm256_maskload_epi32(int *x) {
+  cilk_spawn write_lanes(x);
+  __m256i y = _mm256_maskload_epi32(x, lanes_mask());
+  cilk_sync;
+
+  int res = _mm256_extract_epi32(y, 0) + _mm256_extract_epi32(y, 1) +
+    _mm256_extract_epi32(y, 2) + _mm256_extract_epi32(y, 3) +
+    _mm256_extract_epi32(y, 4) + _mm256_extract_epi32(y, 5) +
+    _mm256_extract_epi32(y, 6) + _mm256_extract_epi32(y, 7);
+
+  return res;
+}
+
+__attribute__((noinline))
+int test_mm256_maskstore_epi32(int *x) {
+  int res = cilk_spawn read_lanes(x);
+  _mm256_maskstore_epi32(x, lanes_mask(), _mm256_set1_epi32(1));
+  cilk_sync;
+
+  return res;
+}
+
+__attribute__((noinline))
+int test_mm256_i32gather_epi32_coalesced(int *x) {
+  // Lanes 0 and 1 load the same element, lanes 2 and 3 load adjacent elements
+  // in increasing order, and lanes 4 and 5 load adjacent elements in
+  // decreasing order.
+  __m256i indx = _mm256_set_epi32(1000, 500, 200, 201, 101, 100, 0, 0);
+  cilk_spawn write_gathered(x);
+  __m256i y = _mm256_i32gather_epi32(x, indx, 4);
+  cilk_sync;
+
+  int res = _mm256_extract_epi32(y, 0) + _mm256_extract_epi32(y, 1) +
+    _mm256_extract_epi32(y, 2) + _mm256_extract_epi32(y, 3) +
+    _mm256_extract_epi32(y, 4) + _mm256_extract_epi32(y, 5) +
+    _mm256_extract_epi32(y, 6) + _mm256_extract_epi32(y, 7);
+
+  return res;
+}
+
+int main() {
+  int n = 2000;
+  int *x = (int *)calloc(n, sizeof(int));
+
+  // 4 distinct races, one per active lane, 0 duplicates
+  printf("test_mm256_maskload_epi32: %d\n", test_mm256_maskload_epi32(x));
+
+  // 4 distinct races, one per active lane, 0 duplicates
+  printf("test_mm256_maskstore_epi32: %d\n", test_mm256_maskstore_epi32(x));
+
+  // 5 distinct races, one per racing address, 0 duplicates
+  printf("test_mm256_i32gather_epi32_coalesced: %d\n",
+         test_mm256_i32gather_epi32_coalesced(x));
+
+  free(x);
+
+  return 0;
+}
+
+// CHECK: Race detected
+// CHECK-NEXT: * Write {{[0-9a-f]+}} write_lanes
+// CHECK-NEXT: + Spawn {{[0-9a-f]+}} test_mm256_maskload_epi32
+// CHECK-NEXT: * Read {{[0-9a-f]+}} test_mm256_maskload_epi32
+// CHECK: test_mm256_maskload_epi32: 10
+
+// CHECK: Race detected
+// CHECK-NEXT: * Read {{[0-9a-f]+}} read_lanes
+// CHECK-NEXT: + Spawn {{[0-9a-f]+}} test_mm256_maskstore_epi32
+// CHECK-NEXT: * Write {{[0-9a-f]+}} test_mm256_maskstore_epi32
+// CHECK: test_mm256_maskstore_epi32: 28
+
+// CHECK: Race detected
+// CHECK-NEXT: * Write {{[0-9a-f]+}} write_gathered
+// CHECK-NEXT: + Spawn {{[0-9a-f]+}} test_mm256_i32gather_epi32_coalesced
+// CHECK-NEXT: * Read {{[0-9a-f]+}} test_mm256_i32gather_epi32_coalesced
+// CHECK: test_mm256_i32gather_epi32_coalesced: 602
+
+// CHECK: Cilksan detected 13 distinct races.
+// CHECK-NEXT: Cilksan suppressed 0 duplicate race reports.
@@ -0,0 +1,131 @@
+// RUN: %clangxx_cilksan -fopencilk -Og %s -o %t -g
+// RUN: %run %t 2>&1 | FileCheck %s
+// REQUIRES: linux, cilksan-dynamic-runtime
+
+#include <cilk/cilk.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+static size_t page_size;
+
+static char *map_pages(size_t n, void *addr = nullptr, int flags = 0) {
+  return (char *)mmap(addr, n * page_size, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | flags, -1, 0);
+}
+
+__attribute__((noinline)) void write_partial(char *p) {
+  p[0] = 1;
+  p[3 * page_size] = 1;
+}
+
+__attribute__((noinline)) int read_partial(char *p) {
+  return p[0] + p[3 * page_size];
+}
+
+__attribute__((noinline)) void write_remap_failed(char *p) { p[0] = 1; }
+
+__attribute__((noinline)) int read_remap_failed(char *p) { return p[0]; }
+
+__attribute__((noinline)) void write_remapped(char *p) { p[3 * page_size] = 1; }
+
+__attribute__((noinline)) int read_remapped(char *p) {
+  return p[3 * page_size];
+}
+
+__attribute__((noinline)) void write_reused(char *p) { p[0] = 1; }
+
+__attribute__((noinline)) int read_reused(char *p) { return p[0]; }
+
+__attribute__((noinline)) void noop() {}
+
+// Unmapping part of a mapping in parallel code keeps the shadow memory of the
+// pages that remain mapped, so both races are reported.
+__attribute__((noinline)) int test_partial_munmap() {
+  char *p = map_pages(4);
+  cilk_spawn write_partial(p);
+  munmap(p + page_size, page_size);
+  int res = read_partial(p);
+  cilk_sync;
+  munmap(p, page_size);
+  munmap(p + 2 * page_size, 2 * page_size);
+  return res;
+}
+
+// A failed mremap changes no mappings, so the race is reported.
+__attribute__((noinline)) int test_failed_mremap() {
+  char *p = map_pages(2);
+  cilk_spawn write_remap_failed(p);
+  void *r = mremap(p + 1, page_size, 2 * page_size, 0);
+  int res = read_remap_failed(p);
+  cilk_sync;
+  munmap(p, 2 * page_size);
+  return res + (r == MAP_FAILED);
+}
+
+// Accesses to a remapped range race as usual.
+__attribute__((noinline)) int test_mremap() {
+  char *p = map_pages(2);
+  p[0] = 1;
+  char *r = (char *)mremap(p, 2 * page_size, 4 * page_size, MREMAP_MAYMOVE);
+  cilk_spawn write_remapped(r);
+  int res = read_remapped(r) + r[0];
+  cilk_sync;
+  munmap(r, 4 * page_size);
+  return res;
+}
+
+// Unmapping a range in serial code defers clearing its shadow memory to the
+// next spawn.  Reusing the range after that spawn does not report stale races,
+// and new accesses to the range race as usual.
+__attribute__((noinline)) int test_serial_munmap() {
+  char *p = map_pages(1);
+  cilk_for (int i = 0; i < 16; ++i)
+    p[i * 64] = i;
+  munmap(p, page_size);
+
+  cilk_spawn noop();
+  char *q = map_pages(1, p, MAP_FIXED);
+  cilk_sync;
+
+  cilk_spawn write_reused(q);
+  int res = read_reused(q);
+  cilk_sync;
+  munmap(q, page_size);
+  return res + (p == q);
+}
+
+int main() {
+  page_size = sysconf(_SC_PAGESIZE);
+
+  // 2 distinct races
+  printf("test_partial_munmap: %d\n", test_partial_munmap());
+  // 1 distinct race
+  printf("test_failed_mremap: %d\n", test_failed_mremap());
+  // 1 distinct race
+  printf("test_mremap: %d\n", test_mremap());
+  // 1 distinct race
+  printf("test_serial_munmap: %d\n", test_serial_munmap());
+
+  return 0;
+}
+
+// CHECK: Race detected
+// CHECK-NEXT: * Write {{[0-9a-f]+}} write_partial
+// CHECK: Race detected
+// CHECK-NEXT: * Write {{[0-9a-f]+}} write_partial
+// CHECK: test_partial_munmap: 2
+
+// CHECK: Race detected
+// CHECK-NEXT: * Write {{[0-9a-f]+}} write_remap_failed
+// CHECK: test_failed_mremap: 2
+
+// CHECK: Race detected
+// CHECK-NEXT: * Write {{[0-9a-f]+}} write_remapped
+// CHECK: test_mremap: 2
+
+// CHECK: Race detected
+// CHECK-NEXT: * Write {{[0-9a-f]+}} write_reused
+// CHECK: test_serial_munmap: 2
+
+// CHECK: Cilksan detected 5 distinct races.
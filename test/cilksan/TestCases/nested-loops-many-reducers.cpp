@@ -0,0 +1,89 @@
+// RUN: %clangxx_cilksan -std=c++20 -fopencilk -O3 -g %s -o %t
+// RUN: %run %t 2>&1 | FileCheck %s --check-prefixes=CHECK,CILKSAN
+//
+// Stress test for merging tables of reducer views.  Each iteration of the
+// outer loop creates enough local reducers that the tables of reducer views
+// exceed the small-table size, and each sync in the inner loop merges those
+// tables.  Pass larger trip counts on the command line to use this test as a
+// benchmark, e.g., with arguments `64 4096`.
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+#include <cilk/cilk.h>
+
+static inline void zero_u64(void *view) {
+    *reinterpret_cast<uint64_t *>(view) = 0;
+}
+
+static inline void add_u64(void *left, void *right) {
+    *reinterpret_cast<uint64_t *>(left) += *reinterpret_cast<uint64_t *>(right);
+}
+
+using SumReducer = uint64_t cilk_reducer(zero_u64, add_u64);
+
+// Number of reducers updated in each inner loop.
+constexpr size_t K = 12;
+
+#define FOR_EACH_REDUCER(X)                                                    \
+    X(0) X(1) X(2) X(3) X(4) X(5) X(6) X(7) X(8) X(9) X(10) X(11)
+
+static inline uint64_t term(size_t i, size_t j, size_t k) {
+    return (i + 1) * (j + 1) + k;
+}
+
+auto reduce_with_cilk(size_t n, size_t m, uint64_t *res) -> void {
+#define DECLARE_OUTER(k) SumReducer p##k{0};
+    FOR_EACH_REDUCER(DECLARE_OUTER)
+#undef DECLARE_OUTER
+    cilk_for (size_t i = 0; i < n; i++) {
+#define DECLARE_INNER(k) SumReducer lp##k{0};
+        FOR_EACH_REDUCER(DECLARE_INNER)
+#undef DECLARE_INNER
+        cilk_for (size_t j = 0; j < m; j++) {
+#define UPDATE_INNER(k) lp##k += term(i, j, k);
+            FOR_EACH_REDUCER(UPDATE_INNER)
+#undef UPDATE_INNER
+        }
+#define UPDATE_OUTER(k) p##k += lp##k;
+        FOR_EACH_REDUCER(UPDATE_OUTER)
+#undef UPDATE_OUTER
+    }
+#define STORE(k) res[k] = p##k;
+    FOR_EACH_REDUCER(STORE)
+#undef STORE
+}
+
+auto reduce_serial(size_t n, size_t m, uint64_t *res) -> void {
+    for (size_t k = 0; k < K; k++)
+        res[k] = 0;
+    for (size_t i = 0; i < n; i++)
+        for (size_t j = 0; j < m; j++)
+            for (size_t k = 0; k < K; k++)
+                res[k] += term(i, j, k);
+}
+
+auto main(int argc, char *argv[]) -> int {
+    size_t n = 8;
+    size_t m = 256;
+    if (argc > 1)
+        n = strtoul(argv[1], nullptr, 0);
+    if (argc > 2)
+        m = strtoul(argv[2], nullptr, 0);
+
+    uint64_t res_cilk[K], res_serial[K];
+    reduce_with_cilk(n, m, res_cilk);
+    reduce_serial(n, m, res_serial);
+    for (size_t k = 0; k < K; k++) {
+        if (res_cilk[k] != res_serial[k])
+            printf("res_cilk[%zu] = %lu, res_serial[%zu] = %lu\n", k,
+                   res_cilk[k], k, res_serial[k]);
+    }
+    return 0;
+}
+
+// CHECK-NOT: res_cilk[
+
+// CILKSAN: Cilksan detected 0 distinct races.
+// CILKSAN-NEXT: Cilksan suppressed 0 duplicate race reports.
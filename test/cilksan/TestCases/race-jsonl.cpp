@@ -0,0 +1,31 @@
+// RUN: %clangxx_cilksan -fopencilk -Og %s -o %t -g
+// RUN: env CILKSAN_OUT_FORMAT=jsonl %run %t 2>&1 | FileCheck %s
+
+#include <cilk/cilk.h>
+
+int global = 0;
+
+__attribute__((noinline))
+void helper(int *x) {
+  (*x)++;
+}
+
+int main(int argc, char** argv) {
+  cilk_for (int i = 0; i < 1000; i++)
+    helper(&global);
+  return 0;
+}
+
+// CHECK-NOT: Race detected on location
+
+// CHECK: {"record":"stack","id":1,"parent":0,"loc":"loop","csi":{{[0-9]+}}}
+// CHECK-NEXT: {"record":"stack","id":2,"parent":1,"loc":"call","csi":{{[0-9]+}}}
+// CHECK-NEXT: {"record":"race","race":"WR","addr":"0x[[GLOBAL:[0-9a-f]+]]","first":{"acc":"write","loc":"store","csi":{{[0-9]+}},"stack":2},"second":{"acc":"read","loc":"load","csi":{{[0-9]+}},"stack":2},"alloc":null}
+// CHECK-NEXT: {"record":"race","race":"WW","addr":"0x[[GLOBAL]]","first":{"acc":"write","loc":"store","csi":{{[0-9]+}},"stack":2},"second":{"acc":"write","loc":"store","csi":{{[0-9]+}},"stack":2},"alloc":null}
+
+// CHECK-DAG: {"record":"loc","loc":"load","csi":{{[0-9]+}},"pc":"0x{{[0-9a-f]+}}","func":"{{[^"]*}}helper{{[^"]*}}","file":"{{.*}}race-jsonl.cpp","line":10,"col":{{[0-9]+}},"var":"x"}
+// CHECK-DAG: {"record":"loc","loc":"store","csi":{{[0-9]+}},"pc":"0x{{[0-9a-f]+}}","func":"{{[^"]*}}helper{{[^"]*}}","file":"{{.*}}race-jsonl.cpp","line":10,"col":{{[0-9]+}},"var":"x"}
+// CHECK-DAG: {"record":"loc","loc":"call","csi":{{[0-9]+}},"pc":"0x{{[0-9a-f]+}}","func":"{{[^"]*}}main{{[^"]*}}","file":"{{.*}}race-jsonl.cpp","line":15,"col":{{[0-9]+}},"var":null}
+// CHECK: {"record":"summary","races":2,"duplicates":{{[0-9]+}}}
+
+// CHECK: Cilksan detected 2 distinct races.
@@ -0,0 +1,32 @@
+// RUN: %clangxx_cilksan -fopencilk -Og %s -o %t -g
+// RUN: env CILKSAN_SUMMARY=1 %run %t 2>&1 | FileCheck %s
+
+#include <cilk/cilk.h>
+#include <iostream>
+
+__attribute__((noinline))
+void helper(int *x) {
+  (*x)++;
+}
+
+int main(int argc, char** argv) {
+  int arr[4] = {0};
+  cilk_for (int i = 0; i < 1000; i++)
+    helper(&arr[i % 4]);
+
+  std::cout << arr[0] + arr[1] + arr[2] + arr[3] << '\n';
+  return 0;
+}
+
+// CHECK: Race detected on location
+// CHECK: Race detected on location
+
+// CHECK: Race summary by allocation site:
+// CHECK: Stack object arr
+// CHECK-NEXT: Alloc {{[0-9a-f]+}} in {{.*}}main{{.*}}race-summary.cpp:13
+// CHECK-NEXT: 2 distinct races, {{[0-9]+}} reports, on addresses [{{[0-9a-f]+}}, {{[0-9a-f]+}}]
+// CHECK: x {{WR|WW}} race:
+// CHECK-NEXT: {{read|write}} {{[0-9a-f]+}} in {{.*}}helper{{.*}}race-summary.cpp:9
+// CHECK-NEXT: {{read|write}} {{[0-9a-f]+}} in {{.*}}helper{{.*}}race-summary.cpp:9
+
+// CHECK: Cilksan detected 2 distinct races.
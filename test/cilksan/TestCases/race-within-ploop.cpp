@@ -2,6 +2,7 @@
 // RUN: %run %t 2>&1 | FileCheck %s --check-prefixes=CHECK,CHECK-Og
 // RUN: %clangxx_cilksan -fopencilk -O2 %s -o %t
 // RUN: %run %t 2>&1 | FileCheck %s --check-prefixes=CHECK,CHECK-O2
+// RUN: env CILKSAN_LAZY_CALL_STACKS=1 %run %t 2>&1 | FileCheck %s --check-prefixes=CHECK,CHECK-O2
 #include <cstdio>
 #include <cstdlib>
 #include <vector>
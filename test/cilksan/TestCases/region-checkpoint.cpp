@@ -0,0 +1,60 @@
+// RUN: %clangxx_cilksan -fopencilk -Og %s -o %t -g
+// RUN: %run %t 2>&1 | FileCheck %s
+// RUN: env CILKSAN_REGION_CHECKS=0 %run %t 2>&1 | FileCheck %s --check-prefix=CHECK-NONE
+
+#include <cilk/cilk.h>
+#include <cilk/cilksan.h>
+#include <iostream>
+
+int global_a = 0, global_b = 0;
+
+__attribute__((noinline))
+void helper_a(int *x) {
+  (*x)++;
+}
+
+// Separate from helper_a, so that races in kernel_b are not duplicates of
+// races in kernel_a.
+__attribute__((noinline))
+void helper_b(int *x) {
+  (*x)++;
+}
+
+__attribute__((noinline))
+void kernel_a() {
+  cilk_for (int i = 0; i < 1000; i++)
+    helper_a(&global_a);
+}
+
+__attribute__((noinline))
+void kernel_b() {
+  cilk_for (int i = 0; i < 1000; i++)
+    helper_b(&global_b);
+}
+
+int main(int argc, char** argv) {
+  for (int iter = 0; iter < 100; ++iter) {
+    __cilksan_region_begin(1);
+    // Only execution 50 runs kernel_b, so Cilksan must start checking that
+    // execution as soon as it sees the new behavior.
+    if (iter != 50)
+      kernel_a();
+    else
+      kernel_b();
+    __cilksan_region_end(1);
+  }
+
+  std::cout << global_a << " " << global_b << '\n';
+  return 0;
+}
+
+// CHECK: Race detected on location
+// CHECK: Call {{[0-9a-f]+}} kernel_a
+// CHECK: Race detected on location
+// CHECK: Call {{[0-9a-f]+}} kernel_b
+// CHECK: Cilksan detected 4 distinct races.
+// CHECK: Cilksan checked 4 of 100 executions of region 1.
+
+// CHECK-NONE-NOT: Race detected on location
+// CHECK-NONE: Cilksan detected 0 distinct races.
+// CHECK-NONE: Cilksan checked 0 of 100 executions of region 1.
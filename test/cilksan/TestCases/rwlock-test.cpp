@@ -0,0 +1,67 @@
+// RUN: %clangxx_cilksan -fopencilk -Og %s -o %t
+// RUN: %run %t 2>&1 | FileCheck %s
+
+#include <stdio.h>
+#include <cilk/cilk.h>
+#include <pthread.h>
+
+int main() {
+  long table[16] = {0};
+  long rsum = 0;
+  long wsum = 0;
+  long ssum = 0;
+  pthread_rwlock_t rwlock;
+  pthread_rwlock_init(&rwlock, NULL);
+  pthread_spinlock_t spin;
+  pthread_spin_init(&spin, PTHREAD_PROCESS_PRIVATE);
+  cilk_for (int i = 0; i <= 10000; i++) {
+    // Reads under a read lock and writes under a write lock do not race.
+    if (i % 16 == 0) {
+      pthread_rwlock_wrlock(&rwlock);
+      table[(i / 16) % 16] += i;
+      pthread_rwlock_unlock(&rwlock);
+    } else {
+      pthread_rwlock_rdlock(&rwlock);
+      long x = table[i % 16];
+      pthread_rwlock_unlock(&rwlock);
+      if (x < 0)
+        printf("negative\n");
+    }
+
+    // A read lock does not protect writes.
+    pthread_rwlock_rdlock(&rwlock);
+    rsum += i;
+    pthread_rwlock_unlock(&rwlock);
+
+    pthread_rwlock_wrlock(&rwlock);
+    wsum += i;
+    pthread_rwlock_unlock(&rwlock);
+
+    pthread_spin_lock(&spin);
+    ssum += i;
+    pthread_spin_unlock(&spin);
+  }
+  printf("%p\n", (void*)&rsum);
+  printf("%ld\n%ld\n%ld\n", rsum, wsum, ssum);
+  pthread_spin_destroy(&spin);
+  pthread_rwlock_destroy(&rwlock);
+  return 0;
+}
+
+// CHECK: Race detected on location [[RSUM:[0-9a-f]+]]
+// CHECK-NEXT: * {{Read|Write}} {{[0-9a-f]+}} main
+// CHECK-NEXT: to variable rsum
+
+// CHECK: Race detected on location [[RSUM]]
+// CHECK-NEXT: * Write {{[0-9a-f]+}} main
+// CHECK-NEXT: to variable rsum
+
+// Verify that no other races are detected
+// CHECK-NOT: Race detected on location
+
+// CHECK: 0x[[RSUM]]
+// CHECK-NEXT: 50005000
+// CHECK-NEXT: 50005000
+// CHECK-NEXT: 50005000
+
+// CHECK: Cilksan detected 2 distinct races.
@@ -0,0 +1,46 @@
+// RUN: %clangxx_cilksan -fopencilk -Og %s -o %t -g
+// RUN: %run %t 2>&1 | FileCheck %s --check-prefix=CHECK-ALL
+// RUN: echo "# Known races" > %t.supp
+// RUN: echo "fun:*suppressed_helper*" >> %t.supp
+// RUN: echo "alloc_var:suppressed_local" >> %t.supp
+// RUN: env CILKSAN_SUPPRESSIONS=%t.supp %run %t 2>&1 | FileCheck %s
+
+#include <cilk/cilk.h>
+#include <iostream>
+
+int global = 0;
+
+__attribute__((noinline))
+void suppressed_helper(int *x) {
+  (*x)++;
+}
+
+__attribute__((noinline))
+void helper(int *x) {
+  (*x)++;
+}
+
+int main(int argc, char** argv) {
+  cilk_for (int i = 0; i < 1000; i++)
+    suppressed_helper(&global);
+
+  int suppressed_local = 0;
+  cilk_for (int i = 0; i < 1000; i++)
+    helper(&suppressed_local);
+
+  int local = 0;
+  cilk_for (int i = 0; i < 1000; i++)
+    helper(&local);
+
+  std::cout << global << " " << suppressed_local << " " << local << '\n';
+  return 0;
+}
+
+// CHECK-ALL: Cilksan detected 6 distinct races.
+
+// CHECK: Race detected on location
+// CHECK: Stack object local
+// CHECK: Race detected on location
+// CHECK: Stack object local
+// CHECK-NOT: Race detected on location
+// CHECK: Cilksan detected 2 distinct races.